@@ -0,0 +1,501 @@
+/*
+ * FreeRTOS Kernel V10.4.3
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/*
+ * A two level segregated fit (TLSF) implementation of pvPortMalloc() and
+ * vPortFree().  Free blocks are kept in lists indexed by size class: the first
+ * level splits sizes by power of two and the second level splits each power of
+ * two into heapSL_INDEX_COUNT linear ranges.  A bitmap per level records which
+ * lists are non-empty, so finding a block and freeing one both take a fixed
+ * number of steps regardless of how many blocks are in the heap.
+ *
+ * Every block records the block physically before it, so a freed block is
+ * combined with free neighbours on either side and the heap does not fragment
+ * the way heap_2.c does.
+ *
+ * vPortGetHeapStats() reports the free bytes, the largest and smallest free
+ * blocks and the minimum free bytes since boot.
+ */
+#include <stdlib.h>
+#include <stddef.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+ * all the API functions to use the MPU wrappers.  That should only be done when
+ * task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if ( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+    #error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+/* Size class parameters.  Blocks smaller than heapSMALL_BLOCK_SIZE share the
+ * first level list and are split linearly by the second level.  The largest
+ * first level covers blocks up to 2^heapFL_INDEX_MAX bytes. */
+#define heapSL_INDEX_COUNT_LOG2    3
+#define heapSL_INDEX_COUNT         ( 1U << heapSL_INDEX_COUNT_LOG2 )
+#define heapALIGN_SIZE_LOG2        3
+#define heapFL_INDEX_SHIFT         ( heapSL_INDEX_COUNT_LOG2 + heapALIGN_SIZE_LOG2 )
+#define heapFL_INDEX_MAX           15
+#define heapFL_INDEX_COUNT         ( heapFL_INDEX_MAX - heapFL_INDEX_SHIFT + 1 )
+#define heapSMALL_BLOCK_SIZE       ( ( size_t ) 1 << heapFL_INDEX_SHIFT )
+
+#if ( configTOTAL_HEAP_SIZE >= ( 1UL << heapFL_INDEX_MAX ) )
+    #error configTOTAL_HEAP_SIZE is too large for heapFL_INDEX_MAX
+#endif
+
+#if ( portBYTE_ALIGNMENT > ( 1 << heapALIGN_SIZE_LOG2 ) )
+    #error portBYTE_ALIGNMENT is larger than the TLSF block alignment
+#endif
+
+/* Index of the most significant set bit.  Undefined for zero. */
+#if defined( __TI_ARM__ )
+    #define heapFLS( x )    ( 31 - ( int ) __clz( ( uint32_t ) ( x ) ) )
+#else
+    #define heapFLS( x )    ( 31 - __builtin_clz( ( uint32_t ) ( x ) ) )
+#endif
+
+/* Index of the least significant set bit.  Undefined for zero. */
+#define heapFFS( x )        heapFLS( ( x ) & ( 0U - ( x ) ) )
+
+/* Allocate the memory for the heap. */
+#if ( configAPPLICATION_ALLOCATED_HEAP == 1 )
+
+/* The application writer has already defined the array used for the RTOS
+* heap - probably so it can be placed in a special segment or address. */
+    extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#else
+    static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/* Every block starts with a BlockLink_t.  Only the first two members are kept
+ * while the block is allocated; the free list links overlap the start of the
+ * memory returned to the application. */
+typedef struct A_BLOCK_LINK
+{
+    struct A_BLOCK_LINK * pxPrevPhysBlock; /*<< The block immediately below this one in memory. */
+    size_t xBlockSize;                     /*<< Size of the block including this header.  Bit 0 is set while the block is free. */
+    struct A_BLOCK_LINK * pxNextFreeBlock; /*<< The next block in the same size class. */
+    struct A_BLOCK_LINK * pxPrevFreeBlock; /*<< The previous block in the same size class. */
+} BlockLink_t;
+
+#define heapBLOCK_FREE_BIT         ( ( size_t ) 1 )
+#define heapSTRUCT_SIZE            ( ( ( offsetof( BlockLink_t, pxNextFreeBlock ) ) + ( portBYTE_ALIGNMENT - 1 ) ) & ~portBYTE_ALIGNMENT_MASK )
+#define heapMINIMUM_BLOCK_SIZE     ( ( ( sizeof( BlockLink_t ) ) + ( portBYTE_ALIGNMENT - 1 ) ) & ~portBYTE_ALIGNMENT_MASK )
+
+#define heapBLOCK_SIZE( pxBlock )  ( ( pxBlock )->xBlockSize & ~heapBLOCK_FREE_BIT )
+#define heapBLOCK_IS_FREE( pxBlock ) ( ( ( pxBlock )->xBlockSize & heapBLOCK_FREE_BIT ) != 0 )
+#define heapNEXT_PHYS_BLOCK( pxBlock ) ( ( BlockLink_t * ) ( ( ( uint8_t * ) ( pxBlock ) ) + heapBLOCK_SIZE( pxBlock ) ) )
+
+/*
+ * Initialises the heap structures before their first use.
+ */
+static void prvHeapInit( void );
+
+/*
+ * Maps a block size onto the first and second level list it belongs to.
+ */
+static void prvMappingInsert( size_t xSize,
+                              UBaseType_t * puxFl,
+                              UBaseType_t * puxSl );
+
+/*
+ * Finds a non-empty list whose blocks are all at least xSize bytes.
+ */
+static BlockLink_t * prvSearchSuitableBlock( size_t xSize );
+
+static void prvInsertFreeBlock( BlockLink_t * pxBlock );
+static void prvRemoveFreeBlock( BlockLink_t * pxBlock );
+
+/* Heads of the segregated free lists and the bitmaps that index them. */
+static BlockLink_t * pxFreeLists[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+static uint32_t ulFlBitmap;
+static uint32_t ulSlBitmap[ heapFL_INDEX_COUNT ];
+
+/* Zero sized block that marks the top of the heap.  It is never free, so the
+ * last real block never tries to merge past it. */
+static BlockLink_t * pxHeapEnd = NULL;
+
+/* Keeps track of the number of free bytes remaining, and the lowest it has
+ * been, but says nothing about fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+static size_t xNumberOfSuccessfulAllocations = 0;
+static size_t xNumberOfSuccessfulFrees = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvMappingInsert( size_t xSize,
+                              UBaseType_t * puxFl,
+                              UBaseType_t * puxSl )
+{
+    UBaseType_t uxFl, uxSl;
+
+    if( xSize < heapSMALL_BLOCK_SIZE )
+    {
+        /* Small blocks are spread linearly across the first list. */
+        uxFl = 0;
+        uxSl = ( UBaseType_t ) ( xSize / ( heapSMALL_BLOCK_SIZE / heapSL_INDEX_COUNT ) );
+    }
+    else
+    {
+        uxFl = ( UBaseType_t ) heapFLS( xSize );
+        uxSl = ( UBaseType_t ) ( ( xSize >> ( uxFl - heapSL_INDEX_COUNT_LOG2 ) ) ^ heapSL_INDEX_COUNT );
+        uxFl -= ( heapFL_INDEX_SHIFT - 1 );
+    }
+
+    *puxFl = uxFl;
+    *puxSl = uxSl;
+}
+/*-----------------------------------------------------------*/
+
+static BlockLink_t * prvSearchSuitableBlock( size_t xSize )
+{
+    UBaseType_t uxFl, uxSl;
+    uint32_t ulSlMap, ulFlMap;
+
+    /* Round the request up to the next size class so that any block in the
+     * list found is large enough, without walking the list. */
+    if( xSize >= heapSMALL_BLOCK_SIZE )
+    {
+        xSize += ( ( size_t ) 1 << ( heapFLS( xSize ) - heapSL_INDEX_COUNT_LOG2 ) ) - 1;
+    }
+
+    prvMappingInsert( xSize, &uxFl, &uxSl );
+
+    if( uxFl >= heapFL_INDEX_COUNT )
+    {
+        return NULL;
+    }
+
+    /* First look in the same first level list for a large enough class. */
+    ulSlMap = ulSlBitmap[ uxFl ] & ( ~0UL << uxSl );
+
+    if( ulSlMap == 0 )
+    {
+        /* Otherwise take the smallest class of any larger first level. */
+        ulFlMap = ulFlBitmap & ( ~0UL << ( uxFl + 1 ) );
+
+        if( ulFlMap == 0 )
+        {
+            return NULL;
+        }
+
+        uxFl = ( UBaseType_t ) heapFFS( ulFlMap );
+        ulSlMap = ulSlBitmap[ uxFl ];
+    }
+
+    uxSl = ( UBaseType_t ) heapFFS( ulSlMap );
+
+    return pxFreeLists[ uxFl ][ uxSl ];
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( BlockLink_t * pxBlock )
+{
+    UBaseType_t uxFl, uxSl;
+    BlockLink_t * pxHead;
+
+    prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFl, &uxSl );
+
+    pxHead = pxFreeLists[ uxFl ][ uxSl ];
+    pxBlock->pxNextFreeBlock = pxHead;
+    pxBlock->pxPrevFreeBlock = NULL;
+
+    if( pxHead != NULL )
+    {
+        pxHead->pxPrevFreeBlock = pxBlock;
+    }
+
+    pxFreeLists[ uxFl ][ uxSl ] = pxBlock;
+    ulFlBitmap |= ( 1UL << uxFl );
+    ulSlBitmap[ uxFl ] |= ( 1UL << uxSl );
+    pxBlock->xBlockSize |= heapBLOCK_FREE_BIT;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( BlockLink_t * pxBlock )
+{
+    UBaseType_t uxFl, uxSl;
+
+    prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFl, &uxSl );
+
+    if( pxBlock->pxNextFreeBlock != NULL )
+    {
+        pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock->pxPrevFreeBlock;
+    }
+
+    if( pxBlock->pxPrevFreeBlock != NULL )
+    {
+        pxBlock->pxPrevFreeBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+    }
+    else
+    {
+        /* The block was the head of its list. */
+        pxFreeLists[ uxFl ][ uxSl ] = pxBlock->pxNextFreeBlock;
+
+        if( pxBlock->pxNextFreeBlock == NULL )
+        {
+            ulSlBitmap[ uxFl ] &= ~( 1UL << uxSl );
+
+            if( ulSlBitmap[ uxFl ] == 0 )
+            {
+                ulFlBitmap &= ~( 1UL << uxFl );
+            }
+        }
+    }
+
+    pxBlock->xBlockSize &= ~heapBLOCK_FREE_BIT;
+}
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    BlockLink_t * pxBlock, * pxNewBlockLink;
+    size_t xBlockSize;
+    void * pvReturn = NULL;
+
+    vTaskSuspendAll();
+    {
+        /* If this is the first call to malloc then the heap will require
+         * initialisation to setup the list of free blocks. */
+        if( pxHeapEnd == NULL )
+        {
+            prvHeapInit();
+        }
+
+        /* The wanted size must be increased so it can contain the block
+         * header, rounded up to the alignment and to the smallest block that
+         * can be put back on a free list.  Check for overflow. */
+        if( ( xWantedSize > 0 ) &&
+            ( xWantedSize < ( ( size_t ) configTOTAL_HEAP_SIZE ) ) )
+        {
+            xWantedSize += heapSTRUCT_SIZE;
+            xWantedSize = ( xWantedSize + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+            if( xWantedSize < heapMINIMUM_BLOCK_SIZE )
+            {
+                xWantedSize = heapMINIMUM_BLOCK_SIZE;
+            }
+        }
+        else
+        {
+            xWantedSize = 0;
+        }
+
+        if( ( xWantedSize > 0 ) && ( xWantedSize <= xFreeBytesRemaining ) )
+        {
+            pxBlock = prvSearchSuitableBlock( xWantedSize );
+
+            if( pxBlock != NULL )
+            {
+                prvRemoveFreeBlock( pxBlock );
+                xBlockSize = heapBLOCK_SIZE( pxBlock );
+
+                /* If the block is larger than required it can be split into
+                 * two, and the remainder returned to the free lists. */
+                if( ( xBlockSize - xWantedSize ) >= heapMINIMUM_BLOCK_SIZE )
+                {
+                    pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+                    pxNewBlockLink->xBlockSize = xBlockSize - xWantedSize;
+                    pxNewBlockLink->pxPrevPhysBlock = pxBlock;
+                    heapNEXT_PHYS_BLOCK( pxNewBlockLink )->pxPrevPhysBlock = pxNewBlockLink;
+                    pxBlock->xBlockSize = xWantedSize;
+
+                    prvInsertFreeBlock( pxNewBlockLink );
+                }
+
+                xFreeBytesRemaining -= heapBLOCK_SIZE( pxBlock );
+
+                if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+                {
+                    xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+                }
+
+                pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + heapSTRUCT_SIZE );
+                xNumberOfSuccessfulAllocations++;
+            }
+        }
+
+        traceMALLOC( pvReturn, xWantedSize );
+    }
+    ( void ) xTaskResumeAll();
+
+    #if ( configUSE_MALLOC_FAILED_HOOK == 1 )
+        {
+            if( pvReturn == NULL )
+            {
+                extern void vApplicationMallocFailedHook( void );
+                vApplicationMallocFailedHook();
+            }
+        }
+    #endif
+
+    return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    uint8_t * puc = ( uint8_t * ) pv;
+    BlockLink_t * pxLink, * pxNeighbour;
+
+    if( pv != NULL )
+    {
+        /* The memory being freed will have a block header immediately before
+         * it.  The void cast keeps some compilers from issuing byte alignment
+         * warnings. */
+        puc -= heapSTRUCT_SIZE;
+        pxLink = ( void * ) puc;
+
+        configASSERT( !heapBLOCK_IS_FREE( pxLink ) );
+
+        vTaskSuspendAll();
+        {
+            xFreeBytesRemaining += heapBLOCK_SIZE( pxLink );
+            traceFREE( pv, heapBLOCK_SIZE( pxLink ) );
+
+            /* Merge with the block below if it is free. */
+            pxNeighbour = pxLink->pxPrevPhysBlock;
+
+            if( ( pxNeighbour != NULL ) && heapBLOCK_IS_FREE( pxNeighbour ) )
+            {
+                prvRemoveFreeBlock( pxNeighbour );
+                pxNeighbour->xBlockSize += heapBLOCK_SIZE( pxLink );
+                pxLink = pxNeighbour;
+            }
+
+            /* Merge with the block above if it is free. */
+            pxNeighbour = heapNEXT_PHYS_BLOCK( pxLink );
+
+            if( heapBLOCK_IS_FREE( pxNeighbour ) )
+            {
+                prvRemoveFreeBlock( pxNeighbour );
+                pxLink->xBlockSize += heapBLOCK_SIZE( pxNeighbour );
+            }
+
+            heapNEXT_PHYS_BLOCK( pxLink )->pxPrevPhysBlock = pxLink;
+            prvInsertFreeBlock( pxLink );
+            xNumberOfSuccessfulFrees++;
+        }
+        ( void ) xTaskResumeAll();
+    }
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+    return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+    return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+    /* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+    BlockLink_t * pxFirstFreeBlock;
+    uint8_t * pucAlignedHeap;
+    size_t xTotalHeapSize;
+
+    /* Ensure the heap starts on a correctly aligned boundary. */
+    pucAlignedHeap = ( uint8_t * ) ( ( ( portPOINTER_SIZE_TYPE ) & ucHeap[ portBYTE_ALIGNMENT ] ) & ( ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK ) ) );
+    xTotalHeapSize = ( ( size_t ) ( &ucHeap[ configTOTAL_HEAP_SIZE ] - pucAlignedHeap ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+    /* The end marker takes a header's worth of space at the top of the
+     * heap. */
+    xTotalHeapSize -= heapSTRUCT_SIZE;
+    pxHeapEnd = ( void * ) ( pucAlignedHeap + xTotalHeapSize );
+    pxHeapEnd->xBlockSize = 0;
+
+    /* To start with there is a single free block that is sized to take up the
+     * entire heap space. */
+    pxFirstFreeBlock = ( void * ) pucAlignedHeap;
+    pxFirstFreeBlock->pxPrevPhysBlock = NULL;
+    pxFirstFreeBlock->xBlockSize = xTotalHeapSize;
+    pxHeapEnd->pxPrevPhysBlock = pxFirstFreeBlock;
+    prvInsertFreeBlock( pxFirstFreeBlock );
+
+    xFreeBytesRemaining = xTotalHeapSize;
+    xMinimumEverFreeBytesRemaining = xTotalHeapSize;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t * pxHeapStats )
+{
+    BlockLink_t * pxBlock;
+    size_t xBlocks = 0, xMaxSize = 0, xMinSize = portMAX_DELAY; /* portMAX_DELAY used as a portable way of getting the maximum value. */
+
+    vTaskSuspendAll();
+    {
+        if( pxHeapEnd == NULL )
+        {
+            prvHeapInit();
+        }
+
+        /* Walk the heap in address order, looking at the free blocks. */
+        for( pxBlock = ( void * ) pxHeapEnd; pxBlock->pxPrevPhysBlock != NULL; pxBlock = pxBlock->pxPrevPhysBlock )
+        {
+            if( heapBLOCK_IS_FREE( pxBlock->pxPrevPhysBlock ) )
+            {
+                xBlocks++;
+
+                if( heapBLOCK_SIZE( pxBlock->pxPrevPhysBlock ) > xMaxSize )
+                {
+                    xMaxSize = heapBLOCK_SIZE( pxBlock->pxPrevPhysBlock );
+                }
+
+                if( heapBLOCK_SIZE( pxBlock->pxPrevPhysBlock ) < xMinSize )
+                {
+                    xMinSize = heapBLOCK_SIZE( pxBlock->pxPrevPhysBlock );
+                }
+            }
+        }
+
+        pxHeapStats->xSizeOfLargestFreeBlockInBytes = xMaxSize;
+        pxHeapStats->xSizeOfSmallestFreeBlockInBytes = ( xBlocks > 0 ) ? xMinSize : 0;
+        pxHeapStats->xNumberOfFreeBlocks = xBlocks;
+        pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+        pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+        pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+        pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
@@ -43,18 +43,56 @@
 
 #define INCLUDE_vTaskDelay 1
 
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
+
+#define INCLUDE_xTaskGetIdleTaskHandle 1
+
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle 1
+
+#define INCLUDE_xTaskGetCurrentTaskHandle 1 // Kernel benchmark notifies itself
+
+#define configUSE_TIMERS 1 // Periodic services listed in memmap.h
+
+#define configTIMER_TASK_PRIORITY 2 // Below the controller and rotor tasks in priorities.h
+
+#define configTIMER_QUEUE_LENGTH 4
+
+#define configTIMER_TASK_STACK_DEPTH configMINIMAL_STACK_SIZE
+
 #define configUSE_16_BIT_TICKS 0 // not sure what this is
 
 #define configKERNEL_INTERRUPT_PRIORITY (7 << 5) // Lowest priority for RTOS periodic interrupts
 
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY (1 << 5) // Leaves IRQ priority 0 for any non-RTOS Real Time interrupts
 
-#define configTOTAL_HEAP_SIZE (8 * 1024) // Adjustable - TM4C123 should support at least 24KB heap
+#define configSUPPORT_STATIC_ALLOCATION 1 // Objects listed in memmap.h are placed at link time
 
-#define configCPU_CLOCK_HZ 80000000UL // Full 80MHz clock
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+#define configTOTAL_HEAP_SIZE (2 * 1024) // Only used by objects outside memmap.h
+#else
+#define configTOTAL_HEAP_SIZE (12 * 1024) // Adjustable - TM4C123 should support at least 24KB heap
+#endif
+
+#define configCPU_CLOCK_HZ 50000000UL // main() sets the PLL for 50MHz
 
 #define configTICK_RATE_HZ 1000 // 1ms SysTick ticker
 
+#define configUSE_TICKLESS_IDLE 1 // Stop the tick while every task is blocked
+
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+
+/* Sleep counters and timing kept by idle.c. */
+void vIdlePreSleep (void);
+void vIdlePostSleep (void);
+void vIdleTicksSkipped (uint32_t);
+
+#define configPRE_SLEEP_PROCESSING( x ) vIdlePreSleep()
+#define configPOST_SLEEP_PROCESSING( x ) vIdlePostSleep()
+
+#define traceINCREASE_TICK_COUNT( x ) vIdleTicksSkipped( x )
+
 
 
 
@@ -0,0 +1,909 @@
+/*
+ * File: bench.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: On-target benchmarks. The queue benchmark runs each operation
+ * many times with the scheduler suspended and reports the mean cost in CPU
+ * cycles. The kernel benchmark measures the primitives the heli tasks use:
+ * semaphore and notification cost, ISR to task wake latency and context
+ * switch time. A high priority bench task is woken from a software
+ * triggered interrupt or from the console task, and the cycle counter is
+ * read on each side. Interrupts stay enabled, so the encoder and ADC add a
+ * little noise.
+ *
+ * The pool stress test has a timer interrupt and the console task allocate
+ * and free blocks of one pool at the same time, and checks that no block is
+ * ever held by both and that the pool's counters balance afterwards.
+ *
+ * The heap benchmark replays the same pseudo-random allocate and free trace
+ * through pvPortMalloc and vPortFree and through a copy of the heap_2.c
+ * algorithm the heap replaced, each in an arena of BENCH_HEAP_BYTES, and
+ * compares the failures, fragmentation and cycles per call.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "utils/uartstdio.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "bench.h"
+#include "cycles.h"
+#include "memmap.h"
+#include "mempool.h"
+#include "refqueue.h"
+#include "debugger.h"
+#include "priorities.h"
+
+//*****************************************************************************
+//
+// Number of passes averaged for each result.
+//
+//*****************************************************************************
+#define BENCH_QUEUE_ITERATIONS      100
+#define BENCH_WAKE_ITERATIONS       32
+
+//*****************************************************************************
+//
+// The pool stress test. TIMER2A, unused by the heli, interrupts the console
+// task at BENCH_POOL_INT_HZ, so the interrupt lands at arbitrary points in
+// its pool calls. Each side holds up to BENCH_POOL_HOLD blocks, so together
+// they can empty the pool.
+//
+//*****************************************************************************
+#define BENCH_POOL_TIMER_BASE       TIMER2_BASE
+#define BENCH_POOL_TIMER_PERIPH     SYSCTL_PERIPH_TIMER2
+#define BENCH_POOL_INT              INT_TIMER2A
+#define BENCH_POOL_INT_HZ           20000
+#define BENCH_POOL_MS               500
+#define BENCH_POOL_BLOCKS           6
+#define BENCH_POOL_HOLD             4
+#define BENCH_POOL_TASK             1       // Owner tags
+#define BENCH_POOL_ISR              2
+
+//*****************************************************************************
+//
+// The heap trace. Each operation picks a slot: a live slot is freed, an
+// empty one is allocated. Three requests in four are 8 to 64 bytes, the
+// rest 64 to 224 bytes. The trace decides which slots are live, so both
+// heaps see exactly the same calls even when an allocation fails.
+//
+//*****************************************************************************
+#define BENCH_HEAP_BYTES            1024        // Arena given to each heap
+#define BENCH_HEAP_HEADER           8           // Block header of both heaps on the M4
+#define BENCH_HEAP_SLOTS            16
+#define BENCH_HEAP_OPS              2000
+#define BENCH_HEAP_SEED             0x2545F491
+
+//*****************************************************************************
+//
+// Unused interrupt that is pended in software to wake the bench task. UART1
+// is not used by the heli.
+//
+//*****************************************************************************
+#define BENCH_INT                   INT_UART1
+
+//*****************************************************************************
+//
+// Storage for the queue benchmark. The reference queue's pool has a single
+// block big enough for the largest message.
+//
+//*****************************************************************************
+static QueueHandle_t g_xBenchCopy4;
+static QueueHandle_t g_xBenchCopy32;
+static QueueHandle_t g_xBenchCopy256;
+static REFQUEUE g_sBenchRefQueue;
+static MEMPOOL g_sBenchPool;
+static BENCH_MSG_256 g_sBenchBlock;
+static BENCH_MSG_256 g_sBenchMessage;
+static bool g_bBenchQueuesReady = false;
+
+//*****************************************************************************
+//
+// State for the kernel benchmark. The bench task blocks on the semaphore or
+// on its notification, depending on g_bBenchUseSemaphore.
+//
+//*****************************************************************************
+static TaskHandle_t g_xBenchTask = NULL;
+static SemaphoreHandle_t g_xBenchSemaphore;
+static volatile bool g_bBenchUseSemaphore = false;
+static volatile uint32_t g_ui32BenchIsrCycles;
+static volatile uint32_t g_ui32BenchWakeCycles;
+
+//*****************************************************************************
+//
+// State for the pool stress test. Each side keeps the blocks it holds, and
+// every block is tagged with its holder while held. Each block also holds
+// its holder's tag, checked before it is freed.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t *ppui32Held[BENCH_POOL_HOLD];
+    uint32_t ui32Held;
+    uint32_t ui32Seed;
+    uint32_t ui32Allocs;
+    uint32_t ui32Frees;
+    uint32_t ui32Failures;
+    uint32_t ui32Duplicates;    // Blocks already held by someone
+    uint32_t ui32Corrupt;       // Blocks changed while held
+} BENCH_POOL_SIDE;
+
+static MEMPOOL g_sStressPool;
+static uint32_t g_pui32StressBlocks[BENCH_POOL_BLOCKS];
+static volatile uint8_t g_pui8StressOwner[BENCH_POOL_BLOCKS];
+static BENCH_POOL_SIDE g_sStressTask;
+static BENCH_POOL_SIDE g_sStressIsr;
+static volatile uint32_t g_ui32StressIsrRuns;
+
+//*****************************************************************************
+//
+// Model of heap_2.c for the heap benchmark: a free list sorted by size,
+// searched for the first block that fits, and blocks that are never merged.
+// The list is bounded by the start and end markers.
+//
+//*****************************************************************************
+typedef struct BENCH_HEAP2_BLOCK {
+    struct BENCH_HEAP2_BLOCK *psNext;
+    size_t xSize;
+} BENCH_HEAP2_BLOCK;
+
+#define BENCH_HEAP2_STRUCT          ((sizeof(BENCH_HEAP2_BLOCK) + portBYTE_ALIGNMENT_MASK) & ~portBYTE_ALIGNMENT_MASK)
+#define BENCH_HEAP2_MIN_BLOCK       (BENCH_HEAP2_STRUCT * 2)
+
+static BENCH_HEAP2_BLOCK g_sHeap2Start;
+static BENCH_HEAP2_BLOCK g_sHeap2End;
+static size_t g_xHeap2Free;
+
+//*****************************************************************************
+//
+// Struct for the result of replaying the heap trace.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Fails;         // Allocations that returned NULL
+    uint32_t ui32Cycles;        // Mean cycles per call
+    size_t xFree;               // With the trace's last blocks still allocated
+    size_t xLargest;
+    size_t xBlocks;             // Free blocks
+    size_t xEndLargest;         // Largest free block once all are freed
+} BENCH_HEAP_RESULT;
+
+typedef struct {
+    size_t xFree;
+    size_t xLargest;
+    size_t xBlocks;
+} BENCH_HEAP_STATS;
+
+//*****************************************************************************
+//
+// Struct for a set of latency samples, in cycles.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Min;
+    uint32_t ui32Max;
+    uint32_t ui32Total;
+} BENCH_LATENCY;
+
+//*****************************************************************************
+//
+// Mean cycles to send a message by value and receive it again.
+//
+//*****************************************************************************
+static uint32_t
+ui32BenchCopy (QueueHandle_t xQueue)
+{
+    uint32_t ui32Start;
+    uint32_t i;
+
+    ui32Start = CyclesGet();
+    for (i = 0; i < BENCH_QUEUE_ITERATIONS; i++)
+    {
+        xQueueSend(xQueue, &g_sBenchMessage, 0);
+        xQueueReceive(xQueue, &g_sBenchMessage, 0);
+    }
+
+    return (CyclesGet() - ui32Start) / BENCH_QUEUE_ITERATIONS;
+}
+
+//*****************************************************************************
+//
+// Mean cycles to take a pool block, send it by reference, receive it and
+// release it. Independent of the message size.
+//
+//*****************************************************************************
+static uint32_t
+ui32BenchRef (void)
+{
+    uint32_t ui32Start;
+    uint32_t i;
+    void *pvMessage;
+
+    ui32Start = CyclesGet();
+    for (i = 0; i < BENCH_QUEUE_ITERATIONS; i++)
+    {
+        pvMessage = pvRefQueueAlloc(&g_sBenchRefQueue);
+        xRefQueueSend(&g_sBenchRefQueue, pvMessage, 0);
+        xRefQueueReceive(&g_sBenchRefQueue, &pvMessage, 0);
+        vRefQueueRelease(&g_sBenchRefQueue, pvMessage);
+    }
+
+    return (CyclesGet() - ui32Start) / BENCH_QUEUE_ITERATIONS;
+}
+
+//*****************************************************************************
+//
+// Bench task. Records the cycle count each time it is woken.
+//
+//*****************************************************************************
+static void
+BenchTask (void *pvParameters)
+{
+    while (1)
+    {
+        if (g_bBenchUseSemaphore)
+        {
+            xSemaphoreTake(g_xBenchSemaphore, portMAX_DELAY);
+        }
+        else
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        g_ui32BenchWakeCycles = CyclesGet();
+    }
+}
+
+//*****************************************************************************
+//
+// Software triggered interrupt. Wakes the bench task the same way the yaw
+// and ADC interrupts wake their tasks.
+//
+//*****************************************************************************
+static void
+vBenchIntHandler (void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    g_ui32BenchIsrCycles = CyclesGet();
+
+    if (g_bBenchUseSemaphore)
+    {
+        xSemaphoreGiveFromISR(g_xBenchSemaphore, &xHigherPriorityTaskWoken);
+    }
+    else
+    {
+        vTaskNotifyGiveFromISR(g_xBenchTask, &xHigherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+//*****************************************************************************
+//
+// Makes the bench task wait on the semaphore or its notification. It is
+// woken once so that it blocks on the new one.
+//
+//*****************************************************************************
+static void
+vBenchWaitOn (bool bSemaphore)
+{
+    bool bOld = g_bBenchUseSemaphore;
+
+    g_bBenchUseSemaphore = bSemaphore;
+    if (bOld)
+    {
+        xSemaphoreGive(g_xBenchSemaphore);
+    }
+    else
+    {
+        xTaskNotifyGive(g_xBenchTask);
+    }
+}
+
+static void
+vBenchRecord (BENCH_LATENCY *psLatency, uint32_t ui32Cycles)
+{
+    if (ui32Cycles < psLatency->ui32Min)
+    {
+        psLatency->ui32Min = ui32Cycles;
+    }
+    if (ui32Cycles > psLatency->ui32Max)
+    {
+        psLatency->ui32Max = ui32Cycles;
+    }
+    psLatency->ui32Total += ui32Cycles;
+}
+
+static void
+vBenchPrint (const char *pcName, const BENCH_LATENCY *psLatency)
+{
+    UARTprintf("%16s %6u %6u %6u\n", pcName, psLatency->ui32Min,
+               psLatency->ui32Total / BENCH_WAKE_ITERATIONS, psLatency->ui32Max);
+}
+
+//*****************************************************************************
+//
+// Pends the bench interrupt repeatedly. The bench task has a higher priority
+// than the console, so it has run by the time IntPendSet returns. Records the
+// cycles to the interrupt and to the task.
+//
+//*****************************************************************************
+static void
+vBenchIsrWake (BENCH_LATENCY *psIsr, BENCH_LATENCY *psTask)
+{
+    uint32_t ui32Start;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_WAKE_ITERATIONS; i++)
+    {
+        ui32Start = CyclesGet();
+        IntPendSet(BENCH_INT);
+        vBenchRecord(psIsr, g_ui32BenchIsrCycles - ui32Start);
+        vBenchRecord(psTask, g_ui32BenchWakeCycles - ui32Start);
+    }
+}
+
+//*****************************************************************************
+//
+// Creates the bench task and interrupt. Returns 0 on success, 1 on failure.
+//
+//*****************************************************************************
+uint32_t
+InitBenchTask (void)
+{
+    g_xBenchSemaphore = xMemMapSemaphoreCreateBinary(MEMMAP_SEMAPHORE_BENCH);
+
+    if(xMemMapTaskCreate(MEMMAP_TASK_BENCH, BenchTask, NULL,
+                   tskIDLE_PRIORITY + BENCHTASKPRIORITY, &g_xBenchTask) != pdTRUE)
+    {
+        return(1);
+    }
+
+    IntRegister(BENCH_INT, vBenchIntHandler);
+    IntPrioritySet(BENCH_INT, BENCH_INT_PRIORITY);
+    IntEnable(BENCH_INT);
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Measures semaphore and notification cost, ISR to task latency and context
+// switch time.
+//
+//*****************************************************************************
+void
+vBenchKernel (void)
+{
+    BENCH_LATENCY sSemIsr = { UINT32_MAX, 0, 0 }, sSemTask = { UINT32_MAX, 0, 0 };
+    BENCH_LATENCY sNotifyIsr = { UINT32_MAX, 0, 0 }, sNotifyTask = { UINT32_MAX, 0, 0 };
+    BENCH_LATENCY sSwitch = { UINT32_MAX, 0, 0 };
+    uint32_t ui32Semaphore, ui32Notify;
+    uint32_t ui32Start;
+    uint32_t i;
+
+    CyclesInit();
+
+    //
+    // Give and take without a context switch. The bench task is waiting on
+    // its notification, so nothing else is woken by the semaphore.
+    //
+    vBenchWaitOn(false);
+    vTaskSuspendAll();
+    ui32Start = CyclesGet();
+    for (i = 0; i < BENCH_QUEUE_ITERATIONS; i++)
+    {
+        xSemaphoreGive(g_xBenchSemaphore);
+        xSemaphoreTake(g_xBenchSemaphore, 0);
+    }
+    ui32Semaphore = (CyclesGet() - ui32Start) / BENCH_QUEUE_ITERATIONS;
+
+    ui32Start = CyclesGet();
+    for (i = 0; i < BENCH_QUEUE_ITERATIONS; i++)
+    {
+        xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+        ulTaskNotifyTake(pdTRUE, 0);
+    }
+    ui32Notify = (CyclesGet() - ui32Start) / BENCH_QUEUE_ITERATIONS;
+    xTaskResumeAll();
+
+    //
+    // Task to task: notify the bench task and time until it runs.
+    //
+    for (i = 0; i < BENCH_WAKE_ITERATIONS; i++)
+    {
+        ui32Start = CyclesGet();
+        xTaskNotifyGive(g_xBenchTask);
+        vBenchRecord(&sSwitch, g_ui32BenchWakeCycles - ui32Start);
+    }
+
+    //
+    // Interrupt to task, by notification and then by semaphore.
+    //
+    vBenchIsrWake(&sNotifyIsr, &sNotifyTask);
+    vBenchWaitOn(true);
+    vBenchIsrWake(&sSemIsr, &sSemTask);
+    vBenchWaitOn(false);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("give+take cycles: semaphore %u notification %u\n", ui32Semaphore, ui32Notify);
+    UARTprintf("cycles                 min    avg    max\n");
+    vBenchPrint("notify task", &sSwitch);
+    vBenchPrint("isr notify entry", &sNotifyIsr);
+    vBenchPrint("isr notify task", &sNotifyTask);
+    vBenchPrint("isr sem entry", &sSemIsr);
+    vBenchPrint("isr sem task", &sSemTask);
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+//*****************************************************************************
+//
+// Returns the oldest block held by one side of the stress test, checking
+// that it is still tagged as that side's.
+//
+//*****************************************************************************
+static void
+vBenchPoolFree (BENCH_POOL_SIDE *psSide, uint8_t ui8Owner)
+{
+    uint32_t *pui32Block = psSide->ppui32Held[0];
+    uint32_t ui32Index = pui32Block - g_pui32StressBlocks;
+    uint32_t i;
+
+    if (*pui32Block != ui8Owner || g_pui8StressOwner[ui32Index] != ui8Owner)
+    {
+        psSide->ui32Corrupt++;
+    }
+    g_pui8StressOwner[ui32Index] = 0;
+    vMemPoolFree(&g_sStressPool, pui32Block);
+    psSide->ui32Frees++;
+
+    psSide->ui32Held--;
+    for (i = 0; i < psSide->ui32Held; i++)
+    {
+        psSide->ppui32Held[i] = psSide->ppui32Held[i + 1];
+    }
+}
+
+//*****************************************************************************
+//
+// One pool operation for one side of the stress test: free its oldest block
+// or take a new one, at random.
+//
+//*****************************************************************************
+static void
+vBenchPoolStep (BENCH_POOL_SIDE *psSide, uint8_t ui8Owner)
+{
+    uint32_t *pui32Block;
+    uint32_t ui32Index;
+
+    psSide->ui32Seed ^= psSide->ui32Seed << 13;
+    psSide->ui32Seed ^= psSide->ui32Seed >> 17;
+    psSide->ui32Seed ^= psSide->ui32Seed << 5;
+
+    if (psSide->ui32Held == BENCH_POOL_HOLD || (psSide->ui32Held > 0 && (psSide->ui32Seed & 1)))
+    {
+        vBenchPoolFree(psSide, ui8Owner);
+        return;
+    }
+
+    pui32Block = pvMemPoolAlloc(&g_sStressPool);
+    if (pui32Block == NULL)
+    {
+        psSide->ui32Failures++;
+        return;
+    }
+    psSide->ui32Allocs++;
+
+    ui32Index = pui32Block - g_pui32StressBlocks;
+    if (g_pui8StressOwner[ui32Index] != 0)
+    {
+        psSide->ui32Duplicates++;
+    }
+    g_pui8StressOwner[ui32Index] = ui8Owner;
+    *pui32Block = ui8Owner;
+    psSide->ppui32Held[psSide->ui32Held++] = pui32Block;
+}
+
+//*****************************************************************************
+//
+// Timer interrupt of the stress test. Uses the pool from interrupt context.
+//
+//*****************************************************************************
+static void
+vBenchPoolIntHandler (void)
+{
+    TimerIntClear(BENCH_POOL_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    vBenchPoolStep(&g_sStressIsr, BENCH_POOL_ISR);
+    g_ui32StressIsrRuns++;
+}
+
+//*****************************************************************************
+//
+// Puts a block on the heap_2 model's free list, in size order.
+//
+//*****************************************************************************
+static void
+vHeap2Insert (BENCH_HEAP2_BLOCK *psBlock)
+{
+    BENCH_HEAP2_BLOCK *psIter = &g_sHeap2Start;
+
+    while (psIter->psNext->xSize < psBlock->xSize)
+    {
+        psIter = psIter->psNext;
+    }
+    psBlock->psNext = psIter->psNext;
+    psIter->psNext = psBlock;
+}
+
+//*****************************************************************************
+//
+// Starts the heap_2 model with one free block over the arena, which must be
+// aligned, as memory from pvPortMalloc is.
+//
+//*****************************************************************************
+static void
+vHeap2Init (void *pvArena, size_t xBytes)
+{
+    BENCH_HEAP2_BLOCK *psFirst = (BENCH_HEAP2_BLOCK *) pvArena;
+
+    xBytes &= ~((size_t) portBYTE_ALIGNMENT_MASK);
+
+    g_sHeap2Start.psNext = &g_sHeap2End;
+    g_sHeap2Start.xSize = 0;
+    g_sHeap2End.psNext = NULL;
+    g_sHeap2End.xSize = xBytes;
+
+    psFirst->xSize = xBytes;
+    vHeap2Insert(psFirst);
+    g_xHeap2Free = xBytes;
+}
+
+static void *
+pvHeap2Malloc (size_t xWantedSize)
+{
+    BENCH_HEAP2_BLOCK *psPrev = &g_sHeap2Start;
+    BENCH_HEAP2_BLOCK *psBlock = g_sHeap2Start.psNext;
+    BENCH_HEAP2_BLOCK *psSplit;
+
+    xWantedSize += BENCH_HEAP2_STRUCT;
+    xWantedSize = (xWantedSize + portBYTE_ALIGNMENT_MASK) & ~((size_t) portBYTE_ALIGNMENT_MASK);
+    if (xWantedSize >= g_sHeap2End.xSize)
+    {
+        return NULL;
+    }
+
+    while (psBlock->xSize < xWantedSize && psBlock->psNext != NULL)
+    {
+        psPrev = psBlock;
+        psBlock = psBlock->psNext;
+    }
+    if (psBlock == &g_sHeap2End)
+    {
+        return NULL;
+    }
+
+    psPrev->psNext = psBlock->psNext;
+
+    if (psBlock->xSize - xWantedSize > BENCH_HEAP2_MIN_BLOCK)
+    {
+        psSplit = (BENCH_HEAP2_BLOCK *) ((uint8_t *) psBlock + xWantedSize);
+        psSplit->xSize = psBlock->xSize - xWantedSize;
+        psBlock->xSize = xWantedSize;
+        vHeap2Insert(psSplit);
+    }
+
+    g_xHeap2Free -= psBlock->xSize;
+    return (uint8_t *) psBlock + BENCH_HEAP2_STRUCT;
+}
+
+static void
+vHeap2Free (void *pv)
+{
+    BENCH_HEAP2_BLOCK *psBlock;
+
+    if (pv != NULL)
+    {
+        psBlock = (BENCH_HEAP2_BLOCK *) ((uint8_t *) pv - BENCH_HEAP2_STRUCT);
+        g_xHeap2Free += psBlock->xSize;
+        vHeap2Insert(psBlock);
+    }
+}
+
+//*****************************************************************************
+//
+// Free bytes and blocks of each heap. Block sizes include the header, as
+// vPortGetHeapStats reports them.
+//
+//*****************************************************************************
+static void
+vHeap2Stats (BENCH_HEAP_STATS *psStats)
+{
+    BENCH_HEAP2_BLOCK *psBlock;
+
+    psStats->xFree = g_xHeap2Free;
+    psStats->xLargest = 0;
+    psStats->xBlocks = 0;
+    for (psBlock = g_sHeap2Start.psNext; psBlock != &g_sHeap2End; psBlock = psBlock->psNext)
+    {
+        psStats->xLargest = psBlock->xSize;         // Sorted, so the last is largest
+        psStats->xBlocks++;
+    }
+}
+
+static void
+vTlsfStats (BENCH_HEAP_STATS *psStats)
+{
+    HeapStats_t xStats;
+
+    vPortGetHeapStats(&xStats);
+    psStats->xFree = xStats.xAvailableHeapSpaceInBytes;
+    psStats->xLargest = xStats.xSizeOfLargestFreeBlockInBytes;
+    psStats->xBlocks = xStats.xNumberOfFreeBlocks;
+}
+
+//*****************************************************************************
+//
+// Replays the heap trace through one heap, then frees what is left. Runs
+// with the scheduler suspended so no other task uses the heap meanwhile.
+//
+//*****************************************************************************
+static void
+vBenchHeapReplay (void *(*pfnMalloc)(size_t), void (*pfnFree)(void *),
+                  void (*pfnStats)(BENCH_HEAP_STATS *), BENCH_HEAP_RESULT *psResult)
+{
+    void *ppvSlots[BENCH_HEAP_SLOTS] = { NULL };
+    uint32_t ui32Live = 0;                      // Slots the trace has allocated
+    uint32_t ui32Seed = BENCH_HEAP_SEED;
+    uint32_t ui32Cycles = 0;
+    uint32_t ui32Start;
+    uint32_t ui32Slot;
+    size_t xSize;
+    BENCH_HEAP_STATS sStats;
+    uint32_t i;
+
+    psResult->ui32Fails = 0;
+
+    vTaskSuspendAll();
+    for (i = 0; i < BENCH_HEAP_OPS; i++)
+    {
+        ui32Seed ^= ui32Seed << 13;
+        ui32Seed ^= ui32Seed >> 17;
+        ui32Seed ^= ui32Seed << 5;
+
+        ui32Slot = ui32Seed % BENCH_HEAP_SLOTS;
+        if (ui32Live & (1 << ui32Slot))
+        {
+            ui32Start = CyclesGet();
+            pfnFree(ppvSlots[ui32Slot]);
+            ui32Cycles += CyclesGet() - ui32Start;
+            ppvSlots[ui32Slot] = NULL;
+        }
+        else
+        {
+            xSize = ((ui32Seed >> 8) & 3) ? 8 + ((ui32Seed >> 10) & 7) * 8
+                                          : 64 + ((ui32Seed >> 10) % 6) * 32;
+            ui32Start = CyclesGet();
+            ppvSlots[ui32Slot] = pfnMalloc(xSize);
+            ui32Cycles += CyclesGet() - ui32Start;
+            if (ppvSlots[ui32Slot] == NULL)
+            {
+                psResult->ui32Fails++;
+            }
+        }
+        ui32Live ^= 1 << ui32Slot;
+    }
+
+    pfnStats(&sStats);
+    psResult->xFree = sStats.xFree;
+    psResult->xLargest = sStats.xLargest;
+    psResult->xBlocks = sStats.xBlocks;
+
+    for (i = 0; i < BENCH_HEAP_SLOTS; i++)
+    {
+        pfnFree(ppvSlots[i]);
+    }
+    pfnStats(&sStats);
+    psResult->xEndLargest = sStats.xLargest;
+    xTaskResumeAll();
+
+    psResult->ui32Cycles = ui32Cycles / BENCH_HEAP_OPS;
+}
+
+static void
+vBenchHeapPrint (const char *pcName, const BENCH_HEAP_RESULT *psResult)
+{
+    UARTprintf("%8s %6u %6u %6u %6u %6u %6u\n", pcName, psResult->ui32Fails,
+               psResult->xFree, psResult->xLargest, psResult->xBlocks,
+               psResult->xEndLargest, psResult->ui32Cycles);
+}
+
+//*****************************************************************************
+//
+// Replays the heap trace through the heap_2 model and through the TLSF heap.
+// The model's arena is allocated from the heap. For the TLSF heap, all but
+// BENCH_HEAP_BYTES of the free heap is held by one block while the trace
+// runs. This assumes the free heap is one block, which it is while the
+// kernel objects are in memmap.h.
+//
+//*****************************************************************************
+void
+vBenchHeap (void)
+{
+    BENCH_HEAP_RESULT sHeap2, sTlsf;
+    void *pvArena;
+    void *pvBallast = NULL;
+    size_t xFree;
+
+    CyclesInit();
+
+    pvArena = pvPortMalloc(BENCH_HEAP_BYTES);
+    xFree = xPortGetFreeHeapSize() + BENCH_HEAP_BYTES + BENCH_HEAP_HEADER; // Set once the heap is started
+    if (pvArena == NULL)
+    {
+        xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+        UARTprintf("heap bench needs %u free bytes\n", BENCH_HEAP_BYTES + BENCH_HEAP_HEADER);
+        xSemaphoreGive(xUARTSemaphore);
+        return;
+    }
+    vHeap2Init(pvArena, BENCH_HEAP_BYTES);
+    vBenchHeapReplay(pvHeap2Malloc, vHeap2Free, vHeap2Stats, &sHeap2);
+    vPortFree(pvArena);
+
+    if (xFree > BENCH_HEAP_BYTES + BENCH_HEAP_HEADER)
+    {
+        pvBallast = pvPortMalloc(xFree - BENCH_HEAP_BYTES - BENCH_HEAP_HEADER);
+    }
+    vBenchHeapReplay(pvPortMalloc, vPortFree, vTlsfStats, &sTlsf);
+    vPortFree(pvBallast);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("heap trace: %u calls, %u slots, %u byte arena\n", BENCH_HEAP_OPS,
+               BENCH_HEAP_SLOTS, BENCH_HEAP_BYTES);
+    UARTprintf("            fails   free largest blocks  after cycles\n");
+    vBenchHeapPrint("heap_2", &sHeap2);
+    vBenchHeapPrint("tlsf", &sTlsf);
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+//*****************************************************************************
+//
+// Runs the pool stress test for BENCH_POOL_MS, then frees every held block
+// and checks the counts. The console task spins for the whole run, so lower
+// priority tasks are held off.
+//
+//*****************************************************************************
+void
+vBenchPool (void)
+{
+    BENCH_POOL_SIDE *psSides[2] = { &g_sStressTask, &g_sStressIsr };
+    MEMPOOL_STATS sStats;
+    TickType_t xStart;
+    uint32_t ui32Duplicates, ui32Corrupt;
+    bool bBalanced;
+    uint32_t i;
+
+    vMemPoolInit(&g_sStressPool, g_pui32StressBlocks, sizeof(g_pui32StressBlocks[0]), BENCH_POOL_BLOCKS);
+    for (i = 0; i < BENCH_POOL_BLOCKS; i++)
+    {
+        g_pui8StressOwner[i] = 0;
+    }
+    memset(&g_sStressTask, 0, sizeof(g_sStressTask));
+    memset(&g_sStressIsr, 0, sizeof(g_sStressIsr));
+    g_sStressTask.ui32Seed = 0x2545F491;
+    g_sStressIsr.ui32Seed = 0x9E3779B9;
+    g_ui32StressIsrRuns = 0;
+
+    SysCtlPeripheralEnable(BENCH_POOL_TIMER_PERIPH);
+    while (!SysCtlPeripheralReady(BENCH_POOL_TIMER_PERIPH))
+    {
+    }
+    TimerConfigure(BENCH_POOL_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(BENCH_POOL_TIMER_BASE, TIMER_A, SysCtlClockGet() / BENCH_POOL_INT_HZ - 1);
+    IntRegister(BENCH_POOL_INT, vBenchPoolIntHandler);
+    IntPrioritySet(BENCH_POOL_INT, BENCH_INT_PRIORITY);
+    TimerIntEnable(BENCH_POOL_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    IntEnable(BENCH_POOL_INT);
+    TimerEnable(BENCH_POOL_TIMER_BASE, TIMER_A);
+
+    xStart = xTaskGetTickCount();
+    while ((xTaskGetTickCount() - xStart) < pdMS_TO_TICKS(BENCH_POOL_MS))
+    {
+        vBenchPoolStep(&g_sStressTask, BENCH_POOL_TASK);
+    }
+
+    TimerDisable(BENCH_POOL_TIMER_BASE, TIMER_A);
+    IntDisable(BENCH_POOL_INT);
+    TimerIntDisable(BENCH_POOL_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    SysCtlPeripheralDisable(BENCH_POOL_TIMER_PERIPH);
+
+    //
+    // Return every held block, checking each as it goes.
+    //
+    for (i = 0; i < 2; i++)
+    {
+        while (psSides[i]->ui32Held > 0)
+        {
+            vBenchPoolFree(psSides[i], (i == 0) ? BENCH_POOL_TASK : BENCH_POOL_ISR);
+        }
+    }
+
+    vMemPoolGetStats(&g_sStressPool, &sStats);
+    ui32Duplicates = g_sStressTask.ui32Duplicates + g_sStressIsr.ui32Duplicates;
+    ui32Corrupt = g_sStressTask.ui32Corrupt + g_sStressIsr.ui32Corrupt;
+    bBalanced = (sStats.ui32InUse == 0
+                 && g_sStressPool.ui32FreeMask == (1U << BENCH_POOL_BLOCKS) - 1
+                 && sStats.ui32Allocs == g_sStressTask.ui32Allocs + g_sStressIsr.ui32Allocs
+                 && sStats.ui32Failures == g_sStressTask.ui32Failures + g_sStressIsr.ui32Failures
+                 && g_sStressTask.ui32Allocs == g_sStressTask.ui32Frees
+                 && g_sStressIsr.ui32Allocs == g_sStressIsr.ui32Frees);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("pool stress: %u ms, %u interrupts, %u blocks\n", BENCH_POOL_MS,
+               g_ui32StressIsrRuns, BENCH_POOL_BLOCKS);
+    UARTprintf("       allocs failures\n");
+    UARTprintf("task %8u %8u\n", g_sStressTask.ui32Allocs, g_sStressTask.ui32Failures);
+    UARTprintf("isr  %8u %8u\n", g_sStressIsr.ui32Allocs, g_sStressIsr.ui32Failures);
+    UARTprintf("peak %u, duplicates %u, corrupt %u, counts %s\n", sStats.ui32Peak,
+               ui32Duplicates, ui32Corrupt, bBalanced ? "balance" : "DO NOT BALANCE");
+    UARTprintf("%s\n", (ui32Duplicates == 0 && ui32Corrupt == 0 && bBalanced) ? "PASS" : "FAIL");
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+//*****************************************************************************
+//
+// Compares passing 4, 32 and 256 byte messages through a queue by value
+// against passing a pool block by reference.
+//
+//*****************************************************************************
+void
+vBenchQueues (void)
+{
+    uint32_t pui32Copy[3];
+    uint32_t ui32Ref;
+
+    if (!g_bBenchQueuesReady)
+    {
+        CyclesInit();
+        g_xBenchCopy4 = xMemMapQueueCreate(MEMMAP_QUEUE_BENCH_4);
+        g_xBenchCopy32 = xMemMapQueueCreate(MEMMAP_QUEUE_BENCH_32);
+        g_xBenchCopy256 = xMemMapQueueCreate(MEMMAP_QUEUE_BENCH_256);
+        vMemPoolInit(&g_sBenchPool, &g_sBenchBlock, sizeof(g_sBenchBlock), 1);
+        vRefQueueInit(&g_sBenchRefQueue, xMemMapQueueCreate(MEMMAP_QUEUE_BENCH_REF), &g_sBenchPool);
+        g_bBenchQueuesReady = true;
+    }
+
+    vTaskSuspendAll();
+    pui32Copy[0] = ui32BenchCopy(g_xBenchCopy4);
+    pui32Copy[1] = ui32BenchCopy(g_xBenchCopy32);
+    pui32Copy[2] = ui32BenchCopy(g_xBenchCopy256);
+    ui32Ref = ui32BenchRef();
+    xTaskResumeAll();
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("send+receive cycles, copy vs reference\n");
+    UARTprintf("  4 bytes: %5u %5u\n", pui32Copy[0], ui32Ref);
+    UARTprintf(" 32 bytes: %5u %5u\n", pui32Copy[1], ui32Ref);
+    UARTprintf("256 bytes: %5u %5u\n", pui32Copy[2], ui32Ref);
+    xSemaphoreGive(xUARTSemaphore);
+}
@@ -0,0 +1,45 @@
+/*
+ * File: bench.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the on-target benchmarks. The benchmarks time
+ * kernel operations with the DWT cycle counter and print the results over the
+ * UART. They are run from the console.
+ *
+ *
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+//*****************************************************************************
+//
+// Message sizes compared by the queue benchmark.
+//
+//*****************************************************************************
+typedef struct { uint8_t pui8Data[4]; } BENCH_MSG_4;
+typedef struct { uint8_t pui8Data[32]; } BENCH_MSG_32;
+typedef struct { uint8_t pui8Data[256]; } BENCH_MSG_256;
+
+//*****************************************************************************
+//
+// Prototypes for the bench module.
+//
+//*****************************************************************************
+void vBenchQueues (void);
+void vBenchKernel (void);
+void vBenchHeap (void);
+void vBenchPool (void);
+uint32_t InitBenchTask (void);
+
+#endif /* BENCH_H_ */
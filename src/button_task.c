@@ -12,7 +12,9 @@
  * Created on: 28.08.21
  *
  * Description: This module is responsible for reading the up, down, left and right buttons. The
- * reference values for the height and yaw are updated in response.
+ * reference values for the height and yaw are updated in response. Moving the mode switch
+ * cycles the display between its views. The buttons are interrupt driven, so the task
+ * only runs when buttons4.c reports a debounced change or an auto-repeat.
  *
  *
  */
@@ -35,6 +37,8 @@
 #include "buttons4.h"
 #include "button_task.h"
 #include "debugger.h"
+#include "display.h"
+#include "memmap.h"
 #include "priorities.h"
 
 //*****************************************************************************
@@ -45,13 +49,8 @@
 static int16_t g_i16RefAngle = 0;
 static int16_t g_i16RefHeight = 0;
 static uint8_t g_ui8ButPushed = 0;
-
-//*****************************************************************************
-//
-// The stack size for the button task.
-//
-//*****************************************************************************
-#define BUTTONTASKSTACKSIZE        128         // Stack size in words
+static uint8_t g_ui8Held = 0;               // Buttons pressed and not yet released
+static TaskHandle_t g_xButtonTask = NULL;
 
 //*****************************************************************************
 //
@@ -66,6 +65,8 @@ uint8_t CheckHeightButtons (void);
 static void SetRefYaw (int16_t value);
 static void SetRefHeight (int16_t value);
 static void SetButPushed (uint8_t);
+static bool bNewPress (uint8_t butName, uint8_t butState);
+static void vCheckModeSwitch (void);
 
 
 int16_t
@@ -92,10 +93,23 @@ SetRefHeight (int16_t value)
     g_i16RefHeight = value;
 }
 
+//*****************************************************************************
+//
+// Returns 1 if a button has been pressed since the last call, and clears it,
+// so that each press is only seen once. Auto-repeats are not presses.
+//
+//*****************************************************************************
 uint8_t
 GetButPushed (void)
 {
-    return g_ui8ButPushed;
+    uint8_t ui8Pushed;
+
+    taskENTER_CRITICAL();
+    ui8Pushed = g_ui8ButPushed;
+    g_ui8ButPushed = 0;
+    taskEXIT_CRITICAL();
+
+    return ui8Pushed;
 }
 
 static void
@@ -105,6 +119,29 @@ SetButPushed (uint8_t value)
 }
 
 
+//*****************************************************************************
+//
+// Tracks which buttons are held. Returns true only for the PUSHED that starts
+// a press, not for its auto-repeats.
+//
+//*****************************************************************************
+static bool
+bNewPress (uint8_t butName, uint8_t butState)
+{
+    uint8_t ui8Mask = 1 << butName;
+
+    if (butState == RELEASED)
+    {
+        g_ui8Held &= ~ui8Mask;
+    }
+    else if (butState == PUSHED && !(g_ui8Held & ui8Mask))
+    {
+        g_ui8Held |= ui8Mask;
+        return true;
+    }
+    return false;
+}
+
 //*****************************************************************************
 //
 // Setting limits for yaw and height
@@ -138,7 +175,36 @@ vCheckHeightLimitCases (void)
 
 //*****************************************************************************
 //
-// Set the yaw using the left and right button
+// Set the reference yaw and height from outside the buttons task, e.g. from
+// the serial console. The values are limited and published as for a button
+// press.
+//
+//*****************************************************************************
+void
+UpdateRefYaw (int16_t value)
+{
+    value %= 360;
+    if (value < 0)
+    {
+        value += 360;
+    }
+    SetRefYaw (value);
+    SendToDebugger (GetRefYaw(), YAWREF);
+    DisplayValueUpdated (DISPLAY_YAW_REF, GetRefYaw());
+}
+
+void
+UpdateRefHeight (int16_t value)
+{
+    SetRefHeight (value);
+    vCheckHeightLimitCases();
+    SendToDebugger (GetRefHeight(), HEIGHTREF);
+    DisplayValueUpdated (DISPLAY_HEIGHT_REF, GetRefHeight());
+}
+
+//*****************************************************************************
+//
+// Set the yaw using the left and right button. Returns 1 for a new press.
 //
 //*****************************************************************************
 uint8_t
@@ -150,22 +216,29 @@ CheckYawButtons (void)
     leftButState = checkButton (LEFT);
     rightButState = checkButton (RIGHT);
 
+    if (bNewPress (LEFT, leftButState))
+    {
+        butPushed = 1;
+    }
+    if (bNewPress (RIGHT, rightButState))
+    {
+        butPushed = 1;
+    }
+
     if (leftButState == PUSHED)
     {
         SetRefYaw (GetRefYaw() - 10);
-        butPushed = 1;
     }
     else if (rightButState == PUSHED)
     {
         SetRefYaw (GetRefYaw() + 10);
-        butPushed = 1;
     }
     return (butPushed);
 }
 
 //*****************************************************************************
 //
-// Set the height using the up and down buttons
+// Set the height using the up and down buttons. Returns 1 for a new press.
 //
 //*****************************************************************************
 uint8_t
@@ -177,15 +250,22 @@ CheckHeightButtons (void)
     upButState = checkButton (UP);
     downButState = checkButton (DOWN);
 
+    if (bNewPress (UP, upButState))
+    {
+        butPushed = 1;
+    }
+    if (bNewPress (DOWN, downButState))
+    {
+        butPushed = 1;
+    }
+
     if (upButState == PUSHED)
     {
         SetRefHeight(GetRefHeight() + 10);
-        butPushed = 1;
     }
     else if (downButState == PUSHED)
     {
         SetRefHeight(GetRefHeight() - 10);
-        butPushed = 1;
     }
 
     return (butPushed);
@@ -194,44 +274,54 @@ CheckHeightButtons (void)
 
 //*****************************************************************************
 //
-// Check for button inputs and update reference height and yaw
+// Cycle the display view each time the mode switch changes position
 //
 //*****************************************************************************
 static void
-ButtonTask (void *pvParameters)
+vCheckModeSwitch (void)
 {
-    uint32_t ui32ButtonsDelay = 25;   //task operates every 25 ms
-
-    portTickType ui16DelayTime;
-    ui16DelayTime = xTaskGetTickCount();
+    if (checkButton (MODE) != NO_CHANGE)
+    {
+        DisplayNextView ();
+    }
+}
 
+//*****************************************************************************
+//
+// Wait for button events and update reference height and yaw
+//
+//*****************************************************************************
+static void
+ButtonTask (void *pvParameters)
+{
     uint8_t butPushed, butPushed2 = 0;
 
     while (1)
     {
         //
-        // Poll the debounced state of the buttons.
+        // Block until the button driver has a change to report.
         //
-        updateButtons();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
         butPushed = CheckYawButtons();
         vCheckYawLimitCases();
         SendToDebugger (GetRefYaw(), YAWREF);
+        DisplayValueUpdated (DISPLAY_YAW_REF, GetRefYaw());
 
-        updateButtons();
         butPushed2 = CheckHeightButtons();
         vCheckHeightLimitCases();
         SendToDebugger (GetRefHeight(), HEIGHTREF);
+        DisplayValueUpdated (DISPLAY_HEIGHT_REF, GetRefHeight());
+
+        vCheckModeSwitch();
 
+        //
+        // Latch a new press until the state machine takes it.
+        //
         if (butPushed || butPushed2)
         {
             SetButPushed (1);
         }
-        else
-        {
-            SetButPushed (0);
-        }
-
-        vTaskDelayUntil(&ui16DelayTime, ui32ButtonsDelay / portTICK_RATE_MS);
     }
 }
 
@@ -243,17 +333,20 @@ ButtonTask (void *pvParameters)
 uint32_t
 InitButtonTask (void)
 {
-    initButtons();
-
     //
     // Create the buttons task.
     //
-    if(xTaskCreate(ButtonTask, (const portCHAR *)"ButtonTask",
-                   BUTTONTASKSTACKSIZE, NULL, tskIDLE_PRIORITY + BUTTONTASKPRIORITY, NULL) != pdTRUE)
+    if(xMemMapTaskCreate(MEMMAP_TASK_BUTTON, ButtonTask, NULL,
+                   tskIDLE_PRIORITY + BUTTONTASKPRIORITY, &g_xButtonTask) != pdTRUE)
 
     {
         return(1);
     }
 
+    //
+    // The button interrupts notify the task, so it must exist first.
+    //
+    initButtons(g_xButtonTask);
+
     return(0);
 }
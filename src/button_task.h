@@ -13,8 +13,8 @@
  * Created on: 28.08.21
  *
  * Description: Header file for the button_task module. Contains prototypes to
- * initialise the buttons task and obtain reference yaw and height values for
- * the helicopter to fly to.
+ * initialise the buttons task and obtain or set reference yaw and height values
+ * for the helicopter to fly to.
  *
  *
  */
@@ -31,5 +31,7 @@ uint32_t InitButtonTask (void);
 int16_t GetRefYaw (void);
 int16_t GetRefHeight (void);
 uint8_t GetButPushed (void);
+void UpdateRefYaw (int16_t);
+void UpdateRefHeight (int16_t);
 
 #endif /* BUTTON_TASK_H_ */
@@ -1,4 +1,4 @@
-    // *******************************************************
+// *******************************************************
 // 
 // buttons4.c
 //
@@ -6,12 +6,17 @@
 // ENCE361 sample code.
 // The buttons are:  UP and DOWN (on the Orbit daughterboard) plus
 // LEFT and RIGHT on the Tiva.
+// MODE is the SW1 slide switch on the Orbit daughterboard.
 //
 // Note that pin PF0 (the pin for the RIGHT pushbutton - SW2 on
 //  the Tiva board) needs special treatment - See PhilsNotesOnTiva.rtf.
 //
 // P.J. Bones UCECE
 // Last modified:  7.2.2018
+//
+// Modified to be interrupt driven. Pin edges start a one-shot
+// debounce timer instead of the pins being polled, and the task
+// given to initButtons is only notified when there is a change.
 // 
 // *******************************************************
 
@@ -19,29 +24,59 @@
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
+#include "inc/hw_ints.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/timer.h"
 #include "driverlib/debug.h"
 #include "inc/tm4c123gh6pm.h"  // Board specific defines (for PF0)
+#include "FreeRTOS.h"
+#include "task.h"
 #include "buttons4.h"
+#include "priorities.h"
 
 
+// *******************************************************
+// Pin assignments, in the order of enum butNames
+// *******************************************************
+static const uint32_t but_port[NUM_BUTS] = {UP_BUT_PORT_BASE, DOWN_BUT_PORT_BASE,
+                                            LEFT_BUT_PORT_BASE, RIGHT_BUT_PORT_BASE,
+                                            MODE_BUT_PORT_BASE};
+static const uint8_t but_pin[NUM_BUTS] = {UP_BUT_PIN, DOWN_BUT_PIN, LEFT_BUT_PIN,
+                                          RIGHT_BUT_PIN, MODE_BUT_PIN};
+static const uint32_t but_int[NUM_BUTS] = {UP_BUT_INT, DOWN_BUT_INT, LEFT_BUT_INT,
+                                           RIGHT_BUT_INT, MODE_BUT_INT};
+static const bool but_repeats[NUM_BUTS] = {true, true, true, true, false};
+
 // *******************************************************
 // Globals to module
 // *******************************************************
 static bool but_state[NUM_BUTS];    // Corresponds to the electrical state
-static uint8_t but_count[NUM_BUTS];
 static bool but_flag[NUM_BUTS];
 static bool but_normal[NUM_BUTS];   // Corresponds to the electrical state
-static int downButState = NO_CHANGE;
+static TickType_t but_edge_time[NUM_BUTS];    // First unconfirmed edge
+static TickType_t but_press_time[NUM_BUTS];   // Edge that started the press
+static TickType_t but_repeat_time[NUM_BUTS];
+static bool but_edge_pending[NUM_BUTS];
+static uint32_t but_debounce_load;
+static uint32_t but_repeat_load;
+static TaskHandle_t but_notify_task = NULL;
+
+// *******************************************************
+// Local prototypes
+static void startButtonTimer (uint32_t ui32Load);
+static bool updateButtons (TickType_t xNow);
 
 // *******************************************************
 // initButtons: Initialise the variables associated with the set of buttons
-// defined by the constants in the buttons2.h header file.
-void initButtons (void)
+// defined by the constants in the buttons4.h header file.
+void initButtons (TaskHandle_t xNotifyTask)
 {
     int i;
 
+    but_notify_task = xNotifyTask;
+
     // UP button (active HIGH)
     SysCtlPeripheralEnable (UP_BUT_PERIPH);
     GPIOPinTypeGPIOInput (UP_BUT_PORT_BASE, UP_BUT_PIN);
@@ -77,66 +112,186 @@ void initButtons (void)
                       GPIO_PIN_TYPE_STD_WPU);
     but_normal[RIGHT] = RIGHT_BUT_NORMAL;
 
+    // MODE switch (active HIGH)
+    SysCtlPeripheralEnable (MODE_BUT_PERIPH);
+    GPIOPinTypeGPIOInput (MODE_BUT_PORT_BASE, MODE_BUT_PIN);
+    GPIOPadConfigSet (MODE_BUT_PORT_BASE, MODE_BUT_PIN, GPIO_STRENGTH_2MA,
+                      GPIO_PIN_TYPE_STD_WPD);
+    but_normal[MODE] = MODE_BUT_NORMAL;
+
 
     for (i = 0; i < NUM_BUTS; i++)
     {
         but_state[i] = but_normal[i];
-        but_count[i] = 0;
         but_flag[i] = false;
+        but_edge_pending[i] = false;
+    }
+
+    // One-shot debounce and repeat timer
+    SysCtlPeripheralEnable (BUT_TIMER_PERIPH);
+    TimerConfigure (BUT_TIMER_BASE, TIMER_CFG_ONE_SHOT);
+    but_debounce_load = SysCtlClockGet () / 1000 * BUT_DEBOUNCE_MS;
+    but_repeat_load = SysCtlClockGet () / 1000 * BUT_REPEAT_PERIOD_MS;
+    TimerIntRegister (BUT_TIMER_BASE, TIMER_A, ButtonTimerIntHandler);
+    TimerIntEnable (BUT_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    IntPrioritySet (BUT_TIMER_INT, BUTTON_INT_PRIORITY);
+
+    // Interrupt on both edges of every button pin
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        GPIOIntRegister (but_port[i], ButtonIntHandler);
+        GPIOIntTypeSet (but_port[i], but_pin[i], GPIO_BOTH_EDGES);
+        GPIOIntClear (but_port[i], but_pin[i]);
+        GPIOIntEnable (but_port[i], but_pin[i]);
+        IntPrioritySet (but_int[i], BUTTON_INT_PRIORITY);
     }
 }
 
 // *******************************************************
-// updateButtons: Function designed to be called regularly. It polls all
-// buttons once and updates variables associated with the buttons if
-// necessary.  It is efficient enough to be part of an ISR, e.g. from
-// a SysTick interrupt.
-// Debounce algorithm: A state machine is associated with each button.
-// A state change occurs only after NUM_BUT_POLLS consecutive polls have
-// read the pin in the opposite condition, before the state changes and
-// a flag is set.  Set NUM_BUT_POLLS according to the polling rate.
-void updateButtons (void)
+// startButtonTimer: (Re)starts the one-shot timer with the given load.
+static void startButtonTimer (uint32_t ui32Load)
+{
+    TimerDisable (BUT_TIMER_BASE, TIMER_A);
+    TimerLoadSet (BUT_TIMER_BASE, TIMER_A, ui32Load);
+    TimerEnable (BUT_TIMER_BASE, TIMER_A);
+}
+
+// *******************************************************
+// ButtonIntHandler: Handles an edge on any button pin. The pin is
+// masked until the debounce timer expires, so a bouncing contact
+// causes one interrupt rather than many.
+void ButtonIntHandler (void)
 {
-    bool but_value[NUM_BUTS];
+    TickType_t xNow = xTaskGetTickCountFromISR ();
+    uint32_t ui32Status;
     int i;
 
-    // Read the pins; true means HIGH, false means LOW
-    but_value[UP] = (GPIOPinRead (UP_BUT_PORT_BASE, UP_BUT_PIN) == UP_BUT_PIN);
-    but_value[DOWN] = (GPIOPinRead (DOWN_BUT_PORT_BASE, DOWN_BUT_PIN) == DOWN_BUT_PIN);
-    but_value[LEFT] = (GPIOPinRead (LEFT_BUT_PORT_BASE, LEFT_BUT_PIN) == LEFT_BUT_PIN);
-    but_value[RIGHT] = (GPIOPinRead (RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN) == RIGHT_BUT_PIN);
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        ui32Status = GPIOIntStatus (but_port[i], true);
+        if (ui32Status & but_pin[i])
+        {
+            GPIOIntClear (but_port[i], but_pin[i]);
+            GPIOIntDisable (but_port[i], but_pin[i]);
+            if (!but_edge_pending[i])
+            {
+                but_edge_time[i] = xNow;
+                but_edge_pending[i] = true;
+            }
+        }
+    }
+
+    startButtonTimer (but_debounce_load);
+}
+
+// *******************************************************
+// updateButtons: Samples all buttons once the pins have settled and
+// updates the variables associated with the buttons. Also generates
+// auto-repeat presses for held buttons. Returns true if any flag was
+// set. Called from the timer interrupt.
+static bool updateButtons (TickType_t xNow)
+{
+    bool but_value;
+    bool changed = false;
+    int i;
 
-    // Iterate through the buttons, updating button variables as required
     for (i = 0; i < NUM_BUTS; i++)
     {
-        if (but_value[i] != but_state[i])   // if state of button is opposite of prev read
+        // Read the pin; true means HIGH, false means LOW
+        but_value = (GPIOPinRead (but_port[i], but_pin[i]) == but_pin[i]);
+
+        if (but_value != but_state[i])
         {
-            but_count[i]++;                 // increase the number of counts
-            if (but_count[i] >= NUM_BUT_POLLS)  // if it has been polled enough
+            but_state[i] = but_value;
+            but_flag[i] = true;    // Reset by call to checkButton()
+            changed = true;
+            if (but_value != but_normal[i])
             {
-                but_state[i] = but_value[i];    // set the state to the current
-                but_flag[i] = true;    // Reset by call to checkButton()
-                but_count[i] = 0;
+                but_press_time[i] = but_edge_time[i];
+                but_repeat_time[i] = xNow;
             }
-        } else {
-            but_count[i] = 0;
         }
+        else if (but_repeats[i] && but_value != but_normal[i] &&
+                 (xNow - but_press_time[i]) >= pdMS_TO_TICKS (BUT_REPEAT_DELAY_MS) &&
+                 (xNow - but_repeat_time[i]) >= pdMS_TO_TICKS (BUT_REPEAT_PERIOD_MS))
+        {
+            but_flag[i] = true;    // Held long enough to repeat
+            but_repeat_time[i] = xNow;
+            changed = true;
+        }
+
+        // Re-arm the pin once it has settled
+        if (but_edge_pending[i])
+        {
+            but_edge_pending[i] = false;
+            GPIOIntClear (but_port[i], but_pin[i]);
+            GPIOIntEnable (but_port[i], but_pin[i]);
+        }
+    }
+
+    return changed;
+}
+
+// *******************************************************
+// ButtonTimerIntHandler: Debounce timer expiry. Updates the button
+// states, keeps the timer running while a repeating button is held
+// and wakes the owning task if there is anything to report.
+void ButtonTimerIntHandler (void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    TickType_t xNow = xTaskGetTickCountFromISR ();
+    bool held = false;
+    int i;
+
+    TimerIntClear (BUT_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+
+    if (updateButtons (xNow) && but_notify_task != NULL)
+    {
+        vTaskNotifyGiveFromISR (but_notify_task, &xHigherPriorityTaskWoken);
+    }
+
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        if (but_repeats[i] && but_state[i] != but_normal[i])
+        {
+            held = true;
+        }
+    }
+
+    if (held)
+    {
+        startButtonTimer (but_repeat_load);
     }
+
+    portYIELD_FROM_ISR (xHigherPriorityTaskWoken);
 }
 
 // *******************************************************
 // checkButton: Function returns the new button logical state if the button
 // logical state (PUSHED or RELEASED) has changed since the last call,
-// otherwise returns NO_CHANGE.
+// otherwise returns NO_CHANGE. An auto-repeat is reported as PUSHED.
 uint8_t checkButton (uint8_t butName)
 {
+    uint8_t result = NO_CHANGE;
+
+    taskENTER_CRITICAL ();
     if (but_flag[butName])
     {
         but_flag[butName] = false;
         if (but_state[butName] == but_normal[butName])
-            return RELEASED;
+            result = RELEASED;
         else
-            return PUSHED;
+            result = PUSHED;
     }
-    return NO_CHANGE;
+    taskEXIT_CRITICAL ();
+
+    return result;
+}
+
+// *******************************************************
+// getButtonPressTime: Returns the tick count at the first edge of the
+// most recent press of the button.
+TickType_t getButtonPressTime (uint8_t butName)
+{
+    return but_press_time[butName];
 }
@@ -8,21 +8,30 @@
 // ENCE361 sample code.
 // The buttons are:  UP and DOWN (on the Orbit daughterboard) plus
 // LEFT and RIGHT on the Tiva.
+// MODE is the SW1 slide switch on the Orbit daughterboard. Each
+// change of position is reported as a press.
 //
 // P.J. Bones UCECE
 // Last modified:  7.2.2018
+//
+// Modified to be interrupt driven: pin edges start a hardware
+// debounce timer and the owning task is only notified when a
+// debounced state changes or a held button auto-repeats.
 // 
 // *******************************************************
 
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 //*****************************************************************************
 // Constants
 //*****************************************************************************
 #define BUTTON_DOWN_LENGTH 20
 
-enum butNames {UP = 0, DOWN, LEFT, RIGHT, NUM_BUTS};
+enum butNames {UP = 0, DOWN, LEFT, RIGHT, MODE, NUM_BUTS};
 enum butStates {RELEASED = 0, PUSHED, NO_CHANGE};
 
 enum state {STEPS = 0, KM, MILES};
@@ -41,40 +50,57 @@ extern uint32_t stepCount;
 #define UP_BUT_PORT_BASE  GPIO_PORTE_BASE
 #define UP_BUT_PIN  GPIO_PIN_0
 #define UP_BUT_NORMAL  false
+#define UP_BUT_INT  INT_GPIOE
 // DOWN button
 #define DOWN_BUT_PERIPH  SYSCTL_PERIPH_GPIOD
 #define DOWN_BUT_PORT_BASE  GPIO_PORTD_BASE
 #define DOWN_BUT_PIN  GPIO_PIN_2
 #define DOWN_BUT_NORMAL  false
+#define DOWN_BUT_INT  INT_GPIOD
 // LEFT button
 #define LEFT_BUT_PERIPH  SYSCTL_PERIPH_GPIOF
 #define LEFT_BUT_PORT_BASE  GPIO_PORTF_BASE
 #define LEFT_BUT_PIN  GPIO_PIN_4
 #define LEFT_BUT_NORMAL  true
+#define LEFT_BUT_INT  INT_GPIOF
 // RIGHT button
 #define RIGHT_BUT_PERIPH  SYSCTL_PERIPH_GPIOF
 #define RIGHT_BUT_PORT_BASE  GPIO_PORTF_BASE
 #define RIGHT_BUT_PIN  GPIO_PIN_0
 #define RIGHT_BUT_NORMAL  true
-
-
-#define NUM_BUT_POLLS 3
-// Debounce algorithm: A state machine is associated with each button.
-// A state change occurs only after NUM_BUT_POLLS consecutive polls have
-// read the pin in the opposite condition, before the state changes and
-// a flag is set.  Set NUM_BUT_POLLS according to the polling rate.
-
-// *******************************************************
-// initButtons: Initialise the variables associated with the set of buttons
-// defined by the constants above.
-void initButtons (void);
+#define RIGHT_BUT_INT  INT_GPIOF
+// MODE switch
+#define MODE_BUT_PERIPH  SYSCTL_PERIPH_GPIOA
+#define MODE_BUT_PORT_BASE  GPIO_PORTA_BASE
+#define MODE_BUT_PIN  GPIO_PIN_7
+#define MODE_BUT_NORMAL  false
+#define MODE_BUT_INT  INT_GPIOA
+
+// Debounce timer
+#define BUT_TIMER_PERIPH  SYSCTL_PERIPH_TIMER1
+#define BUT_TIMER_BASE  TIMER1_BASE
+#define BUT_TIMER_INT  INT_TIMER1A
+
+#define BUT_DEBOUNCE_MS 20
+// Debounce algorithm: Any edge on a button pin masks the interrupts
+// for that pin and (re)starts a one-shot timer. When the timer expires
+// without further edges the pins are sampled, any button whose level
+// differs from its state changes state and a flag is set, and the pin
+// interrupts are re-enabled.
+
+#define BUT_REPEAT_DELAY_MS 500
+#define BUT_REPEAT_PERIOD_MS 100
+// Auto-repeat: While a repeating button is held the timer keeps running
+// at BUT_REPEAT_PERIOD_MS. Once the button has been held for
+// BUT_REPEAT_DELAY_MS its flag is set again every period, so
+// checkButton reports a fresh PUSHED.
 
 // *******************************************************
-// updateButtons: Function designed to be called regularly. It polls all
-// buttons once and updates variables associated with the buttons if
-// necessary.  It is efficient enough to be part of an ISR, e.g. from
-// a SysTick interrupt.
-void updateButtons (void);
+// initButtons: Initialise the variables, pins, pin interrupts and
+// debounce timer associated with the set of buttons defined by the
+// constants above. xNotifyTask is given a task notification whenever
+// checkButton has something new to report.
+void initButtons (TaskHandle_t xNotifyTask);
 
 // *******************************************************
 // checkButton: Function returns the new button state if the button state
@@ -83,4 +109,15 @@ void updateButtons (void);
 // enumeration butStates, excluding 'NUM_BUTS'. Safe under interrupt.
 uint8_t checkButton (uint8_t butName);
 
+// *******************************************************
+// getButtonPressTime: Returns the tick count at the first edge of the
+// most recent press of the button, before debouncing.
+TickType_t getButtonPressTime (uint8_t butName);
+
+// *******************************************************
+// ButtonIntHandler, ButtonTimerIntHandler: Pin edge and debounce timer
+// interrupt handlers.
+void ButtonIntHandler (void);
+void ButtonTimerIntHandler (void);
+
 #endif /*BUTTONS_H_*/
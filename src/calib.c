@@ -0,0 +1,399 @@
+/*
+ * File: calib.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module holds the sensor calibration: the raw height
+ * readings when landed and at full height, the ADC channel of the height
+ * sensor and the number of encoder edges per revolution. The record is
+ * loaded from EEPROM at start up, or from the defaults for the Orbit
+ * potentiometer if the EEPROM is blank or corrupt, and is only written back
+ * on request. Q16 conversion factors are worked out whenever it changes, so
+ * the height and yaw conversions are a multiply and a shift.
+ *
+ * The height limits can also be learnt. While learning, the controller task
+ * passes each batch to vCalibUpdate, which keeps the lowest reading landed in
+ * IDLE and the highest at full throttle, and applies them once the
+ * helicopter has done both and landed again.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "driverlib/eeprom.h"
+#include "driverlib/sysctl.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "calib.h"
+#include "height.h"
+#include "rotor.h"
+#include "fsm.h"
+
+//*****************************************************************************
+//
+// The record is the first thing in the EEPROM.
+//
+//*****************************************************************************
+#define CALIB_EEPROM_ADDR       0x0000
+#define CALIB_MAGIC             0x43414C42  // "CALB"
+#define CALIB_VERSION           1
+
+//*****************************************************************************
+//
+// Defaults, for the Orbit BoosterPack potentiometer and the emulator encoder.
+//
+//*****************************************************************************
+#define CALIB_DEFAULT_LOWER     160
+#define CALIB_DEFAULT_UPPER     2210
+#define CALIB_DEFAULT_SLOTS     448
+#define CALIB_DEFAULT_CHANNEL   9
+
+//*****************************************************************************
+//
+// Limits of a valid record, and of the auto calibration.
+//
+//*****************************************************************************
+#define CALIB_ADC_MAX           4095
+#define CALIB_MIN_SPAN          200         // ADC counts from landed to full height
+#define CALIB_MIN_SLOTS         4
+#define CALIB_MAX_SLOTS         4096
+#define CALIB_MAX_CHANNEL       11
+#define CALIB_FULL_DUTY         90          // Main duty of FLYING
+#define CALIB_MIN_BATCHES       40          // 1 s of each phase
+
+//*****************************************************************************
+//
+// Global variables for the calibration module.
+//
+//*****************************************************************************
+static CALIB_RECORD g_sRecord = {
+    CALIB_MAGIC, CALIB_VERSION, sizeof(CALIB_RECORD),
+    CALIB_DEFAULT_LOWER, CALIB_DEFAULT_UPPER, CALIB_DEFAULT_SLOTS, CALIB_DEFAULT_CHANNEL, 0, 0
+};
+static CALIB_FACTORS g_sFactors;
+static CALIB_LEARN g_sLearn;
+static bool g_bLoaded = false;
+static bool g_bEEPROMReady = false;
+
+//*****************************************************************************
+//
+// Local prototypes for the calibration module.
+//
+//*****************************************************************************
+static uint32_t ui32Crc (const CALIB_RECORD *psRecord);
+static bool bValid (const CALIB_RECORD *psRecord);
+static void vApply (void);
+
+//*****************************************************************************
+//
+// CRC-32 (IEEE) of every byte of the record before the CRC.
+//
+//*****************************************************************************
+static uint32_t
+ui32Crc (const CALIB_RECORD *psRecord)
+{
+    const uint8_t *pui8Byte = (const uint8_t *) psRecord;
+    uint32_t ui32Count = offsetof(CALIB_RECORD, ui32Crc);
+    uint32_t ui32Crc = 0xFFFFFFFF;
+    uint8_t i;
+
+    while (ui32Count--)
+    {
+        ui32Crc ^= *pui8Byte++;
+        for (i = 0; i < 8; i++)
+        {
+            ui32Crc = (ui32Crc >> 1) ^ (0xEDB88320 & -(ui32Crc & 1));
+        }
+    }
+    return ~ui32Crc;
+}
+
+//*****************************************************************************
+//
+// Checks the values of a record, not its header.
+//
+//*****************************************************************************
+static bool
+bValid (const CALIB_RECORD *psRecord)
+{
+    return (psRecord->ui16HeightUpper <= CALIB_ADC_MAX
+            && psRecord->ui16HeightUpper >= psRecord->ui16HeightLower + CALIB_MIN_SPAN
+            && psRecord->ui16EncoderSlots >= CALIB_MIN_SLOTS
+            && psRecord->ui16EncoderSlots <= CALIB_MAX_SLOTS
+            && psRecord->ui8AdcChannel <= CALIB_MAX_CHANNEL);
+}
+
+//*****************************************************************************
+//
+// Works out the conversion factors from the record.
+//
+//*****************************************************************************
+static void
+vApply (void)
+{
+    taskENTER_CRITICAL();
+    g_sFactors.ui16HeightLower = g_sRecord.ui16HeightLower;
+    g_sFactors.ui16HeightUpper = g_sRecord.ui16HeightUpper;
+    g_sFactors.ui32HeightScale = (100UL << CALIB_Q) / (g_sRecord.ui16HeightUpper - g_sRecord.ui16HeightLower);
+    g_sFactors.ui16EncoderSlots = g_sRecord.ui16EncoderSlots;
+    g_sFactors.ui32YawScale = (360UL << CALIB_Q) / g_sRecord.ui16EncoderSlots;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Loads the record from EEPROM. Returns false, keeping the defaults, if the
+// EEPROM fails to start or the record is blank, from another version or
+// corrupt. Must be called before the height and yaw modules are started.
+//
+//*****************************************************************************
+bool
+bCalibInit (void)
+{
+    CALIB_RECORD sRecord;
+
+    vApply();
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while (!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+    {
+    }
+    if (EEPROMInit() != EEPROM_INIT_OK)
+    {
+        return false;
+    }
+    g_bEEPROMReady = true;
+
+    EEPROMRead((uint32_t *) &sRecord, CALIB_EEPROM_ADDR, sizeof(CALIB_RECORD));
+
+    if (sRecord.ui32Magic != CALIB_MAGIC
+        || sRecord.ui16Version != CALIB_VERSION
+        || sRecord.ui16Size != sizeof(CALIB_RECORD)
+        || sRecord.ui32Crc != ui32Crc(&sRecord)
+        || !bValid(&sRecord))
+    {
+        return false;
+    }
+
+    g_sRecord = sRecord;
+    g_bLoaded = true;
+    vApply();
+    return true;
+}
+
+//*****************************************************************************
+//
+// Returns the conversion factors in use.
+//
+//*****************************************************************************
+const CALIB_FACTORS *
+psCalibFactors (void)
+{
+    return &g_sFactors;
+}
+
+//*****************************************************************************
+//
+// Copies the record in use.
+//
+//*****************************************************************************
+void
+vCalibGet (CALIB_RECORD *psRecord)
+{
+    taskENTER_CRITICAL();
+    *psRecord = g_sRecord;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Uses the values of a record, if they are valid. The ADC channel takes
+// effect at the next reset. Returns false if the record was rejected.
+//
+//*****************************************************************************
+bool
+bCalibSet (const CALIB_RECORD *psRecord)
+{
+    if (!bValid(psRecord))
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    g_sRecord.ui16HeightLower = psRecord->ui16HeightLower;
+    g_sRecord.ui16HeightUpper = psRecord->ui16HeightUpper;
+    g_sRecord.ui16EncoderSlots = psRecord->ui16EncoderSlots;
+    g_sRecord.ui8AdcChannel = psRecord->ui8AdcChannel;
+    taskEXIT_CRITICAL();
+
+    vApply();
+    return true;
+}
+
+//*****************************************************************************
+//
+// Returns true if the record was loaded from EEPROM at start up.
+//
+//*****************************************************************************
+bool
+bCalibLoaded (void)
+{
+    return g_bLoaded;
+}
+
+//*****************************************************************************
+//
+// Returns to the default record. It is not saved.
+//
+//*****************************************************************************
+void
+vCalibDefaults (void)
+{
+    CALIB_RECORD sRecord = g_sRecord;
+
+    sRecord.ui16HeightLower = CALIB_DEFAULT_LOWER;
+    sRecord.ui16HeightUpper = CALIB_DEFAULT_UPPER;
+    sRecord.ui16EncoderSlots = CALIB_DEFAULT_SLOTS;
+    sRecord.ui8AdcChannel = CALIB_DEFAULT_CHANNEL;
+    bCalibSet(&sRecord);
+}
+
+//*****************************************************************************
+//
+// Programs the record into the EEPROM and reads it back. Returns 0 on
+// success, 1 on failure.
+//
+//*****************************************************************************
+uint32_t
+ui32CalibSave (void)
+{
+    CALIB_RECORD sRecord;
+    CALIB_RECORD sCheck;
+
+    if (!g_bEEPROMReady)
+    {
+        return(1);
+    }
+
+    vCalibGet(&sRecord);
+    sRecord.ui32Magic = CALIB_MAGIC;
+    sRecord.ui16Version = CALIB_VERSION;
+    sRecord.ui16Size = sizeof(CALIB_RECORD);
+    sRecord.ui8Reserved = 0;
+    sRecord.ui32Crc = ui32Crc(&sRecord);
+
+    if (EEPROMProgram((uint32_t *) &sRecord, CALIB_EEPROM_ADDR, sizeof(CALIB_RECORD)) != 0)
+    {
+        return(1);
+    }
+
+    EEPROMRead((uint32_t *) &sCheck, CALIB_EEPROM_ADDR, sizeof(CALIB_RECORD));
+    if (sCheck.ui32Crc != sRecord.ui32Crc || sCheck.ui32Crc != ui32Crc(&sCheck))
+    {
+        return(1);
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Starts learning the height limits.
+//
+//*****************************************************************************
+void
+vCalibLearnStart (void)
+{
+    taskENTER_CRITICAL();
+    g_sLearn.ui16Min = CALIB_ADC_MAX;
+    g_sLearn.ui16Max = 0;
+    g_sLearn.ui32Landed = 0;
+    g_sLearn.ui32Full = 0;
+    g_sLearn.bRejected = false;
+    g_sLearn.bLearning = true;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Copies the state of the auto calibration.
+//
+//*****************************************************************************
+void
+vCalibGetLearn (CALIB_LEARN *psLearn)
+{
+    taskENTER_CRITICAL();
+    *psLearn = g_sLearn;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Called by the controller task every control cycle. bFresh is false if the
+// cycle ran without a new batch of height samples. The learnt limits are
+// applied on landing, and only if they span enough of the ADC range.
+//
+//*****************************************************************************
+void
+vCalibUpdate (bool bFresh)
+{
+    uint32_t ui32Mean, ui32Min, ui32Max;
+    uint16_t ui16Tail, ui16Main;
+    uint16_t ui16OutTail, ui16OutMain;
+    CALIB_RECORD sRecord;
+    bool bLanded;
+
+    if (!g_sLearn.bLearning || !bFresh)
+    {
+        return;
+    }
+
+    vHeightGetBatch(&ui32Mean, &ui32Min, &ui32Max);
+    fsm_get_duties(&ui16Tail, &ui16Main);
+    vGetRotorOutputs(&ui16OutTail, &ui16OutMain);
+    bLanded = (fsm_get_state() == IDLE && ui16OutMain == 0);
+
+    taskENTER_CRITICAL();
+    if (bLanded)
+    {
+        if (ui32Mean < g_sLearn.ui16Min)
+        {
+            g_sLearn.ui16Min = ui32Mean;
+        }
+        g_sLearn.ui32Landed++;
+    }
+    else if (ui16Main >= CALIB_FULL_DUTY)
+    {
+        if (ui32Mean > g_sLearn.ui16Max)
+        {
+            g_sLearn.ui16Max = ui32Mean;
+        }
+        g_sLearn.ui32Full++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (!bLanded || g_sLearn.ui32Landed < CALIB_MIN_BATCHES || g_sLearn.ui32Full < CALIB_MIN_BATCHES)
+    {
+        return;
+    }
+
+    vCalibGet(&sRecord);
+    sRecord.ui16HeightLower = g_sLearn.ui16Min;
+    sRecord.ui16HeightUpper = g_sLearn.ui16Max;
+    g_sLearn.bRejected = !bCalibSet(&sRecord);
+    g_sLearn.bLearning = false;
+}
@@ -0,0 +1,88 @@
+/*
+ * File: calib.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the calibration module. The height sensor
+ * limits, ADC channel and encoder slots are kept in EEPROM and converted to
+ * fixed point factors for the height and yaw modules.
+ *
+ *
+ */
+
+#ifndef CALIB_H_
+#define CALIB_H_
+
+//*****************************************************************************
+//
+// Struct for the calibration record as stored in EEPROM. A multiple of four
+// bytes, as the EEPROM is written a word at a time.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Magic;
+    uint16_t ui16Version;
+    uint16_t ui16Size;
+    uint16_t ui16HeightLower;   // Raw ADC reading when landed
+    uint16_t ui16HeightUpper;   // Raw ADC reading at full height
+    uint16_t ui16EncoderSlots;  // Edges per revolution
+    uint8_t ui8AdcChannel;      // 0 for the emulator, 9 for the Orbit potentiometer
+    uint8_t ui8Reserved;
+    uint32_t ui32Crc;
+} CALIB_RECORD;
+
+//*****************************************************************************
+//
+// Conversion factors derived from the record. The scales are Q16.
+//
+//*****************************************************************************
+typedef struct {
+    uint16_t ui16HeightLower;
+    uint16_t ui16HeightUpper;
+    uint32_t ui32HeightScale;   // Percent per ADC count
+    uint16_t ui16EncoderSlots;
+    uint32_t ui32YawScale;      // Degrees per edge
+} CALIB_FACTORS;
+
+#define CALIB_Q                 16
+
+//*****************************************************************************
+//
+// Struct for the state of the auto calibration.
+//
+//*****************************************************************************
+typedef struct {
+    bool bLearning;
+    uint16_t ui16Min;           // Lowest landed batch so far
+    uint16_t ui16Max;           // Highest full throttle batch so far
+    uint32_t ui32Landed;        // Landed batches seen
+    uint32_t ui32Full;          // Full throttle batches seen
+    bool bRejected;             // The last learnt limits spanned too little
+} CALIB_LEARN;
+
+//*****************************************************************************
+//
+// Prototypes for the calibration module.
+//
+//*****************************************************************************
+bool bCalibInit (void);
+const CALIB_FACTORS *psCalibFactors (void);
+void vCalibGet (CALIB_RECORD *psRecord);
+bool bCalibSet (const CALIB_RECORD *psRecord);
+bool bCalibLoaded (void);
+uint32_t ui32CalibSave (void);
+void vCalibDefaults (void);
+void vCalibLearnStart (void);
+void vCalibGetLearn (CALIB_LEARN *psLearn);
+void vCalibUpdate (bool bFresh);
+
+#endif /* CALIB_H_ */
@@ -0,0 +1,1100 @@
+/*
+ * File: console.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module provides a command console on the UART. Received
+ * characters are pushed by the UART receive interrupt into a stream buffer.
+ * The console task reads the stream buffer, echoes and edits the current line,
+ * and runs the matching command from the command table when a line is
+ * complete. Type "help" for the list of commands.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/uart.h"
+#include "utils/uartstdio.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+
+#include "console.h"
+#include "button_task.h"
+#include "controller.h"
+#include "display.h"
+#include "debugger.h"
+#include "height.h"
+#include "yaw.h"
+#include "fsm.h"
+#include "rotor.h"
+#include "bench.h"
+#include "ctlbench.h"
+#include "gsched.h"
+#include "health.h"
+#include "recorder.h"
+#include "calib.h"
+#include "idle.h"
+#include "memmap.h"
+#include "priorities.h"
+
+//*****************************************************************************
+//
+// Buffer sizes for the console.
+//
+//*****************************************************************************
+#define CONSOLE_RX_CHUNK            16          // Bytes read from the FIFO at once
+#define CONSOLE_LINE_SIZE           48          // Longest command line
+#define CONSOLE_MAX_ARGS            6
+
+//*****************************************************************************
+//
+// Console command handler. Returns 0 on success or a non-zero value if the
+// arguments were invalid.
+//
+//*****************************************************************************
+typedef int (*ConsoleCommand)(int argc, char *argv[]);
+
+//*****************************************************************************
+//
+// Struct for an entry in the command table.
+//
+//*****************************************************************************
+typedef struct {
+    const char      *pcCommand;
+    ConsoleCommand  pfnCommand;
+    const char      *pcHelp;
+} CONSOLE_ENTRY;
+
+//*****************************************************************************
+//
+// Global variables for the console task.
+//
+//*****************************************************************************
+static StreamBufferHandle_t g_xConsoleRxBuffer;
+
+
+//*****************************************************************************
+//
+// Local prototypes for the console module.
+//
+//*****************************************************************************
+static int CmdHelp (int argc, char *argv[]);
+static int CmdYaw (int argc, char *argv[]);
+static int CmdHeight (int argc, char *argv[]);
+static int CmdGains (int argc, char *argv[]);
+static int CmdStats (int argc, char *argv[]);
+static int CmdRate (int argc, char *argv[]);
+static int CmdView (int argc, char *argv[]);
+static int CmdFrame (int argc, char *argv[]);
+static int CmdMem (int argc, char *argv[]);
+static int CmdHeap (int argc, char *argv[]);
+static int CmdPool (int argc, char *argv[]);
+static int CmdBench (int argc, char *argv[]);
+static int CmdIdle (int argc, char *argv[]);
+static int CmdTrans (int argc, char *argv[]);
+static int CmdTraj (int argc, char *argv[]);
+static int CmdSched (int argc, char *argv[]);
+static int CmdSlew (int argc, char *argv[]);
+static int CmdLoop (int argc, char *argv[]);
+static int CmdCtlBench (int argc, char *argv[]);
+static int CmdHealth (int argc, char *argv[]);
+static int CmdRec (int argc, char *argv[]);
+static int CmdCal (int argc, char *argv[]);
+static bool bFindPoint (const char *pcValue, bool bDuty, uint8_t *pui8Index);
+static bool bParseInt (const char *pcString, int32_t *pi32Value);
+static void vConsoleProcessLine (char *pcLine);
+static void vConsoleWrite (const char *pcBuf, uint32_t ui32Len);
+static void ConsoleTask (void *pvParameters);
+
+//*****************************************************************************
+//
+// The command table. Commands are matched on the first word of the line.
+//
+//*****************************************************************************
+static const CONSOLE_ENTRY g_psCommands[] = {
+    { "help",   CmdHelp,    "- list the commands" },
+    { "yaw",    CmdYaw,     "<deg> - set the reference yaw" },
+    { "height", CmdHeight,  "<0-100> - set the reference height" },
+    { "gains",  CmdGains,   "[kp ki limit] - show or fix the tail PI gains, schedule off" },
+    { "stats",  CmdStats,   "- show the current state" },
+    { "rate",   CmdRate,    "<ms> - set the telemetry period, 0 = off" },
+    { "view",   CmdView,    "<n> - select display view 0-2" },
+    { "frame",  CmdFrame,   "- dump the display as a PBM image" },
+    { "mem",    CmdMem,     "- show the task and queue memory map" },
+    { "heap",   CmdHeap,    "- show the heap usage and fragmentation" },
+    { "pool",   CmdPool,    "- show the message pool usage" },
+    { "bench",  CmdBench,   "[queue|kernel|heap|pool] - time queues, kernel, heap; stress a pool" },
+    { "idle",   CmdIdle,    "- show sleeps and idle time since the last call" },
+    { "trans",  CmdTrans,   "- show the recent flight state transitions" },
+    { "traj",   CmdTraj,    "[on|off] - show and clear the yaw trajectory stats" },
+    { "ctlbench", CmdCtlBench, "- run the yaw controller scenarios on a simulated plant" },
+    { "loop",   CmdLoop,    "- show the control pipeline latency since the last call" },
+    { "slew",   CmdSlew,    "[tail main] - show or set the rotor ramps, per-mille/s" },
+    { "sched",  CmdSched,   "[on|off|save|<main> <height> <kp> <ki> <offset>] - gain schedule" },
+    { "health", CmdHealth,  "[clear|inject <check>] - show, clear or inject sensor faults" },
+    { "rec",    CmdRec,     "[trigger|dump [seq]] - flight recorder captures" },
+    { "cal",    CmdCal,     "[auto|save|default|height <low> <high>|slots <n>|channel <n>] - sensor calibration" },
+};
+
+#define NUM_COMMANDS        (sizeof(g_psCommands) / sizeof(g_psCommands[0]))
+
+//*****************************************************************************
+//
+// Parses a signed decimal integer. Returns false if the string is not a
+// number or does not fit in an int32_t.
+//
+//*****************************************************************************
+static bool
+bParseInt (const char *pcString, int32_t *pi32Value)
+{
+    bool bNegative = false;
+    uint32_t ui32Value = 0;
+    uint32_t ui32Limit = INT32_MAX;
+    uint32_t ui32Digit;
+
+    if (*pcString == '-')
+    {
+        bNegative = true;
+        ui32Limit = (uint32_t) INT32_MAX + 1;
+        pcString++;
+    }
+
+    if (*pcString == '\0')
+    {
+        return false;
+    }
+
+    while (*pcString != '\0')
+    {
+        if (*pcString < '0' || *pcString > '9')
+        {
+            return false;
+        }
+        ui32Digit = *pcString - '0';
+        if (ui32Value > (ui32Limit - ui32Digit) / 10)
+        {
+            return false;
+        }
+        ui32Value = ui32Value * 10 + ui32Digit;
+        pcString++;
+    }
+
+    *pi32Value = bNegative ? (int32_t) (0 - ui32Value) : (int32_t) ui32Value;
+    return true;
+}
+
+//*****************************************************************************
+//
+// Command handlers.
+//
+//*****************************************************************************
+static int
+CmdHelp (int argc, char *argv[])
+{
+    uint32_t i;
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    for (i = 0; i < NUM_COMMANDS; i++)
+    {
+        UARTprintf("%s %s\n", g_psCommands[i].pcCommand, g_psCommands[i].pcHelp);
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdYaw (int argc, char *argv[])
+{
+    int32_t i32Value;
+
+    if (argc != 2 || !bParseInt(argv[1], &i32Value) ||
+        i32Value < INT16_MIN || i32Value > INT16_MAX)
+    {
+        return 1;
+    }
+
+    UpdateRefYaw(i32Value);
+    return 0;
+}
+
+static int
+CmdHeight (int argc, char *argv[])
+{
+    int32_t i32Value;
+
+    if (argc != 2 || !bParseInt(argv[1], &i32Value) || i32Value < 0 || i32Value > 100)
+    {
+        return 1;
+    }
+
+    UpdateRefHeight(i32Value);
+    return 0;
+}
+
+static int
+CmdGains (int argc, char *argv[])
+{
+    int32_t i32Kp, i32Ki, i32Limit;
+    uint8_t ui8Kp, ui8Ki, ui8Limit;
+
+    if (argc == 4)
+    {
+        if (!bParseInt(argv[1], &i32Kp) || !bParseInt(argv[2], &i32Ki) ||
+            !bParseInt(argv[3], &i32Limit) ||
+            i32Kp < 0 || i32Kp > 255 || i32Ki < 0 || i32Ki > 255 ||
+            i32Limit < 0 || i32Limit > 255)
+        {
+            return 1;
+        }
+        vControlSetGains(i32Kp, i32Ki, i32Limit);
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    vControlGetGains(&ui8Kp, &ui8Ki, &ui8Limit);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("kp %u ki %u limit %u\n", ui8Kp, ui8Ki, ui8Limit);
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdStats (int argc, char *argv[])
+{
+    uint16_t ui16Tail, ui16Main;
+    uint32_t ui32Render, ui32RenderMax;
+    uint32_t ui32RefPulses;
+    TickType_t xHomedTick;
+    YAW_WAKE_STATS sWake;
+    State eState = fsm_get_state();
+
+    fsm_get_duties(&ui16Tail, &ui16Main);
+    DisplayGetRenderCycles(&ui32Render, &ui32RenderMax);
+    vYawGetHoming(&xHomedTick, &ui32RefPulses);
+    vYawGetWakeStats(&sWake);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("yaw %d ref %d\n", GetYawAngle(), GetRefYaw());
+    UARTprintf("height %u ref %d\n", GetHeight(), GetRefHeight());
+    UARTprintf("state %s\n", fsm_state_name(eState));
+    if (bYawIsHomed())
+    {
+        UARTprintf("homed at %u ms, %u ref pulses\n", xHomedTick * portTICK_PERIOD_MS, ui32RefPulses);
+    }
+    else
+    {
+        UARTprintf("not homed\n");
+    }
+    UARTprintf("duty tail %u main %u\n", ui16Tail, ui16Main);
+    if (sWake.ui32Wakes != 0)
+    {
+        UARTprintf("yaw wake cycles %u max %u\n", sWake.ui32Total / sWake.ui32Wakes, sWake.ui32Max);
+    }
+    UARTprintf("heap free %u\n", xPortGetFreeHeapSize());
+    UARTprintf("render cycles %u max %u\n", ui32Render, ui32RenderMax);
+    UARTprintf("telemetry %u ms\n", DebugGetPeriod());
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdRate (int argc, char *argv[])
+{
+    int32_t i32Value;
+
+    if (argc != 2 || !bParseInt(argv[1], &i32Value) || i32Value < 0)
+    {
+        return 1;
+    }
+
+    DebugSetPeriod(i32Value);
+    return 0;
+}
+
+static int
+CmdView (int argc, char *argv[])
+{
+    int32_t i32Value;
+
+    if (argc != 2 || !bParseInt(argv[1], &i32Value) ||
+        i32Value < 0 || i32Value >= NUM_DISPLAY_VIEWS)
+    {
+        return 1;
+    }
+
+    DisplaySetView((DisplayView) i32Value);
+    return 0;
+}
+
+static int
+CmdFrame (int argc, char *argv[])
+{
+    DisplayDumpFrame();
+    return 0;
+}
+
+static int
+CmdMem (int argc, char *argv[])
+{
+    vMemMapPrint();
+    return 0;
+}
+
+static int
+CmdHeap (int argc, char *argv[])
+{
+    HeapStats_t xStats;
+
+    vPortGetHeapStats(&xStats);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("heap free %u of %u, min ever %u\n", xStats.xAvailableHeapSpaceInBytes,
+               configTOTAL_HEAP_SIZE, xStats.xMinimumEverFreeBytesRemaining);
+    UARTprintf("free blocks %u largest %u smallest %u\n", xStats.xNumberOfFreeBlocks,
+               xStats.xSizeOfLargestFreeBlockInBytes, xStats.xSizeOfSmallestFreeBlockInBytes);
+    UARTprintf("allocs %u frees %u\n", xStats.xNumberOfSuccessfulAllocations,
+               xStats.xNumberOfSuccessfulFrees);
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdPool (int argc, char *argv[])
+{
+    MEMPOOL_STATS sStats;
+
+    DebugGetPoolStats(&sStats);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("debug %u x %u bytes, in use %u peak %u\n", sStats.ui32NumBlocks,
+               sStats.ui32BlockSize, sStats.ui32InUse, sStats.ui32Peak);
+    UARTprintf("allocs %u dropped %u\n", sStats.ui32Allocs, sStats.ui32Failures);
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdBench (int argc, char *argv[])
+{
+    if (argc < 2 || strcmp(argv[1], "queue") == 0)
+    {
+        vBenchQueues();
+    }
+    if (argc < 2 || strcmp(argv[1], "kernel") == 0)
+    {
+        vBenchKernel();
+    }
+    if (argc < 2 || strcmp(argv[1], "heap") == 0)
+    {
+        vBenchHeap();
+    }
+    if (argc < 2 || strcmp(argv[1], "pool") == 0)
+    {
+        vBenchPool();
+    }
+    return 0;
+}
+
+static int
+CmdIdle (int argc, char *argv[])
+{
+    IDLE_STATS sStats;
+
+    IdleGetStats(&sStats);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("%u ms: %u sleeps, %u us asleep, %u us each, %u ticks skipped\n",
+               sStats.ui32ElapsedTicks, sStats.ui32Sleeps, sStats.ui32AsleepUs,
+               sStats.ui32MeanSleepUs, sStats.ui32SkippedTicks);
+    UARTprintf("wakeups %u/s idle %u.%u%%\n", sStats.ui32WakeupsPerSec,
+               sStats.ui32IdlePermille / 10, sStats.ui32IdlePermille % 10);
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdTrans (int argc, char *argv[])
+{
+    HSM_LOG_ENTRY psLog[HSM_LOG_SIZE];
+    uint32_t ui32Count;
+    uint32_t i;
+
+    ui32Count = fsm_get_log(psLog, HSM_LOG_SIZE);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    for (i = 0; i < ui32Count; i++)
+    {
+        UARTprintf("%u ms: %s -> %s%s\n", psLog[i].xTick, fsm_state_name(psLog[i].ui8From),
+                   fsm_state_name(psLog[i].ui8To), psLog[i].bTimeout ? " (timeout)" : "");
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdTraj (int argc, char *argv[])
+{
+    CONTROL_TRAJ_STATS sStats;
+
+    if (argc == 2 && strcmp(argv[1], "on") == 0)
+    {
+        vControlSetTrajectory(true);
+    }
+    else if (argc == 2 && strcmp(argv[1], "off") == 0)
+    {
+        vControlSetTrajectory(false);
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    vControlGetTrajStats(&sStats);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("trajectory %s, %u steps, %u ticks rate limited\n",
+               sStats.bEnabled ? "on" : "off", sStats.ui32Steps, sStats.ui32RateLimited);
+    UARTprintf("tail saturated %u/%u ticks, overshoot %d deg\n",
+               sStats.ui32Saturated, sStats.ui32Ticks, sStats.i16Overshoot);
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdCtlBench (int argc, char *argv[])
+{
+    vCtlBenchRun();
+
+    return 0;
+}
+
+static int
+CmdHealth (int argc, char *argv[])
+{
+    HEALTH_STATUS sStatus;
+    uint32_t i;
+
+    if (argc == 2 && strcmp(argv[1], "clear") == 0)
+    {
+        vHealthClear();
+    }
+    else if (argc == 3 && strcmp(argv[1], "inject") == 0)
+    {
+        for (i = 0; i < NUM_HEALTH_CHECKS; i++)
+        {
+            if (strcmp(argv[2], pcHealthName((HealthCheck) i)) == 0)
+            {
+                break;
+            }
+        }
+        if (i == NUM_HEALTH_CHECKS)
+        {
+            return 1;
+        }
+        vHealthInject(HEALTH_FAULT(i));
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    vHealthGetStatus(&sStatus);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    if (sStatus.ui32Faults == 0)
+    {
+        UARTprintf("no faults\n");
+    }
+    else
+    {
+        UARTprintf("faults latched at %u ms\n", sStatus.xFaultTick * portTICK_PERIOD_MS);
+    }
+    UARTprintf("check    latched injected trips\n");
+    for (i = 0; i < NUM_HEALTH_CHECKS; i++)
+    {
+        UARTprintf("%8s %7s %8s %5u\n", pcHealthName((HealthCheck) i),
+                   (sStatus.ui32Faults & HEALTH_FAULT(i)) ? "yes" : "no",
+                   (sStatus.ui32Injected & HEALTH_FAULT(i)) ? "yes" : "no",
+                   sStatus.pui32Trips[i]);
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+//*****************************************************************************
+//
+// Streams a capture as CSV lines, one per sample, with the time relative to
+// the trigger. The UART is released between lines so telemetry keeps running.
+//
+//*****************************************************************************
+static void
+vRecDump (uint32_t ui32Sequence)
+{
+    REC_CAPTURE sCapture;
+    REC_READER sReader;
+    REC_SAMPLE sSample;
+    int32_t i32Ms;
+
+    if (!bRecordOpen(ui32Sequence, &sCapture, &sReader))
+    {
+        xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+        UARTprintf("no capture %u\n", ui32Sequence);
+        xSemaphoreGive(xUARTSemaphore);
+        return;
+    }
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("rec,ms,yaw,ref_yaw,height,ref_height,state,tail,main\n");
+    xSemaphoreGive(xUARTSemaphore);
+
+    while (bRecordNext(&sReader, &sSample))
+    {
+        i32Ms = ((int32_t) sReader.ui16Index - 1 - sCapture.ui16Trigger) * sCapture.ui8PeriodMs;
+
+        xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+        UARTprintf("rec,%d,%d,%d,%u,%u,%s,%u,%u\n", i32Ms, sSample.i16Yaw, sSample.i16RefYaw,
+                   sSample.ui8Height, sSample.ui8RefHeight, fsm_state_name(sSample.ui8State),
+                   sSample.ui8Tail, sSample.ui8Main);
+        xSemaphoreGive(xUARTSemaphore);
+    }
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("rec,end,%u of %u samples\n", sReader.ui16Index, sCapture.ui16Samples);
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+static int
+CmdRec (int argc, char *argv[])
+{
+    REC_CAPTURE psCaptures[8];
+    REC_STATUS sStatus;
+    uint32_t ui32Found;
+    int32_t i32Seq;
+    uint32_t i;
+
+    ui32Found = ui32RecordList(psCaptures, 8);
+
+    if (argc == 2 && strcmp(argv[1], "trigger") == 0)
+    {
+        vRecordTrigger(REC_REASON_CONSOLE);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "dump") == 0)
+    {
+        if (argc == 3)
+        {
+            if (!bParseInt(argv[2], &i32Seq) || i32Seq < 0)
+            {
+                return 1;
+            }
+        }
+        else if (argc == 2 && ui32Found != 0)
+        {
+            i32Seq = psCaptures[ui32Found - 1].ui32Sequence;
+        }
+        else
+        {
+            return 1;
+        }
+        vRecDump(i32Seq);
+        return 0;
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    vRecordGetStatus(&sStatus);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("recorder %s, %u samples buffered, %u saved, %u errors\n",
+               sStatus.bPending ? "waiting for rotors to stop" :
+               sStatus.bTriggered ? "triggered" : "recording",
+               sStatus.ui16Buffered, sStatus.ui32Saved, sStatus.ui32Errors);
+    for (i = 0; i < ui32Found; i++)
+    {
+        UARTprintf("seq %u: %u samples, trigger at %u, %u bytes, %s\n",
+                   psCaptures[i].ui32Sequence, psCaptures[i].ui16Samples,
+                   psCaptures[i].ui16Trigger, psCaptures[i].ui16Bytes,
+                   psCaptures[i].ui8Reason == REC_REASON_FAULT ? "fault" : "console");
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdLoop (int argc, char *argv[])
+{
+    CONTROL_LOOP_STATS sStats;
+    uint32_t ui32PerUs = configCPU_CLOCK_HZ / 1000000;
+
+    vControlGetLoopStats(&sStats);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("%u cycles, %u overruns, %u timeouts, %u samples dropped\n", sStats.ui32Cycles,
+               sStats.ui32Overruns, sStats.ui32Timeouts, ui32HeightDropped());
+    if (sStats.ui32Cycles != 0)
+    {
+        UARTprintf("us from trigger: sample max %u, wake max %u\n",
+                   sStats.ui32SenseMax / ui32PerUs, sStats.ui32WakeMax / ui32PerUs);
+        UARTprintf("pwm written min %u avg %u max %u\n", sStats.ui32ActMin / ui32PerUs,
+                   sStats.ui32ActTotal / sStats.ui32Cycles / ui32PerUs,
+                   sStats.ui32ActMax / ui32PerUs);
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdSlew (int argc, char *argv[])
+{
+    int32_t i32Tail, i32Main;
+    uint16_t ui16Tail, ui16Main;
+
+    if (argc == 3)
+    {
+        if (!bParseInt(argv[1], &i32Tail) || !bParseInt(argv[2], &i32Main)
+            || i32Tail <= 0 || i32Tail > 10000 || i32Main <= 0 || i32Main > 10000)
+        {
+            return 1;
+        }
+        vSetRotorSlew(i32Tail, i32Main);
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    vGetRotorSlew(&ui16Tail, &ui16Main);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("slew tail %u main %u per-mille/s\n", ui16Tail, ui16Main);
+    vGetRotorOutputs(&ui16Tail, &ui16Main);
+    UARTprintf("output tail %u main %u per-mille\n", ui16Tail, ui16Main);
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+//*****************************************************************************
+//
+// Finds the index of a gain schedule breakpoint from its main duty or height.
+//
+//*****************************************************************************
+static bool
+bFindPoint (const char *pcValue, bool bDuty, uint8_t *pui8Index)
+{
+    int32_t i32Value;
+    uint8_t ui8Count = bDuty ? GSCHED_DUTY_POINTS : GSCHED_HEIGHT_POINTS;
+    uint8_t i;
+
+    if (!bParseInt(pcValue, &i32Value))
+    {
+        return false;
+    }
+
+    for (i = 0; i < ui8Count; i++)
+    {
+        if (i32Value == (bDuty ? ui8GSchedDutyPoint(i) : ui8GSchedHeightPoint(i)))
+        {
+            *pui8Index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int
+CmdSched (int argc, char *argv[])
+{
+    GSCHED_POINT sPoint;
+    int32_t i32Kp, i32Ki, i32Offset;
+    uint8_t d, h;
+
+    if (argc == 2 && strcmp(argv[1], "on") == 0)
+    {
+        vControlSetScheduled(true);
+    }
+    else if (argc == 2 && strcmp(argv[1], "off") == 0)
+    {
+        vControlSetScheduled(false);
+    }
+    else if (argc == 2 && strcmp(argv[1], "save") == 0)
+    {
+        //
+        // The CPU stalls while the flash is erased, so only save when landed.
+        //
+        if (fsm_get_state() != IDLE || ui32GSchedSave() != 0)
+        {
+            return 1;
+        }
+    }
+    else if (argc == 6)
+    {
+        if (!bFindPoint(argv[1], true, &d) || !bFindPoint(argv[2], false, &h)
+            || !bParseInt(argv[3], &i32Kp) || !bParseInt(argv[4], &i32Ki)
+            || !bParseInt(argv[5], &i32Offset)
+            || i32Kp < 0 || i32Kp > 255 || i32Ki < 0 || i32Ki > 255
+            || i32Offset < 0 || i32Offset > 100)
+        {
+            return 1;
+        }
+        sPoint.ui8Kp = i32Kp;
+        sPoint.ui8Ki = i32Ki;
+        sPoint.ui8Offset = i32Offset;
+        sPoint.ui8Reserved = 0;
+        vGSchedSet(d, h, &sPoint);
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("schedule %s, kp/ki/offset by main duty and height\n",
+               bControlScheduled() ? "on" : "off");
+    UARTprintf("main");
+    for (h = 0; h < GSCHED_HEIGHT_POINTS; h++)
+    {
+        UARTprintf("   h%3u    ", ui8GSchedHeightPoint(h));
+    }
+    UARTprintf("\n");
+    for (d = 0; d < GSCHED_DUTY_POINTS; d++)
+    {
+        UARTprintf("%3u ", ui8GSchedDutyPoint(d));
+        for (h = 0; h < GSCHED_HEIGHT_POINTS; h++)
+        {
+            vGSchedGet(d, h, &sPoint);
+            UARTprintf("  %3u/%u/%3u", sPoint.ui8Kp, sPoint.ui8Ki, sPoint.ui8Offset);
+        }
+        UARTprintf("\n");
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+static int
+CmdCal (int argc, char *argv[])
+{
+    CALIB_RECORD sRecord;
+    CALIB_LEARN sLearn;
+    int32_t i32Low, i32High;
+
+    vCalibGet(&sRecord);
+
+    if (argc == 2 && strcmp(argv[1], "auto") == 0)
+    {
+        vCalibLearnStart();
+    }
+    else if (argc >= 2 && fsm_get_state() != IDLE)
+    {
+        //
+        // Only change the calibration when landed, so the height and yaw do
+        // not jump in flight.
+        //
+        return 1;
+    }
+    else if (argc == 2 && strcmp(argv[1], "save") == 0)
+    {
+        if (ui32CalibSave() != 0)
+        {
+            return 1;
+        }
+    }
+    else if (argc == 2 && strcmp(argv[1], "default") == 0)
+    {
+        vCalibDefaults();
+    }
+    else if (argc == 4 && strcmp(argv[1], "height") == 0)
+    {
+        if (!bParseInt(argv[2], &i32Low) || !bParseInt(argv[3], &i32High)
+            || i32Low < 0 || i32Low > UINT16_MAX || i32High < 0 || i32High > UINT16_MAX)
+        {
+            return 1;
+        }
+        sRecord.ui16HeightLower = i32Low;
+        sRecord.ui16HeightUpper = i32High;
+        if (!bCalibSet(&sRecord))
+        {
+            return 1;
+        }
+    }
+    else if (argc == 3 && strcmp(argv[1], "slots") == 0)
+    {
+        if (!bParseInt(argv[2], &i32Low) || i32Low < 0 || i32Low > UINT16_MAX)
+        {
+            return 1;
+        }
+        sRecord.ui16EncoderSlots = i32Low;
+        if (!bCalibSet(&sRecord))
+        {
+            return 1;
+        }
+    }
+    else if (argc == 3 && strcmp(argv[1], "channel") == 0)
+    {
+        if (!bParseInt(argv[2], &i32Low) || i32Low < 0 || i32Low > UINT8_MAX)
+        {
+            return 1;
+        }
+        sRecord.ui8AdcChannel = i32Low;
+        if (!bCalibSet(&sRecord))
+        {
+            return 1;
+        }
+    }
+    else if (argc != 1)
+    {
+        return 1;
+    }
+
+    vCalibGet(&sRecord);
+    vCalibGetLearn(&sLearn);
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("calibration %s\n", bCalibLoaded() ? "loaded from EEPROM" : "defaults at start up");
+    UARTprintf("height raw %u to %u, ADC channel %u (used after reset)\n",
+               sRecord.ui16HeightLower, sRecord.ui16HeightUpper, sRecord.ui8AdcChannel);
+    UARTprintf("encoder %u edges per revolution\n", sRecord.ui16EncoderSlots);
+    if (sLearn.bLearning)
+    {
+        UARTprintf("learning: landed %u batches min %u, full throttle %u batches max %u\n",
+                   sLearn.ui32Landed, sLearn.ui16Min, sLearn.ui32Full, sLearn.ui16Max);
+    }
+    else if (sLearn.bRejected)
+    {
+        UARTprintf("learnt limits %u to %u rejected\n", sLearn.ui16Min, sLearn.ui16Max);
+    }
+    xSemaphoreGive(xUARTSemaphore);
+
+    return 0;
+}
+
+//*****************************************************************************
+//
+// Splits a line into words and runs the matching command.
+//
+//*****************************************************************************
+static void
+vConsoleProcessLine (char *pcLine)
+{
+    char *argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+    uint32_t i;
+    bool bInWord = false;
+
+    //
+    // Split the line in place on spaces.
+    //
+    for (; *pcLine != '\0'; pcLine++)
+    {
+        if (*pcLine == ' ')
+        {
+            *pcLine = '\0';
+            bInWord = false;
+        }
+        else if (!bInWord)
+        {
+            if (argc == CONSOLE_MAX_ARGS)
+            {
+                break;
+            }
+            argv[argc++] = pcLine;
+            bInWord = true;
+        }
+    }
+
+    if (argc == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < NUM_COMMANDS; i++)
+    {
+        if (strcmp(argv[0], g_psCommands[i].pcCommand) == 0)
+        {
+            if (g_psCommands[i].pfnCommand(argc, argv) != 0)
+            {
+                xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+                UARTprintf("usage: %s %s\n", g_psCommands[i].pcCommand, g_psCommands[i].pcHelp);
+                xSemaphoreGive(xUARTSemaphore);
+            }
+            return;
+        }
+    }
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("unknown command, try help\n");
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+//*****************************************************************************
+//
+// Writes characters to the UART while holding the UART mutex.
+//
+//*****************************************************************************
+static void
+vConsoleWrite (const char *pcBuf, uint32_t ui32Len)
+{
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTwrite(pcBuf, ui32Len);
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+//*****************************************************************************
+//
+// Reads characters from the stream buffer and edits the current line. Runs
+// the line when return is pressed.
+//
+//*****************************************************************************
+static void
+ConsoleTask (void *pvParameters)
+{
+    char pcLine[CONSOLE_LINE_SIZE];
+    char pcChunk[CONSOLE_RX_CHUNK];
+    uint32_t ui32Length = 0;
+    size_t xReceived;
+    size_t i;
+    char cPrevious = '\0';
+    char c;
+
+    vConsoleWrite("\n> ", 3);
+
+    while (1)
+    {
+        xReceived = xStreamBufferReceive(g_xConsoleRxBuffer, pcChunk, sizeof(pcChunk),
+                                         portMAX_DELAY);
+
+        for (i = 0; i < xReceived; i++)
+        {
+            c = pcChunk[i];
+
+            if (c == '\r' || c == '\n')
+            {
+                //
+                // Treat CR LF as a single end of line.
+                //
+                if (c == '\n' && cPrevious == '\r')
+                {
+                    cPrevious = c;
+                    continue;
+                }
+
+                vConsoleWrite("\n", 1);
+                pcLine[ui32Length] = '\0';
+                vConsoleProcessLine(pcLine);
+                ui32Length = 0;
+                vConsoleWrite("> ", 2);
+            }
+            else if (c == '\b' || c == 0x7F)
+            {
+                if (ui32Length > 0)
+                {
+                    ui32Length--;
+                    vConsoleWrite("\b \b", 3);
+                }
+            }
+            else if (c >= ' ' && c <= '~' && ui32Length < CONSOLE_LINE_SIZE - 1)
+            {
+                pcLine[ui32Length++] = c;
+                vConsoleWrite(&c, 1);
+            }
+
+            cPrevious = c;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Handles the UART receive and receive timeout interrupts. Moves everything in
+// the receive FIFO into the stream buffer.
+//
+//*****************************************************************************
+void
+ConsoleIntHandler (void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    char pcChunk[CONSOLE_RX_CHUNK];
+    uint32_t ui32Count = 0;
+    uint32_t ui32Status;
+
+    ui32Status = UARTIntStatus(UART0_BASE, true);
+    UARTIntClear(UART0_BASE, ui32Status);
+
+    while (UARTCharsAvail(UART0_BASE) && ui32Count < sizeof(pcChunk))
+    {
+        pcChunk[ui32Count++] = UARTCharGetNonBlocking(UART0_BASE);
+    }
+
+    if (ui32Count > 0)
+    {
+        xStreamBufferSendFromISR(g_xConsoleRxBuffer, pcChunk, ui32Count,
+                                 &xHigherPriorityTaskWoken);
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+//*****************************************************************************
+//
+// Initialises the Console task. The UART must already be configured by the
+// debugger module.
+//
+//*****************************************************************************
+uint32_t
+InitConsoleTask (void)
+{
+    g_xConsoleRxBuffer = xMemMapStreamBufferCreate(MEMMAP_STREAM_CONSOLE, 1);
+    if (g_xConsoleRxBuffer == NULL)
+    {
+        return(1);
+    }
+
+    if(xMemMapTaskCreate(MEMMAP_TASK_CONSOLE, ConsoleTask, NULL,
+                   tskIDLE_PRIORITY + CONSOLETASKPRIORITY, NULL) != pdTRUE)
+    {
+        return(1);
+    }
+
+    //
+    // Interrupt when the receive FIFO is half full or has been idle.
+    //
+    UARTIntRegister(UART0_BASE, ConsoleIntHandler);
+    IntPrioritySet(INT_UART0, CONSOLE_INT_PRIORITY);
+    UARTIntEnable(UART0_BASE, UART_INT_RX | UART_INT_RT);
+
+    return(0);
+}
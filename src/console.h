@@ -0,0 +1,32 @@
+/*
+ * File: console.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the console module. Contains a prototype to
+ * initialise the serial command console task.
+ *
+ *
+ */
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+//*****************************************************************************
+//
+// Prototypes for the console module.
+//
+//*****************************************************************************
+uint32_t InitConsoleTask (void);
+void ConsoleIntHandler (void);
+
+#endif /* CONSOLE_H_ */
@@ -13,12 +13,18 @@
  * Created on: 28.08.21
  *
  * Description: This module calculates the desired control signals for the helicopter. Uses pid.c and fsm.c.
+ * The reference yaw is passed through a rate and acceleration limited trajectory (traj.c) each control
+ * tick, so button steps do not reach the PI controller as steps. The gains and duty offset follow the
+ * gain schedule in gsched.c unless fixed gains are set from the console. The controller task is woken by
+ * each batch of height samples, whose conversions are triggered by a hardware timer, and the rotor task
+ * writes the PWM before it resumes. The time from the trigger to each stage is measured every cycle.
  *
  *
  */
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -33,14 +39,22 @@
 #include "rotor.h"
 #include "fsm.h"
 #include "debugger.h"
+#include "height.h"
+#include "health.h"
+#include "calib.h"
+#include "recorder.h"
+#include "gsched.h"
+#include "traj.h"
+#include "memmap.h"
 #include "priorities.h"
 
 //*****************************************************************************
 //
-// The stack size for the button task.
+// Limits of the tail duty. The lower limit is half the offset in use.
 //
 //*****************************************************************************
-#define CONTROLLERTASKSTACKSIZE        128         // Stack size in words
+#define DUTY_OFFSET             74          // Tail duty with zero error when not scheduled
+#define DUTY_MAX                95
 
 //*****************************************************************************
 //
@@ -49,6 +63,32 @@
 //*****************************************************************************
 static PI tail;
 
+//*****************************************************************************
+//
+// Yaw trajectory and its effect on the tail duty.
+//
+//*****************************************************************************
+static TRAJ g_sYawTraj;
+static int16_t g_i16YawSetpoint = 0;
+static uint32_t g_ui32Ticks = 0;            // PI updates
+static uint32_t g_ui32Saturated = 0;        // Of which the duty hit a limit
+static int16_t g_i16Overshoot = 0;          // Largest overshoot after a move
+
+//*****************************************************************************
+//
+// Gain schedule state.
+//
+//*****************************************************************************
+static bool g_bScheduled = true;
+static uint8_t g_ui8DutyOffset = DUTY_OFFSET;
+
+//*****************************************************************************
+//
+// Control pipeline timing, in CPU cycles from the ADC trigger.
+//
+//*****************************************************************************
+static CONTROL_LOOP_STATS g_sLoop;
+
 //*****************************************************************************
 //
 // Local prototypes for the controller module.
@@ -58,7 +98,37 @@ static PI tail;
 
 //*****************************************************************************
 //
-// FreeRTOS task. Updates fsm state.
+// Records the timing of one control cycle.
+//
+//*****************************************************************************
+static void
+vLoopRecord(uint32_t ui32Sense, uint32_t ui32Wake, uint32_t ui32Act)
+{
+    taskENTER_CRITICAL();
+    if (g_sLoop.ui32Cycles == 0 || ui32Act < g_sLoop.ui32ActMin)
+    {
+        g_sLoop.ui32ActMin = ui32Act;
+    }
+    if (ui32Act > g_sLoop.ui32ActMax)
+    {
+        g_sLoop.ui32ActMax = ui32Act;
+    }
+    if (ui32Sense > g_sLoop.ui32SenseMax)
+    {
+        g_sLoop.ui32SenseMax = ui32Sense;
+    }
+    if (ui32Wake > g_sLoop.ui32WakeMax)
+    {
+        g_sLoop.ui32WakeMax = ui32Wake;
+    }
+    g_sLoop.ui32ActTotal += ui32Act;
+    g_sLoop.ui32Cycles++;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// FreeRTOS task. Updates fsm state once per batch of height samples.
 //
 //*****************************************************************************
 static void
@@ -66,24 +136,60 @@ ControllerTask (void *pvParameters)
 {
     /*PI Controller for Helirig emulator. Calculates duty for tail rotor.*/
 
-
-    portTickType ui16DelayTime;
-    uint32_t ui32ControllerDelay = 25;  //task operates every 25 ms
-
-    ui16DelayTime = xTaskGetTickCount();
+    uint32_t ui32Batches;
+    uint32_t ui32Wake;
 
     while(1)
     {
+        //
+        // Wait for a control period of height samples. If the samples stop,
+        // keep running at roughly the control period.
+        //
+        ui32Batches = ui32HeightReceiveBatches(pdMS_TO_TICKS(2 * CONTROLLER_PERIOD_MS));
+        ui32Wake = ui32HeightCyclesSinceTrigger();
+
+        if (ui32Batches == 0)
+        {
+            g_sLoop.ui32Timeouts++;
+        }
+        else if (ui32Batches > 1)
+        {
+            g_sLoop.ui32Overruns += ui32Batches - 1;    // Batches missed while running
+        }
+
+        vHealthUpdate(ui32Batches != 0);
+        vCalibUpdate(ui32Batches != 0);
+
+        g_i16YawSetpoint = i16TrajStep(&g_sYawTraj, GetRefYaw());
 
         fsm_update();
 
         //
-        // Wait for the required amount of time to check back.
+        // Any new duty has been written by the higher priority rotor task.
         //
-        vTaskDelayUntil(&ui16DelayTime, ui32ControllerDelay / portTICK_RATE_MS);
+        if (ui32Batches != 0)
+        {
+            vLoopRecord(ui32HeightSenseCycles(), ui32Wake, ui32HeightCyclesSinceTrigger());
+        }
+
+        vRecordSample();
     }
 }
 
+//*****************************************************************************
+//
+// Returns the control pipeline timing, then clears it.
+//
+//*****************************************************************************
+void
+vControlGetLoopStats(CONTROL_LOOP_STATS *psStats)
+{
+    taskENTER_CRITICAL();
+    *psStats = g_sLoop;
+    memset(&g_sLoop, 0, sizeof(g_sLoop));
+    taskEXIT_CRITICAL();
+}
+
 //*****************************************************************************
 //
 // Initialises the Controller task.
@@ -94,12 +200,13 @@ InitControllerTask(void)
 {
 
     vControlInit();
+    fsm_init(); // Start in IDLE with the rotors off.
 
     //
     // Create the controller task.
     //
-    if(xTaskCreate(ControllerTask, (const portCHAR *)"Controller",
-                   CONTROLLERTASKSTACKSIZE, NULL, tskIDLE_PRIORITY + CONTROLLERTASKPRIORITY, NULL) != pdTRUE)
+    if(xMemMapTaskCreate(MEMMAP_TASK_CONTROLLER, ControllerTask, NULL,
+                   tskIDLE_PRIORITY + CONTROLLERTASKPRIORITY, NULL) != pdTRUE)
 
     {
         return(1);
@@ -125,6 +232,155 @@ vControlInit(void)
     uint8_t ki = 1/1000;
     uint8_t limit = 5;
     pi_init(&tail, kp, ki, limit);
+
+    bGSchedInit(); // Keeps the default schedule if flash holds none.
+
+    vTrajInit(&g_sYawTraj, YAW_TRAJ_RATE, YAW_TRAJ_ACCEL, 360, CONTROLLER_PERIOD_MS);
+    g_sYawTraj.bEnabled = true;
+}
+
+//*****************************************************************************
+//
+// Replaces the PI gains of the tail rotor controller, e.g. from the serial
+// console. The integral accumulator is reset and the gain schedule is turned
+// off so the gains stay fixed.
+//
+//*****************************************************************************
+void
+vControlSetGains(uint8_t kp, uint8_t ki, uint8_t limit)
+{
+    taskENTER_CRITICAL();
+    g_bScheduled = false;
+    g_ui8DutyOffset = DUTY_OFFSET;
+    pi_init(&tail, kp, ki, limit);
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Turns the gain schedule on or off, and reports whether it is on.
+//
+//*****************************************************************************
+void
+vControlSetScheduled(bool bScheduled)
+{
+    taskENTER_CRITICAL();
+    g_bScheduled = bScheduled;
+    if (!bScheduled)
+    {
+        g_ui8DutyOffset = DUTY_OFFSET;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool
+bControlScheduled(void)
+{
+    return g_bScheduled;
+}
+
+//*****************************************************************************
+//
+// Called by fsm.c before each update with the main rotor duty it is about to
+// send. Looks up the gains and duty offset for that duty at the current
+// height. The integral accumulator is kept.
+//
+//*****************************************************************************
+void
+vControlSchedule(uint16_t main)
+{
+    GSCHED_POINT sPoint;
+
+    if (!g_bScheduled)
+    {
+        return;
+    }
+
+    vGSchedLookup(main, GetHeight(), &sPoint);
+
+    taskENTER_CRITICAL();
+    pi_set_gains(&tail, sPoint.ui8Kp, sPoint.ui8Ki);
+    g_ui8DutyOffset = sPoint.ui8Offset;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Clears the integral accumulator of the tail rotor controller, keeping the
+// gains, and starts the yaw trajectory from the current yaw. Called by fsm.c
+// before the controller takes over the tail rotor.
+//
+//*****************************************************************************
+void
+vControlReset(void)
+{
+    taskENTER_CRITICAL();
+    pi_init(&tail, tail.kp, tail.ki, tail.limit);
+    taskEXIT_CRITICAL();
+
+    vTrajReset(&g_sYawTraj, GetYawAngle());
+    g_i16YawSetpoint = GetYawAngle();
+}
+
+//*****************************************************************************
+//
+// Returns the reference yaw after the trajectory, for the PI controller.
+//
+//*****************************************************************************
+int16_t
+i16ControlGetRefYaw(void)
+{
+    return g_i16YawSetpoint;
+}
+
+//*****************************************************************************
+//
+// Turns the yaw trajectory on or off. When off, button steps go straight to
+// the PI controller.
+//
+//*****************************************************************************
+void
+vControlSetTrajectory(bool bEnabled)
+{
+    g_sYawTraj.bEnabled = bEnabled;
+}
+
+//*****************************************************************************
+//
+// Returns the trajectory and duty statistics, then clears them so that runs
+// with the trajectory on and off can be compared.
+//
+//*****************************************************************************
+void
+vControlGetTrajStats(CONTROL_TRAJ_STATS *psStats)
+{
+    taskENTER_CRITICAL();
+    psStats->bEnabled = g_sYawTraj.bEnabled;
+    psStats->ui32Steps = g_sYawTraj.ui32Steps;
+    psStats->ui32RateLimited = g_sYawTraj.ui32RateLimited;
+    psStats->ui32Ticks = g_ui32Ticks;
+    psStats->ui32Saturated = g_ui32Saturated;
+    psStats->i16Overshoot = g_i16Overshoot;
+
+    g_sYawTraj.ui32Steps = 0;
+    g_sYawTraj.ui32RateLimited = 0;
+    g_ui32Ticks = 0;
+    g_ui32Saturated = 0;
+    g_i16Overshoot = 0;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Returns the current PI gains of the tail rotor controller.
+//
+//*****************************************************************************
+void
+vControlGetGains(uint8_t *kp, uint8_t *ki, uint8_t *limit)
+{
+    *kp = tail.kp;
+    *ki = tail.ki;
+    *limit = tail.limit;
 }
 
 //*****************************************************************************
@@ -150,6 +406,15 @@ vControlUpdate(int16_t error)
     dt = 1000*(ui16CurTime - ui16LastTime) / configTICK_RATE_HZ; //in ms
 
     pi_update(&tail, error, dt);
+
+    //
+    // Once the setpoint has stopped, yaw past it in the direction of the last
+    // move is overshoot.
+    //
+    if (bTrajSettled(&g_sYawTraj) && -error * g_sYawTraj.i8Dir > g_i16Overshoot)
+    {
+        g_i16Overshoot = -error * g_sYawTraj.i8Dir;
+    }
 }
 
 //*****************************************************************************
@@ -178,30 +443,99 @@ i16GetError(uint16_t ref, int16_t cur)
 
 //*****************************************************************************
 //
-// Returns duty for the tail rotor using a PI controller.
+// Adds the duty offset to a PI output and limits the result to the tail duty
+// range. Sets *pbSaturated if it was limited.
 //
 //*****************************************************************************
 uint16_t
-ui16ControlGet(void)
+ui16ControlDuty(int16_t output, uint16_t offset, bool *pbSaturated)
 {
     //
     // initialise limits
     //
-    uint16_t dutyOffset = 74;
-    uint16_t dutyMax = 95;
-    uint16_t dutyMin = dutyOffset/2;
-    uint16_t duty;
-
-    duty = pi_get(&tail);
-    duty += dutyOffset;
+    int32_t dutyMax = DUTY_MAX;
+    int32_t dutyMin = offset/2;
+    int32_t duty = (int32_t) output + offset;
 
+    *pbSaturated = true;
     if (duty >= dutyMax)
     {
-        duty = dutyMax;
+        return dutyMax;
     }
     else if (duty <= dutyMin)
     {
-        duty = dutyMin;
+        return dutyMin;
+    }
+
+    *pbSaturated = false;
+    return duty;
+}
+
+//*****************************************************************************
+//
+// Returns the gains and duty offset the controller uses at a main rotor duty
+// and height: from the gain schedule if it is on, otherwise the fixed ones.
+//
+//*****************************************************************************
+void
+vControlGainsAt(uint16_t main, uint16_t height, uint8_t *kp, uint8_t *ki, uint8_t *offset)
+{
+    GSCHED_POINT sPoint;
+
+    if (g_bScheduled)
+    {
+        vGSchedLookup(main, height, &sPoint);
+        *kp = sPoint.ui8Kp;
+        *ki = sPoint.ui8Ki;
+        *offset = sPoint.ui8Offset;
+    }
+    else
+    {
+        *kp = tail.kp;
+        *ki = tail.ki;
+        *offset = DUTY_OFFSET;
+    }
+}
+
+//*****************************************************************************
+//
+// Returns the tail duty the controller gives with zero error.
+//
+//*****************************************************************************
+uint8_t
+ui8ControlDutyOffset(void)
+{
+    return g_ui8DutyOffset;
+}
+
+//*****************************************************************************
+//
+// Returns true if the yaw trajectory is on.
+//
+//*****************************************************************************
+bool
+bControlTrajectory(void)
+{
+    return g_sYawTraj.bEnabled;
+}
+
+//*****************************************************************************
+//
+// Returns duty for the tail rotor using a PI controller.
+//
+//*****************************************************************************
+uint16_t
+ui16ControlGet(void)
+{
+    uint16_t duty;
+    bool bSaturated;
+
+    duty = ui16ControlDuty(pi_get(&tail), g_ui8DutyOffset, &bSaturated);
+
+    g_ui32Ticks++;
+    if (bSaturated)
+    {
+        g_ui32Saturated++;
     }
 
     SendToDebugger (duty, DUTY);
@@ -13,7 +13,9 @@
  * Created on: 28.08.21
  *
  * Description: Header file for the controller module. Contains functions to initialise the
- * controller task, get the yaw error and update the duty cycle.
+ * controller task, get the yaw error, update the duty cycle and set the PI gains.
+ * Also reads the smoothed reference yaw and the trajectory statistics, and
+ * applies the gain schedule for the current main rotor duty.
  *
  *
  */
@@ -21,6 +23,52 @@
 #ifndef CONTROLLER_TASK_H_
 #define CONTROLLER_TASK_H_
 
+//*****************************************************************************
+//
+// The control period. The height ADC is triggered at this rate.
+//
+//*****************************************************************************
+#define CONTROLLER_PERIOD_MS    25
+
+//*****************************************************************************
+//
+// Limits of the yaw trajectory.
+//
+//*****************************************************************************
+#define YAW_TRAJ_RATE           90          // deg/s
+#define YAW_TRAJ_ACCEL          180         // deg/s^2
+
+//*****************************************************************************
+//
+// Control pipeline timing since it was last read, in CPU cycles from the
+// hardware timer triggering the ADC.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Cycles;
+    uint32_t ui32SenseMax;      // Sample stored by the ADC interrupt
+    uint32_t ui32WakeMax;       // Controller task running
+    uint32_t ui32ActMin;        // Duty written to the PWM
+    uint32_t ui32ActMax;
+    uint32_t ui32ActTotal;
+    uint32_t ui32Overruns;      // Batches missed because a cycle ran late
+    uint32_t ui32Timeouts;      // Cycles run without a batch
+} CONTROL_LOOP_STATS;
+
+//*****************************************************************************
+//
+// Yaw trajectory and tail duty statistics since they were last read.
+//
+//*****************************************************************************
+typedef struct {
+    bool bEnabled;
+    uint32_t ui32Steps;         // Reference changes
+    uint32_t ui32RateLimited;   // Ticks the setpoint moved at the rate limit
+    uint32_t ui32Ticks;         // PI updates
+    uint32_t ui32Saturated;     // Of which the tail duty was at a limit
+    int16_t i16Overshoot;       // Largest overshoot after a move, degrees
+} CONTROL_TRAJ_STATS;
+
 //*****************************************************************************
 //
 // Prototypes for the controller module.
@@ -28,8 +76,22 @@
 //*****************************************************************************
 void vControlInit(void);
 void vControlUpdate(int16_t);
+void vControlSetGains(uint8_t, uint8_t, uint8_t);
+void vControlReset(void);
+void vControlSetScheduled(bool);
+bool bControlScheduled(void);
+void vControlSchedule(uint16_t);
+int16_t i16ControlGetRefYaw(void);
+void vControlSetTrajectory(bool);
+void vControlGetTrajStats(CONTROL_TRAJ_STATS *);
+void vControlGetGains(uint8_t *, uint8_t *, uint8_t *);
 uint16_t ui16ControlGet();
+uint16_t ui16ControlDuty(int16_t, uint16_t, bool *);
+void vControlGainsAt(uint16_t, uint16_t, uint8_t *, uint8_t *, uint8_t *);
+bool bControlTrajectory(void);
+uint8_t ui8ControlDutyOffset(void);
 int16_t i16GetError(uint16_t, int16_t);
+void vControlGetLoopStats(CONTROL_LOOP_STATS *);
 uint32_t InitControllerTask(void);
 
 #endif /* CONTROLLER_TASK_H_ */
@@ -0,0 +1,390 @@
+/*
+ * File: ctlbench.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Controller benchmark. The yaw loop of the firmware (trajectory,
+ * gain schedule, PI controller, duty limits and rotor slew limit) is run in
+ * simulated time against a plant model through a fixed list of scenarios:
+ * a held yaw, yaw steps, a main rotor duty step, a gust and sensor noise.
+ * Each scenario prints one CSV line with the rise time, overshoot, settling
+ * time, integral of absolute error and control effort, so tunings and
+ * firmware versions can be compared from a console log. The simulated
+ * encoder edges are also fed to the encoder check of the health module,
+ * which must not latch in any scenario.
+ *
+ * The plant is a rough model of the rig emulator: yaw acceleration is
+ * proportional to the tail duty above the duty that balances the main rotor,
+ * less viscous damping. The real flight controller is not touched.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils/uartstdio.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "ctlbench.h"
+#include "controller.h"
+#include "debugger.h"
+#include "rotor.h"
+#include "pid.h"
+#include "traj.h"
+#include "health.h"
+#include "calib.h"
+#include "fsm.h"
+
+//*****************************************************************************
+//
+// Simulation settings.
+//
+//*****************************************************************************
+#define CTLBENCH_TICKS          320         // 8 s of control periods
+#define CTLBENCH_SUBSTEPS       5           // Plant steps per control period
+#define CTLBENCH_STEP_MS        (CONTROLLER_PERIOD_MS / CTLBENCH_SUBSTEPS)
+#define CTLBENCH_MAIN_DUTY      90          // FLYING main duty in fsm.c
+#define CTLBENCH_HEIGHT         50
+#define CTLBENCH_GUST_START     20          // Ticks
+#define CTLBENCH_MAIN_STEP_TICK 80          // Time to settle at the lower main duty
+#define CTLBENCH_GUST_TICKS     8
+#define CTLBENCH_SEED           0x2545F491
+
+//*****************************************************************************
+//
+// Plant model. Yaw acceleration in mdeg/s^2 per per-mille of tail duty above
+// the balance duty, and damping in 1/s.
+//
+//*****************************************************************************
+#define PLANT_TORQUE            1000
+#define PLANT_DAMPING           8
+#define PLANT_BALANCE(main)     (200 + (main) * 6)      // Per-mille, 74% at 90% main
+
+//*****************************************************************************
+//
+// The scenarios.
+//
+//*****************************************************************************
+typedef enum {
+    SCENARIO_YAW_STEP,      // Reference step of amp degrees
+    SCENARIO_MAIN_STEP,     // Main duty steps up by amp percent to CTLBENCH_MAIN_DUTY mid-run
+    SCENARIO_GUST,          // Torque of amp percent tail duty for CTLBENCH_GUST_TICKS
+    SCENARIO_NOISE          // 30 degree step with +-amp degrees of sensor noise
+} SCENARIO_TYPE;
+
+typedef struct {
+    const char      *pcName;
+    SCENARIO_TYPE   eType;
+    int16_t         i16Amp;
+} SCENARIO;
+
+static const SCENARIO g_psScenarios[] = {
+    { "hold",   SCENARIO_YAW_STEP,  0 },
+    { "step",   SCENARIO_YAW_STEP,  10 },
+    { "step",   SCENARIO_YAW_STEP,  30 },
+    { "step",   SCENARIO_YAW_STEP,  90 },
+    { "step",   SCENARIO_YAW_STEP,  180 },
+    { "main",   SCENARIO_MAIN_STEP, 20 },
+    { "gust",   SCENARIO_GUST,      10 },
+    { "noise",  SCENARIO_NOISE,     2 },
+};
+
+#define NUM_SCENARIOS           (sizeof(g_psScenarios) / sizeof(g_psScenarios[0]))
+
+//*****************************************************************************
+//
+// Struct for the results of one scenario. Times in ms from the step or the
+// start of the run, angles in mdeg. Nothing before the step is counted.
+//
+//*****************************************************************************
+typedef struct {
+    int32_t i32RiseMs;          // 10% to 90% of a step, -1 if none
+    int32_t i32Overshoot;       // Furthest yaw past the target
+    int32_t i32SettleMs;        // Last time outside the settling band
+    uint32_t ui32Iae;           // Integral of |error|, mdeg.s
+    uint32_t ui32Effort;        // Integral of |tail - balance|, per-mille.s
+                                // Both are summed in ms and scaled at the end.
+    uint32_t ui32Saturated;     // Control periods at a duty limit
+    int32_t i32EncoderMs;       // From the start of the run to the encoder check
+                                // latching, -1 if it never does
+} CTLBENCH_RESULT;
+
+//*****************************************************************************
+//
+// Local prototypes for the controller benchmark.
+//
+//*****************************************************************************
+static int32_t i32Noise (uint32_t *pui32State, int32_t i32Amp);
+static int16_t i16Measure (int32_t i32YawUdeg);
+static void vRunScenario (const SCENARIO *psScenario, CTLBENCH_RESULT *psResult);
+
+//*****************************************************************************
+//
+// Uniform noise in -amp to amp from a xorshift generator, so every run of a
+// scenario sees the same noise.
+//
+//*****************************************************************************
+static int32_t
+i32Noise (uint32_t *pui32State, int32_t i32Amp)
+{
+    uint32_t x = *pui32State;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pui32State = x;
+
+    return (int32_t) (x % (2 * i32Amp + 1)) - i32Amp;
+}
+
+//*****************************************************************************
+//
+// Converts the simulated yaw to the whole degrees, 0 to 359, that the yaw
+// module reports.
+//
+//*****************************************************************************
+static int16_t
+i16Measure (int32_t i32YawUdeg)
+{
+    int32_t i32Deg = i32YawUdeg / 1000000;
+
+    i32Deg %= 360;
+    if (i32Deg < 0)
+    {
+        i32Deg += 360;
+    }
+    return i32Deg;
+}
+
+//*****************************************************************************
+//
+// Runs one scenario from rest at zero yaw.
+//
+//*****************************************************************************
+static void
+vRunScenario (const SCENARIO *psScenario, CTLBENCH_RESULT *psResult)
+{
+    PI sPI;
+    TRAJ sTraj;
+    HEALTH_SPIN sSpin = { 0, 0 };
+    int32_t i32EdgeUdeg = 360000000 / psCalibFactors()->ui16EncoderSlots;
+    uint8_t ui8Kp, ui8Ki, ui8Offset, ui8Limit;
+    uint16_t ui16TailRate, ui16MainRate;
+    int32_t i32YawUdeg = 0;             // Plant yaw, micro degrees
+    int32_t i32RateMdeg = 0;            // Plant yaw rate, mdeg/s
+    int32_t i32TailOut;                 // Tail duty after the slew limit, per-mille
+    int32_t i32TailCmd;
+    int32_t i32Balance;
+    int32_t i32Disturb;
+    int32_t i32Target = 0;              // mdeg
+    int32_t i32Error;
+    int32_t i32Band;
+    int32_t i32Response;
+    int32_t i32Rise10 = -1, i32Rise90 = -1;
+    int16_t i16Ref = 0;
+    int16_t i16Setpoint;
+    int16_t i16Measured;
+    int16_t i16Error;
+    uint16_t ui16Main = CTLBENCH_MAIN_DUTY;
+    uint16_t ui16Duty = 0;
+    uint32_t ui32Seed = CTLBENCH_SEED;
+    uint32_t ui32Tick, ui32Sub;
+    uint32_t ui32StepTick = 0;          // Start of the metrics
+    bool bSaturated;
+
+    psResult->i32Overshoot = 0;
+    psResult->i32SettleMs = 0;
+    psResult->ui32Iae = 0;
+    psResult->ui32Effort = 0;
+    psResult->ui32Saturated = 0;
+    psResult->i32EncoderMs = -1;
+
+    if (psScenario->eType == SCENARIO_YAW_STEP || psScenario->eType == SCENARIO_NOISE)
+    {
+        i16Ref = (psScenario->eType == SCENARIO_NOISE) ? 30 : psScenario->i16Amp;
+        i32Target = (int32_t) i16Ref * 1000;
+    }
+
+    //
+    // Start balanced. The main step runs at the lower main duty until the
+    // loop has settled, then steps up.
+    //
+    if (psScenario->eType == SCENARIO_MAIN_STEP)
+    {
+        ui16Main = CTLBENCH_MAIN_DUTY - psScenario->i16Amp;
+        ui32StepTick = CTLBENCH_MAIN_STEP_TICK;
+    }
+    i32TailOut = PLANT_BALANCE(ui16Main);
+    i16Ref %= 360;
+
+    vControlGetGains(&ui8Kp, &ui8Ki, &ui8Limit);
+    vControlGainsAt(ui16Main, CTLBENCH_HEIGHT, &ui8Kp, &ui8Ki, &ui8Offset);
+    pi_init(&sPI, ui8Kp, ui8Ki, ui8Limit);
+    vGetRotorSlew(&ui16TailRate, &ui16MainRate);
+    vTrajInit(&sTraj, YAW_TRAJ_RATE, YAW_TRAJ_ACCEL, 360, CONTROLLER_PERIOD_MS);
+    sTraj.bEnabled = bControlTrajectory();
+
+    i32Band = i32Target / 50;                       // 2% of the step, at least 1 degree
+    if (i32Band < 1000)
+    {
+        i32Band = 1000;
+    }
+
+    for (ui32Tick = 0; ui32Tick < CTLBENCH_TICKS; ui32Tick++)
+    {
+        if (psScenario->eType == SCENARIO_MAIN_STEP && ui32Tick == ui32StepTick)
+        {
+            ui16Main = CTLBENCH_MAIN_DUTY;
+        }
+
+        //
+        // Controller, as run by the controller task and fsm.c in FLYING.
+        // The gains and offset follow the main duty, as vControlSchedule
+        // does.
+        //
+        vControlGainsAt(ui16Main, CTLBENCH_HEIGHT, &ui8Kp, &ui8Ki, &ui8Offset);
+        pi_set_gains(&sPI, ui8Kp, ui8Ki);
+
+        i16Measured = i16Measure(i32YawUdeg);
+        if (psScenario->eType == SCENARIO_NOISE)
+        {
+            i16Measured = (i16Measured + i32Noise(&ui32Seed, psScenario->i16Amp) + 360) % 360;
+        }
+        i16Setpoint = i16TrajStep(&sTraj, i16Ref);
+        i16Error = i16GetError(i16Setpoint, i16Measured);
+
+        //
+        // Encoder check, as run by the health module before the controller.
+        //
+        if (bHealthSpinUpdate(&sSpin, i32YawUdeg / i32EdgeUdeg,
+                              ui32Tick != 0 && bHealthShouldTurn(FLYING, ui16Duty, ui8Offset, i16Error),
+                              CONTROLLER_PERIOD_MS)
+            && psResult->i32EncoderMs < 0)
+        {
+            psResult->i32EncoderMs = ui32Tick * CONTROLLER_PERIOD_MS;
+        }
+
+        pi_update(&sPI, i16Error, CONTROLLER_PERIOD_MS);
+        ui16Duty = ui16ControlDuty(pi_get(&sPI), ui8Offset, &bSaturated);
+        i32TailCmd = ui16Duty * 10;
+        if (bSaturated && ui32Tick >= ui32StepTick)
+        {
+            psResult->ui32Saturated++;
+        }
+
+        //
+        // Plant, with the rotor slew limit.
+        //
+        i32Balance = PLANT_BALANCE(ui16Main);
+        i32Disturb = 0;
+        if (psScenario->eType == SCENARIO_GUST && ui32Tick >= CTLBENCH_GUST_START
+            && ui32Tick < CTLBENCH_GUST_START + CTLBENCH_GUST_TICKS)
+        {
+            i32Disturb = psScenario->i16Amp * 10;
+        }
+
+        for (ui32Sub = 0; ui32Sub < CTLBENCH_SUBSTEPS; ui32Sub++)
+        {
+            int32_t i32Step = ui16TailRate * CTLBENCH_STEP_MS / 1000;
+
+            if (i32TailCmd > i32TailOut + i32Step)
+            {
+                i32TailOut += i32Step;
+            }
+            else if (i32TailCmd < i32TailOut - i32Step)
+            {
+                i32TailOut -= i32Step;
+            }
+            else
+            {
+                i32TailOut = i32TailCmd;
+            }
+
+            i32RateMdeg += (PLANT_TORQUE * (i32TailOut - i32Balance + i32Disturb)
+                            - PLANT_DAMPING * i32RateMdeg) * CTLBENCH_STEP_MS / 1000;
+            i32YawUdeg += i32RateMdeg * CTLBENCH_STEP_MS;
+        }
+
+        //
+        // Metrics. The error is against the final target, not the trajectory.
+        //
+        if (ui32Tick < ui32StepTick)
+        {
+            continue;
+        }
+        i32Response = i32YawUdeg / 1000;
+        i32Error = i32Target - i32Response;
+
+        if (i32Rise10 < 0 && i32Target != 0 && i32Response * 10 >= i32Target)
+        {
+            i32Rise10 = ui32Tick;
+        }
+        if (i32Rise90 < 0 && i32Target != 0 && i32Response * 10 >= i32Target * 9)
+        {
+            i32Rise90 = ui32Tick;
+        }
+        if (i32Target == 0 && i32Error > 0)
+        {
+            i32Error = -i32Error;                   // Disturbances: either direction
+        }
+        if (-i32Error > psResult->i32Overshoot)
+        {
+            psResult->i32Overshoot = -i32Error;
+        }
+        if (i32Error > i32Band || i32Error < -i32Band)
+        {
+            psResult->i32SettleMs = (ui32Tick + 1 - ui32StepTick) * CONTROLLER_PERIOD_MS;
+        }
+        psResult->ui32Iae += ((i32Error < 0) ? -i32Error : i32Error) * CONTROLLER_PERIOD_MS;
+        psResult->ui32Effort += ((i32TailOut > i32Balance) ? i32TailOut - i32Balance
+                                                           : i32Balance - i32TailOut)
+                                * CONTROLLER_PERIOD_MS;
+    }
+
+    psResult->ui32Iae /= 1000;
+    psResult->ui32Effort /= 1000;
+
+    psResult->i32RiseMs = (i32Rise90 >= 0) ? (i32Rise90 - i32Rise10) * CONTROLLER_PERIOD_MS : -1;
+}
+
+//*****************************************************************************
+//
+// Runs every scenario and prints a CSV line for each. The simulation takes a
+// few tens of ms of CPU time at the console's priority.
+//
+//*****************************************************************************
+void
+vCtlBenchRun (void)
+{
+    CTLBENCH_RESULT sResult;
+    uint32_t i;
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+    UARTprintf("ctlbench,scenario,amp,rise_ms,overshoot_mdeg,settle_ms,iae_mdeg_s,effort_pm_s,saturated,encoder_fault_ms\n");
+    xSemaphoreGive(xUARTSemaphore);
+
+    for (i = 0; i < NUM_SCENARIOS; i++)
+    {
+        vRunScenario(&g_psScenarios[i], &sResult);
+
+        xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+        UARTprintf("ctlbench,%s,%d,%d,%d,%d,%u,%u,%u,%d\n", g_psScenarios[i].pcName,
+                   g_psScenarios[i].i16Amp, sResult.i32RiseMs, sResult.i32Overshoot,
+                   sResult.i32SettleMs, sResult.ui32Iae, sResult.ui32Effort,
+                   sResult.ui32Saturated, sResult.i32EncoderMs);
+        xSemaphoreGive(xUARTSemaphore);
+    }
+}
@@ -0,0 +1,32 @@
+/*
+ * File: ctlbench.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the controller benchmark. Runs the tail
+ * controller against a simulated plant through a list of scenarios and
+ * prints the results as CSV.
+ *
+ *
+ */
+
+#ifndef CTLBENCH_H_
+#define CTLBENCH_H_
+
+//*****************************************************************************
+//
+// Prototypes for the controller benchmark.
+//
+//*****************************************************************************
+void vCtlBenchRun (void);
+
+#endif /* CTLBENCH_H_ */
@@ -0,0 +1,55 @@
+/*
+ * File: cycles.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Access to the Cortex-M4 DWT cycle counter for timing code on
+ * the target. The counter runs at the CPU clock and wraps every ~86 s at
+ * 50 MHz, so differences of two readings are valid for shorter intervals.
+ *
+ *
+ */
+
+#ifndef CYCLES_H_
+#define CYCLES_H_
+
+//*****************************************************************************
+//
+// Debug and trace registers used by the cycle counter.
+//
+//*****************************************************************************
+#define CYCLES_DEMCR_R          (*((volatile uint32_t *)0xE000EDFC))
+#define CYCLES_DWT_CTRL_R       (*((volatile uint32_t *)0xE0001000))
+#define CYCLES_DWT_CYCCNT_R     (*((volatile uint32_t *)0xE0001004))
+
+#define CYCLES_DEMCR_TRCENA     0x01000000  // Enable DWT and ITM
+#define CYCLES_DWT_CYCCNTENA    0x00000001  // Enable the cycle counter
+
+//*****************************************************************************
+//
+// Enables the cycle counter. Safe to call more than once.
+//
+//*****************************************************************************
+#define CyclesInit()                                    \
+    do {                                                \
+        CYCLES_DEMCR_R |= CYCLES_DEMCR_TRCENA;          \
+        CYCLES_DWT_CTRL_R |= CYCLES_DWT_CYCCNTENA;      \
+    } while (0)
+
+//*****************************************************************************
+//
+// Returns the current cycle count.
+//
+//*****************************************************************************
+#define CyclesGet()             (CYCLES_DWT_CYCCNT_R)
+
+#endif /* CYCLES_H_ */
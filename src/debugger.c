@@ -13,7 +13,8 @@
  * Created on: 28.08.21
  *
  * Description: This module is responsible for accessing the UART peripheral. It uses a queue
- * to receive data to be printed from other modules.
+ * to receive data to be printed from other modules. The latest values are printed at a
+ * telemetry period that can be changed at run time.
  *
  * Adapted from freertos_demo.c - Simple FreeRTOS example.
  *
@@ -35,23 +36,32 @@
 #include "semphr.h"
 
 #include "debugger.h"
+#include "memmap.h"
+#include "refqueue.h"
 #include "priorities.h"
 #include "fsm.h"
 
 //*****************************************************************************
 //
-// The stack size for the debug task.
+// Default period between telemetry prints. Zero disables printing.
 //
 //*****************************************************************************
-#define DEBUGTASKSTACKSIZE          128
+#define DEBUG_DEFAULT_PERIOD      1000        // ms
+
+static volatile uint32_t g_ui32DebugPeriod = DEBUG_DEFAULT_PERIOD;
 
 //*****************************************************************************
 //
-// Defining debug queue length and item size.
+// Pool of debug records. Senders fill a record in place and queue a pointer
+// to it; the debug task returns it once read. One record per queue slot, so
+// the queue can never be full while a record is available.
 //
 //*****************************************************************************
-#define DEBUG_ITEM_SIZE           sizeof(DEBUG_VALUES)
-#define DEBUG_QUEUE_SIZE          10
+#define DEBUG_POOL_BLOCKS         10
+
+static DEBUG_VALUES g_psDebugBlocks[DEBUG_POOL_BLOCKS];
+static MEMPOOL g_sDebugPool;
+static REFQUEUE g_sDebugRefQueue;
 
 //*****************************************************************************
 //
@@ -97,7 +107,7 @@ ConfigureUART(void)
 static void
 DebugTask (void *pvParameters)
 {
-    DEBUG_VALUES   SERIAL_VALUE;
+    DEBUG_VALUES   *pSERIAL_VALUE;
 
     static uint16_t ui16Yaw = 0;
     static uint16_t ui16RefYaw = 0;
@@ -106,31 +116,59 @@ DebugTask (void *pvParameters)
     static uint16_t ui16State = 0;
     static uint16_t ui16Duty = 0;
 
+    TickType_t xNextPrint = xTaskGetTickCount();
+    TickType_t xWait;
+    TickType_t xNow;
+
     while (1)
     {
-        if(xQueueReceive(g_pDebugQueue, &(SERIAL_VALUE), 0) == pdPASS) // Receive from the debug queue and check it was successful.
+        //
+        // Block until a value arrives or the next print is due.
+        //
+        xNow = xTaskGetTickCount();
+        if (g_ui32DebugPeriod == 0)
+        {
+            xWait = portMAX_DELAY;
+        }
+        else if ((int32_t) (xNextPrint - xNow) > 0)
+        {
+            xWait = xNextPrint - xNow;
+        }
+        else
         {
-            switch (SERIAL_VALUE.Source) {
+            xWait = 0;
+        }
+
+        if(xRefQueueReceive(&g_sDebugRefQueue, (void **) &pSERIAL_VALUE, xWait) == pdPASS) // Receive from the debug queue and check it was successful.
+        {
+            switch (pSERIAL_VALUE->Source) {
                 case YAW:
-                    ui16Yaw = SERIAL_VALUE.Value;
+                    ui16Yaw = pSERIAL_VALUE->Value;
                     break;
                 case YAWREF:
-                    ui16RefYaw = SERIAL_VALUE.Value;
+                    ui16RefYaw = pSERIAL_VALUE->Value;
                     break;
                 case HEIGHT:
-                    ui16Height = SERIAL_VALUE.Value;
+                    ui16Height = pSERIAL_VALUE->Value;
                     break;
                 case HEIGHTREF:
-                    ui16RefHeight = SERIAL_VALUE.Value;
+                    ui16RefHeight = pSERIAL_VALUE->Value;
                     break;
                 case STATE:
-                    ui16State = SERIAL_VALUE.Value;
+                    ui16State = pSERIAL_VALUE->Value;
                     break;
                 case DUTY:
-                    ui16Duty = SERIAL_VALUE.Value;
+                    ui16Duty = pSERIAL_VALUE->Value;
                     break;
             }
 
+            vRefQueueRelease(&g_sDebugRefQueue, pSERIAL_VALUE);
+        }
+
+        xNow = xTaskGetTickCount();
+        if (g_ui32DebugPeriod != 0 && (int32_t) (xNow - xNextPrint) >= 0)
+        {
+            xNextPrint = xNow + pdMS_TO_TICKS(g_ui32DebugPeriod);
 
             //
             // Guard UART from concurrent access.
@@ -157,25 +195,78 @@ DebugTask (void *pvParameters)
             {
                 UARTprintf("Current State: LANDING\n");
             }
+            else if (ui16State == HOMING)
+            {
+                UARTprintf("Current State: HOMING\n");
+            }
+            else if (ui16State == FAULT)
+            {
+                UARTprintf("Current State: FAULT\n");
+            }
             UARTprintf("Tail Duty: %d\n", ui16Duty);
             UARTprintf("\n");
 
             xSemaphoreGive(xUARTSemaphore); // Return the mutex for the UART.
         }
-
     }
 }
 
+//*****************************************************************************
+//
+// Sets the period between telemetry prints in ms. Zero stops printing.
+//
+//*****************************************************************************
+void
+DebugSetPeriod (uint32_t ui32PeriodMs)
+{
+    g_ui32DebugPeriod = ui32PeriodMs;
+}
+
+//*****************************************************************************
+//
+// Returns the period between telemetry prints in ms.
+//
+//*****************************************************************************
+uint32_t
+DebugGetPeriod (void)
+{
+    return g_ui32DebugPeriod;
+}
+
+//*****************************************************************************
+//
+// Copies the usage counters of the debug record pool.
+//
+//*****************************************************************************
+void
+DebugGetPoolStats (MEMPOOL_STATS *psStats)
+{
+    vMemPoolGetStats(&g_sDebugPool, psStats);
+}
+
+//*****************************************************************************
+//
+// Queues a value to be printed. If every record is waiting to be printed the
+// value is dropped and counted as a pool failure rather than blocking the
+// sender.
+//
+//*****************************************************************************
 void
 SendToDebugger (uint16_t Value, DebugSource Source)
 {
-    DEBUG_VALUES DebugStruct;
+    DEBUG_VALUES *pDebugStruct;
+
+    pDebugStruct = pvRefQueueAlloc(&g_sDebugRefQueue);
+    if (pDebugStruct == NULL)
+    {
+        return;
+    }
 
-    DebugStruct.Source = Source;
-    DebugStruct.Value = Value;
+    pDebugStruct->Source = Source;
+    pDebugStruct->Value = Value;
 
-    // Pass the value of the reference angle to the controller.
-    if(xQueueSend(g_pDebugQueue, &DebugStruct, portMAX_DELAY) !=
+    // Pass a pointer to the record to the debug task.
+    if(xRefQueueSend(&g_sDebugRefQueue, pDebugStruct, portMAX_DELAY) !=
             pdPASS)
     {
         UARTprintf("\nQueue full. This should never happen.\n");
@@ -205,7 +296,7 @@ InitDebugTask (void)
     //
     // Create a mutex to guard the UART.
     //
-    xUARTSemaphore = xSemaphoreCreateMutex();
+    xUARTSemaphore = xMemMapSemaphoreCreateMutex(MEMMAP_SEMAPHORE_UART);
     if( xUARTSemaphore != NULL )
     {
         // The semaphore was created successfully.
@@ -215,10 +306,12 @@ InitDebugTask (void)
     //
     // Create a series of queues for sending messages to the display task.
     //
-    g_pDebugQueue = xQueueCreate(DEBUG_QUEUE_SIZE, DEBUG_ITEM_SIZE);
+    vMemPoolInit(&g_sDebugPool, g_psDebugBlocks, sizeof(DEBUG_VALUES), DEBUG_POOL_BLOCKS);
+    g_pDebugQueue = xMemMapQueueCreate(MEMMAP_QUEUE_DEBUG);
+    vRefQueueInit(&g_sDebugRefQueue, g_pDebugQueue, &g_sDebugPool);
 
-    if(xTaskCreate(DebugTask, (const portCHAR *)"Debug",
-                       DEBUGTASKSTACKSIZE, NULL,  tskIDLE_PRIORITY + DEBUGTASKPRIORITY, NULL) != pdTRUE)
+    if(xMemMapTaskCreate(MEMMAP_TASK_DEBUG, DebugTask, NULL,
+                       tskIDLE_PRIORITY + DEBUGTASKPRIORITY, NULL) != pdTRUE)
     {
         return(1);
     }
@@ -21,6 +21,8 @@
 #ifndef DEBUG_H_
 #define DEBUG_H_
 
+#include "mempool.h"
+
 
 //*****************************************************************************
 //
@@ -38,7 +40,8 @@ typedef enum {
 
 //*****************************************************************************
 //
-// Struct for sending data to print to the UART.
+// Struct for sending data to print to the UART. Records come from a pool
+// and are passed through the queue by pointer.
 //
 //*****************************************************************************
 typedef struct {
@@ -61,6 +64,9 @@ SemaphoreHandle_t xUARTSemaphore;
 //*****************************************************************************
 uint32_t InitDebugTask (void);
 void SendToDebugger (uint16_t, DebugSource);
+void DebugSetPeriod (uint32_t);
+void DebugGetPoolStats (MEMPOOL_STATS *);
+uint32_t DebugGetPeriod (void);
 
 //*****************************************************************************
 //
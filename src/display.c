@@ -14,6 +14,13 @@
  *
  * Description: This module is responsible for displaying the current yaw and
  * height to the OLED display. The reference yaw and height are also displayed.
+ * The display task sleeps until another module reports a value that has moved
+ * past its threshold, then redraws only the fields that have changed.
+ *
+ * Three views are available: the text view, an instrument view with a yaw
+ * dial and altitude bar drawn by instruments.c, and a strip chart of yaw error
+ * and tail duty drawn by stripchart.c. Each rendered frame is timed
+ * with the cycle counter and can be dumped to the UART as a PBM image.
  *
  *
  */
@@ -21,8 +28,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "utils/ustdlib.h"
+#include "utils/uartstdio.h"
 
 #include "OrbitOLED/OrbitOLEDInterface.h"
+#include "OrbitOLED/lib_OrbitOled/OrbitOled.h"
+#include "OrbitOLED/lib_OrbitOled/OrbitOledChar.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -30,19 +40,111 @@
 #include "semphr.h"
 
 #include "display.h"
+#include "instruments.h"
+#include "stripchart.h"
+#include "cycles.h"
 #include "button_task.h"
 #include "yaw.h"
 #include "height.h"
 #include "debugger.h"
+#include "memmap.h"
 #include "priorities.h"
 
 //*****************************************************************************
 //
-// The stack, priority and delay of the display task.
+// The frame rate and layout of the display task.
+//
+//*****************************************************************************
+#define DISPLAY_FRAME_RATE_HZ       10          // Default maximum redraw rate
+#define DISPLAY_MAX_PERIOD          1000        // Check for changes at least every 1s
+#define DISPLAY_DEFAULT_VIEW        DISPLAY_VIEW_TEXT
+#define DISPLAY_HIDDEN              0xFF        // Field column for views that omit it
+
+//*****************************************************************************
+//
+// Set to 1 to dump every rendered frame to the UART as a PBM image.
+//
+//*****************************************************************************
+#define DISPLAY_DUMP_FRAMES         0
+
+//*****************************************************************************
+//
+// Change thresholds for each field. A notification is only sent to the display
+// task once a value has moved this far from the value last notified.
+//
+//*****************************************************************************
+#define DISPLAY_YAW_THRESHOLD       2           // Degrees
+#define DISPLAY_REF_THRESHOLD       1
+#define DISPLAY_HEIGHT_THRESHOLD    1           // Percent
+
+//*****************************************************************************
+//
+// Struct holding the last rendered state of a numeric display field.
+//
+//*****************************************************************************
+typedef struct {
+    int32_t     i32Rendered;        // Value currently on the display
+    int32_t     i32Notified;        // Value last reported to the display task
+    int32_t     i32Threshold;
+    bool        bValid;             // False until the field has been drawn once
+    char        pcString[4];        // "%3d" of the rendered value
+} DISPLAY_FIELD;
+
+//*****************************************************************************
+//
+// Struct holding the static text and field positions of a view.
 //
 //*****************************************************************************
-#define DISPLAYTASKSTACKSIZE        128         // Stack size in words
-#define DISPLAY_DELAY               100          // 100ms delay
+typedef struct {
+    const char  *pcLabels[4];                   // One label per character row
+    uint8_t     ui8LabelColumn;
+    uint8_t     pui8Column[NUM_DISPLAY_FIELDS];
+    uint8_t     pui8Row[NUM_DISPLAY_FIELDS];
+} DISPLAY_LAYOUT;
+
+//*****************************************************************************
+//
+// The OrbitOLED frame buffer, defined in OrbitOled.c.
+//
+//*****************************************************************************
+extern char rgbOledBmp[];
+
+//*****************************************************************************
+//
+// Global variables for the display task.
+//
+//*****************************************************************************
+static TaskHandle_t g_xDisplayTask = NULL;
+
+static DISPLAY_FIELD g_psFields[NUM_DISPLAY_FIELDS] = {
+    [DISPLAY_YAW]        = { 0, 0, DISPLAY_YAW_THRESHOLD,    false, "" },
+    [DISPLAY_YAW_REF]    = { 0, 0, DISPLAY_REF_THRESHOLD,    false, "" },
+    [DISPLAY_HEIGHT]     = { 0, 0, DISPLAY_HEIGHT_THRESHOLD, false, "" },
+    [DISPLAY_HEIGHT_REF] = { 0, 0, DISPLAY_REF_THRESHOLD,    false, "" },
+};
+
+static const DISPLAY_LAYOUT g_psLayouts[NUM_DISPLAY_VIEWS] = {
+    [DISPLAY_VIEW_TEXT] = {
+        { "Heli Monitor", "", "YAW:    YAWR:", "ALT:    ALTR:" }, 0,
+        { 4, 13, 4, 13 },
+        { 2, 2, 3, 3 }
+    },
+    [DISPLAY_VIEW_INSTRUMENTS] = {
+        { "YAW", "REF", "ALT", "REF" }, 7,
+        { 11, 11, 11, 11 },
+        { 0, 1, 2, 3 }
+    },
+    [DISPLAY_VIEW_CHART] = {
+        { "", "", "", "" }, 0,
+        { DISPLAY_HIDDEN, DISPLAY_HIDDEN, DISPLAY_HIDDEN, DISPLAY_HIDDEN },
+        { 0, 0, 0, 0 }
+    },
+};
+
+static volatile DisplayView g_eRequestedView = DISPLAY_DEFAULT_VIEW;
+static volatile uint32_t g_ui32FramePeriod = 1000 / DISPLAY_FRAME_RATE_HZ;
+static volatile uint32_t g_ui32RenderCycles = 0;
+static volatile uint32_t g_ui32RenderCyclesMax = 0;
 
 //*****************************************************************************
 //
@@ -50,6 +152,9 @@
 //
 //*****************************************************************************
 void initDisplay (void);
+static int32_t i32GetFieldValue (DisplayField field);
+static void vDisplayDrawView (DisplayView eView);
+static bool bDisplayRefresh (DisplayView eView);
 static void DisplayTask(void *pvParameters);
 
 //*****************************************************************************
@@ -61,47 +166,306 @@ void
 initDisplay (void)
 {
     OLEDInitialise ();
+
+    //
+    // Draw into the frame buffer only. The display task pushes the buffer to
+    // the OLED once per refresh rather than once per string.
+    //
+    OrbitOledSetCharUpdate (0);
 }
 
 //*****************************************************************************
 //
-// Displays the current yaw and height as well as the reference values.
+// Called by other modules when a displayed value changes. Wakes the display
+// task if the value has moved past the threshold for that field.
+//
+//*****************************************************************************
+void
+DisplayValueUpdated (DisplayField field, int32_t i32Value)
+{
+    DISPLAY_FIELD *psField = &g_psFields[field];
+    int32_t i32Diff = i32Value - psField->i32Notified;
+
+    if (i32Diff < 0)
+    {
+        i32Diff = -i32Diff;
+    }
+
+    if (i32Diff >= psField->i32Threshold && g_xDisplayTask != NULL)
+    {
+        psField->i32Notified = i32Value;
+        xTaskNotifyGive(g_xDisplayTask);
+    }
+}
+
+//*****************************************************************************
+//
+// Selects the view to show. The display task redraws on its next pass.
+//
+//*****************************************************************************
+void
+DisplaySetView (DisplayView eView)
+{
+    if (eView < NUM_DISPLAY_VIEWS)
+    {
+        g_eRequestedView = eView;
+        if (g_xDisplayTask != NULL)
+        {
+            xTaskNotifyGive(g_xDisplayTask);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Cycles to the next view. Called by the button task.
+//
+//*****************************************************************************
+void
+DisplayNextView (void)
+{
+    DisplaySetView((DisplayView) ((g_eRequestedView + 1) % NUM_DISPLAY_VIEWS));
+}
+
+//*****************************************************************************
+//
+// Records a yaw error and tail duty sample for the strip chart. Called by the
+// controller at each control update.
+//
+//*****************************************************************************
+void
+DisplayChartSample (int16_t i16Error, uint16_t ui16Duty)
+{
+    vStripChartAddSample(i16Error, ui16Duty);
+
+    if (g_eRequestedView == DISPLAY_VIEW_CHART && g_xDisplayTask != NULL)
+    {
+        xTaskNotifyGive(g_xDisplayTask);
+    }
+}
+
+//*****************************************************************************
+//
+// Sets the maximum redraw rate of the display task.
+//
+//*****************************************************************************
+void
+DisplaySetFrameRate (uint32_t ui32RateHz)
+{
+    if (ui32RateHz > 0 && ui32RateHz <= 1000)
+    {
+        g_ui32FramePeriod = 1000 / ui32RateHz;
+    }
+}
+
+//*****************************************************************************
+//
+// Returns the cycles spent rendering the last frame and the worst frame so
+// far, including the transfer to the OLED.
+//
+//*****************************************************************************
+void
+DisplayGetRenderCycles (uint32_t *pui32Last, uint32_t *pui32Max)
+{
+    *pui32Last = g_ui32RenderCycles;
+    *pui32Max = g_ui32RenderCyclesMax;
+}
+
+//*****************************************************************************
+//
+// Prints the frame buffer to the UART as a plain PBM image, one pixel per
+// character. Rows are split in two so no line is longer than 70 characters.
+//
+//*****************************************************************************
+void
+DisplayDumpFrame (void)
+{
+    char pcLine[ccolOledMax / 2 + 1];
+    uint32_t ui32Row, ui32Col, ui32Half;
+    char cByte;
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+
+    UARTprintf("P1\n# render cycles %u\n%u %u\n", g_ui32RenderCycles,
+               ccolOledMax, crowOledMax);
+
+    for (ui32Row = 0; ui32Row < crowOledMax; ui32Row++)
+    {
+        for (ui32Half = 0; ui32Half < 2; ui32Half++)
+        {
+            for (ui32Col = 0; ui32Col < ccolOledMax / 2; ui32Col++)
+            {
+                //
+                // Each frame buffer byte holds eight vertical pixels of a page.
+                //
+                cByte = rgbOledBmp[(ui32Row / 8) * ccolOledMax +
+                                   ui32Half * (ccolOledMax / 2) + ui32Col];
+                pcLine[ui32Col] = (cByte & (1 << (ui32Row & 0x07))) ? '1' : '0';
+            }
+            pcLine[ccolOledMax / 2] = '\0';
+            UARTprintf("%s\n", pcLine);
+        }
+    }
+
+    xSemaphoreGive(xUARTSemaphore);
+}
+
+//*****************************************************************************
+//
+// Reads the current value of a display field from its owning module.
+//
+//*****************************************************************************
+static int32_t
+i32GetFieldValue (DisplayField field)
+{
+    switch (field)
+    {
+        case DISPLAY_YAW:
+            return GetYawAngle();
+        case DISPLAY_YAW_REF:
+            return GetRefYaw();
+        case DISPLAY_HEIGHT:
+            return GetHeight();
+        case DISPLAY_HEIGHT_REF:
+            return GetRefHeight();
+        default:
+            return 0;
+    }
+}
+
+//*****************************************************************************
+//
+// Clears the frame buffer and draws the static parts of a view. All fields are
+// marked as needing a redraw.
 //
 //*****************************************************************************
 static void
-DisplayTask(void *pvParameters)
+vDisplayDrawView (DisplayView eView)
 {
-   char CurString[17];  // 16 characters across the display
-   char RefString[17];
+    const DISPLAY_LAYOUT *psLayout = &g_psLayouts[eView];
+    uint8_t i;
 
-   uint16_t ui16RefYaw;
-   uint16_t ui16RefHeight;
-   int16_t i16Yaw;
-   uint32_t ui32Height;
+    OrbitOledClearBuffer();
 
-   ui16RefYaw = 0;
+    for (i = 0; i < 4; i++)
+    {
+        OLEDStringDraw (psLayout->pcLabels[i], psLayout->ui8LabelColumn, i);
+    }
 
-   portTickType ui16DelayTime;
-   ui16DelayTime = xTaskGetTickCount();
+    if (eView == DISPLAY_VIEW_INSTRUMENTS)
+    {
+        vInstrumentsDrawBackground();
+    }
+    else if (eView == DISPLAY_VIEW_CHART)
+    {
+        vStripChartDrawBackground();
+    }
 
-   OLEDStringDraw ("Heli Monitor", 0, 0);
+    for (i = 0; i < NUM_DISPLAY_FIELDS; i++)
+    {
+        g_psFields[i].bValid = false;
+    }
+}
+
+//*****************************************************************************
+//
+// Formats and draws any field whose value differs from what is on the display,
+// and moves the instruments if they are shown. Returns true if the frame
+// buffer was modified.
+//
+//*****************************************************************************
+static bool
+bDisplayRefresh (DisplayView eView)
+{
+    const DISPLAY_LAYOUT *psLayout = &g_psLayouts[eView];
+    DISPLAY_FIELD *psField;
+    int32_t pi32Values[NUM_DISPLAY_FIELDS];
+    bool bChanged = false;
+    uint8_t i;
+
+    for (i = 0; i < NUM_DISPLAY_FIELDS; i++)
+    {
+        psField = &g_psFields[i];
+        pi32Values[i] = i32GetFieldValue((DisplayField) i);
+
+        if ((psField->bValid && pi32Values[i] == psField->i32Rendered) ||
+            psLayout->pui8Column[i] == DISPLAY_HIDDEN)
+        {
+            continue;
+        }
+
+        usnprintf (psField->pcString, sizeof(psField->pcString), "%3d", pi32Values[i]);
+        OLEDStringDraw (psField->pcString, psLayout->pui8Column[i], psLayout->pui8Row[i]);
+
+        psField->i32Rendered = pi32Values[i];
+        psField->bValid = true;
+        bChanged = true;
+    }
+
+    if (eView == DISPLAY_VIEW_INSTRUMENTS)
+    {
+        bChanged |= bInstrumentsUpdate(pi32Values[DISPLAY_YAW], pi32Values[DISPLAY_YAW_REF],
+                                       pi32Values[DISPLAY_HEIGHT], pi32Values[DISPLAY_HEIGHT_REF]);
+    }
+    else if (eView == DISPLAY_VIEW_CHART)
+    {
+        bChanged |= bStripChartUpdate();
+    }
+
+    return bChanged;
+}
+
+//*****************************************************************************
+//
+// Displays the current yaw and height as well as the reference values.
+//
+//*****************************************************************************
+static void
+DisplayTask(void *pvParameters)
+{
+   DisplayView eView = g_eRequestedView;
+   uint32_t ui32Start, ui32Cycles;
+
+   CyclesInit();
+   vDisplayDrawView (eView);
 
    while(1)
    {
-       ui16RefYaw = GetRefYaw();
-       ui16RefHeight = GetRefHeight();
-       ui32Height = GetHeight();
-       i16Yaw = GetYawAngle();
+       ui32Start = CyclesGet();
+
+       if (eView != g_eRequestedView)
+       {
+           eView = g_eRequestedView;
+           vDisplayDrawView (eView);
+       }
 
-       usnprintf (RefString, sizeof(RefString), "YAW:%3d YAWR:%3d", i16Yaw, ui16RefYaw); // Display the current and reference yaw.
-       OLEDStringDraw (RefString, 0, 2);
-       usnprintf (CurString, sizeof(CurString), "ALT:%3d ALTR:%3d", ui32Height, ui16RefHeight);  // Display the current and reference height.
-       OLEDStringDraw (CurString, 0, 3);
+       if (bDisplayRefresh(eView))
+       {
+           OrbitOledUpdate ();
+
+           ui32Cycles = CyclesGet() - ui32Start;
+           g_ui32RenderCycles = ui32Cycles;
+           if (ui32Cycles > g_ui32RenderCyclesMax)
+           {
+               g_ui32RenderCyclesMax = ui32Cycles;
+           }
+
+#if DISPLAY_DUMP_FRAMES
+           DisplayDumpFrame ();
+#endif
+       }
+
+       //
+       // Limit the redraw rate. Notifications received in the meantime are
+       // held and handled on the next pass.
+       //
+       vTaskDelay(g_ui32FramePeriod / portTICK_RATE_MS);
 
        //
-       // Update the display at 10Hz.
+       // Sleep until a value changes, falling back to a periodic check so
+       // sub-threshold drift is still shown eventually.
        //
-       vTaskDelayUntil(&ui16DelayTime, DISPLAY_DELAY / portTICK_RATE_MS);
+       ulTaskNotifyTake(pdTRUE, DISPLAY_MAX_PERIOD / portTICK_RATE_MS);
    }
 }
 
@@ -118,8 +482,8 @@ InitDisplayTask (void)
     //
     // Create the display task.
     //
-    if(xTaskCreate(DisplayTask, (const portCHAR *)"Display",
-                       DISPLAYTASKSTACKSIZE, NULL,  tskIDLE_PRIORITY + DISPLAYTASKPRIORITY, NULL) != pdTRUE)
+    if(xMemMapTaskCreate(MEMMAP_TASK_DISPLAY, DisplayTask, NULL,
+                       tskIDLE_PRIORITY + DISPLAYTASKPRIORITY, &g_xDisplayTask) != pdTRUE)
     {
         return(1);
     }
@@ -12,8 +12,9 @@
  *
  * Created on: 28.08.21
  *
- * Description: Header file for the display module. Contains a prototype
- * to initialise the display task.
+ * Description: Header file for the display module. Contains prototypes
+ * to initialise the display task, notify it of changed values, select the
+ * view and read the rendering statistics.
  *
  *
  */
@@ -23,9 +24,41 @@
 
 //*****************************************************************************
 //
-// Prototype for the Display task.
+// Enumeration definition of each numeric field on the display.
+//
+//*****************************************************************************
+typedef enum {
+    DISPLAY_YAW,
+    DISPLAY_YAW_REF,
+    DISPLAY_HEIGHT,
+    DISPLAY_HEIGHT_REF,
+    NUM_DISPLAY_FIELDS
+} DisplayField;
+
+//*****************************************************************************
+//
+// Enumeration definition of each display view.
+//
+//*****************************************************************************
+typedef enum {
+    DISPLAY_VIEW_TEXT,
+    DISPLAY_VIEW_INSTRUMENTS,
+    DISPLAY_VIEW_CHART,
+    NUM_DISPLAY_VIEWS
+} DisplayView;
+
+//*****************************************************************************
+//
+// Prototypes for the Display task.
 //
 //*****************************************************************************
 uint32_t InitDisplayTask (void);
+void DisplayValueUpdated (DisplayField, int32_t);
+void DisplaySetView (DisplayView);
+void DisplayNextView (void);
+void DisplayChartSample (int16_t, uint16_t);
+void DisplaySetFrameRate (uint32_t);
+void DisplayGetRenderCycles (uint32_t *, uint32_t *);
+void DisplayDumpFrame (void);
 
 #endif /* DISPLAY_H_ */
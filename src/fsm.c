@@ -11,7 +11,11 @@
  * Created on: 28.08.21
  *
  * Description: This module operates the finite state machine for the helicopter control system.
- * There are four states: IDLE, TAKEOFF, FLYING, LANDING.
+ * There are six states: IDLE, HOMING, TAKEOFF, FLYING, LANDING and FAULT. HOMING,
+ * TAKEOFF, FLYING and LANDING share the AIRBORNE superstate. The yaw reference
+ * is found once in HOMING, after which yaw is always held by the PI controller. The states run on the hsm engine, so rotor
+ * duty cycles are only sent when they change and every transition is logged. A sensor fault latched by
+ * health.c sends any state to FAULT, which lands the helicopter.
  *
  * NOTE: This module was adapted from "464 SOLID Principles" by Dr Ben Mitchell.
  *
@@ -32,54 +36,139 @@
 #include "rotor.h"
 #include "height.h"
 #include "debugger.h"
+#include "display.h"
+#include "health.h"
+#include "hsm.h"
 #include "fsm.h"
 
 //*****************************************************************************
 //
-// Global variables for the state machine.
+// Superstate of the states where the rotors are running. Not reported by
+// fsm_get_state().
 //
 //*****************************************************************************
-uint32_t currentHeight = 0;
-uint16_t tailDuty;
-uint16_t mainDuty;
+#define AIRBORNE                (FAULT + 1)
+#define NUM_FSM_STATES          (AIRBORNE + 1)
 
-typedef State (*state_fn)(void);
+//*****************************************************************************
+//
+// Fixed rotor duty cycles used outside of FLYING.
+//
+//*****************************************************************************
+#define HOMING_TAIL_DUTY        74
+#define TAKEOFF_MAIN_DUTY       70
+#define FLYING_MAIN_DUTY        90
+#define LANDING_TAIL_DUTY       50
+#define LANDING_MAIN_DUTY       30
+#define TAKEOFF_HEIGHT          50
+#define HOMING_TIMEOUT_MS       8000 // Longer than one turn at HOMING_TAIL_DUTY
+#define FAULT_DESCENT_MS        6000 // Time to land from full height at the landing duties
+
+//*****************************************************************************
+//
+// Global variables for the state machine.
+//
+//*****************************************************************************
+static HSM g_sFlight;
+static uint16_t tailDuty;
+static uint16_t mainDuty;
+static bool g_bOutputsSent = false;
+static TickType_t g_xFaultEntered;
+static bool g_bButPushed = false;       // A press taken for this update
 
 //*****************************************************************************
 //
-// IDLE State: both rotors not spinning; transition to TAKEOFF when button pushed
+// Sends the duty cycles to the rotor task, but only when they change.
 //
 //*****************************************************************************
-State StateIdle(void)
+static void SetOutputs(uint16_t tail, uint16_t main)
 {
-    tailDuty = 0;
-    mainDuty = 0;
-    vSetMotorOutputs(tailDuty, mainDuty); // Send the duty cycles through a queue to the rotor task.
-    if (GetButPushed() == 1)
+    if (!g_bOutputsSent || tail != tailDuty || main != mainDuty)
     {
-        return(TAKEOFF);
+        tailDuty = tail;
+        mainDuty = main;
+        g_bOutputsSent = true;
+        vSetMotorOutputs(ROTOR_PERMILLE(tailDuty), ROTOR_PERMILLE(mainDuty)); // Send the duty cycles through a queue to the rotor task.
     }
-    return(IDLE);
 }
 
 //*****************************************************************************
 //
-// TAKEOFF State: both rotors set at a fixed PWM so that the helicopter spins
-// to find reference yaw and moves upwards; transition to FLYING when
-// height is > 50.
+// Holds the yaw at the reference angle with the PI controller. Returns the
+// yaw error.
 //
 //*****************************************************************************
-State StateTakeoff(void)
+static int16_t HoldYaw(uint16_t main)
 {
-    // helicopter spins to find reference yaw and increases altitude to 50
-    tailDuty = 74;
-    mainDuty = 70;
-    vSetMotorOutputs(tailDuty, mainDuty); // Send the duty cycles through a queue to the rotor task.
-    if (GetHeight() > 50)
-    {
-        return (FLYING);
-    }
-    return(TAKEOFF);
+    int16_t i16Error = 0;
+
+    i16Error = i16GetError(i16ControlGetRefYaw(), GetYawAngle());
+
+    vControlSchedule(main); // Gains for the main duty about to be sent.
+    vControlUpdate(i16Error); //  Update the duty cycle using the pid controller.
+    SetOutputs(ui16ControlGet(), main);
+
+    return i16Error;
+}
+
+//*****************************************************************************
+//
+// IDLE State: both rotors not spinning; transition to HOMING when button
+// pushed, or straight to TAKEOFF if the yaw reference has already been found.
+//
+//*****************************************************************************
+static void IdleEntry(void)
+{
+    SetOutputs(0, 0);
+}
+
+static bool ButtonPushed(void)
+{
+    return g_bButPushed;
+}
+
+static bool ButtonPushedHomed(void)
+{
+    return (ButtonPushed() && bYawIsHomed());
+}
+
+//*****************************************************************************
+//
+// HOMING State: both rotors set at a fixed PWM so that the helicopter spins
+// until the reference interrupt fires; transition to TAKEOFF once homed, or
+// to FAULT if the reference is not found in time.
+//
+//*****************************************************************************
+static void HomingEntry(void)
+{
+    SetOutputs(HOMING_TAIL_DUTY, TAKEOFF_MAIN_DUTY);
+}
+
+static bool Homed(void)
+{
+    return bYawIsHomed();
+}
+
+//*****************************************************************************
+//
+// TAKEOFF State: main rotor at a fixed PWM while the PI controller holds the
+// reference yaw; transition to FLYING when height is > 50. The PI controller
+// and yaw trajectory start from the yaw found by HOMING.
+//
+//*****************************************************************************
+static void TakeoffEntry(void)
+{
+    vControlReset();
+}
+
+static void TakeoffDo(void)
+{
+    HoldYaw(TAKEOFF_MAIN_DUTY);
+}
+
+static bool AboveTakeoffHeight(void)
+{
+    return (GetHeight() > TAKEOFF_HEIGHT);
 }
 
 //*****************************************************************************
@@ -89,23 +178,17 @@ State StateTakeoff(void)
 // controller; transition to LANDING if reference height is set to zero.
 //
 //*****************************************************************************
-State StateFlying(void)
+static void FlyingDo(void)
 {
     int16_t i16Error = 0;
 
-    i16Error = i16GetError(GetRefYaw(), GetYawAngle());
-
-    vControlUpdate(i16Error); //  Update the duty cycle using the pid controller.
-    tailDuty = ui16ControlGet();
-    mainDuty = 90;
-    vSetMotorOutputs(tailDuty, mainDuty); // Send the duty cycles through a queue to the rotor task.
-
-    if (GetRefHeight() == 0)
-    {
-        return(LANDING);
-    }
+    i16Error = HoldYaw(FLYING_MAIN_DUTY);
+    DisplayChartSample(i16Error, tailDuty); // Record the response for the strip chart.
+}
 
-    return(FLYING);
+static bool RefHeightZero(void)
+{
+    return (GetRefHeight() == 0);
 }
 
 //*****************************************************************************
@@ -114,37 +197,138 @@ State StateFlying(void)
 // transitions to IDLE when height reaches zero.
 //
 //*****************************************************************************
-State StateLanding(void)
+static void LandingEntry(void)
+{
+    SetOutputs(LANDING_TAIL_DUTY, LANDING_MAIN_DUTY);
+}
+
+static bool Landed(void)
+{
+    return (GetHeight() == 0);
+}
+
+//*****************************************************************************
+//
+// FAULT State: homing failed or a sensor fault is latched. Descend with the
+// landing duty cycles and stop the rotors once down. If the height sensor is
+// faulty, the rotors are stopped after the time to land instead. Transition
+// to IDLE, clearing the faults, when the rotors are stopped and a button is
+// pushed. The press is consumed, so IDLE waits for a new one before it will
+// take off. A fault that is still present sends IDLE straight back to FAULT.
+//
+//*****************************************************************************
+static bool Down(void)
+{
+    if (!bHealthHeightValid())
+    {
+        return ((xTaskGetTickCount() - g_xFaultEntered) >= pdMS_TO_TICKS(FAULT_DESCENT_MS));
+    }
+    return Landed();
+}
+
+static void FaultEntry(void)
+{
+    g_xFaultEntered = xTaskGetTickCount();
+
+    if (mainDuty != 0) // Never start the rotors from IDLE
+    {
+        SetOutputs(LANDING_TAIL_DUTY, LANDING_MAIN_DUTY);
+    }
+}
+
+static void FaultDo(void)
+{
+    if (Down())
+    {
+        SetOutputs(0, 0);
+    }
+}
+
+static void FaultExit(void)
+{
+    vHealthClear();
+}
+
+static bool FaultCleared(void)
 {
-    tailDuty = 50;
-    mainDuty = 30;
-    vSetMotorOutputs(tailDuty, mainDuty); // Send the duty cycles through a queue to the rotor task.
-    if (GetHeight() == 0)
+    if (mainDuty == 0 && ButtonPushed())
     {
-        return(IDLE);
+        g_bButPushed = false; // The press only clears the fault; IDLE needs another to fly
+        return true;
     }
-    return(LANDING);
+    return false;
+}
+
+static bool SensorFault(void)
+{
+    return bHealthFault();
 }
 
 //*****************************************************************************
 //
-// State table containing a pointer to each possible state in the same order
-// as state enumeration.
+// Transition and state tables, in the same order as the state enumeration.
 //
 //*****************************************************************************
-state_fn state_table[] = {
-  &StateIdle,
-  &StateTakeoff,
-  &StateFlying,
-  &StateLanding
+static const HSM_TRANSITION IdleTransitions[] = {
+    { SensorFault,          FAULT },
+    { ButtonPushedHomed,    TAKEOFF },
+    { ButtonPushed,         HOMING },
+};
+
+static const HSM_TRANSITION TakeoffTransitions[] = {
+    { AboveTakeoffHeight,   FLYING },
+};
+
+static const HSM_TRANSITION FlyingTransitions[] = {
+    { RefHeightZero,        LANDING },
+};
+
+static const HSM_TRANSITION LandingTransitions[] = {
+    { Landed,               IDLE },
 };
 
+static const HSM_TRANSITION HomingTransitions[] = {
+    { Homed,                TAKEOFF },
+};
+
+static const HSM_TRANSITION FaultTransitions[] = {
+    { FaultCleared,         IDLE },
+};
+
+static const HSM_TRANSITION AirborneTransitions[] = {
+    { SensorFault,          FAULT },
+};
+
+static const HSM_STATE state_table[NUM_FSM_STATES] = {
+    //  name        parent      entry           exit    do          transitions         count   timeout
+    { "IDLE",       HSM_NONE,   IdleEntry,      NULL,   NULL,       IdleTransitions,    3,      0, HSM_NONE },
+    { "TAKEOFF",    AIRBORNE,   TakeoffEntry,   NULL,   TakeoffDo,  TakeoffTransitions, 1,      0, HSM_NONE },
+    { "FLYING",     AIRBORNE,   NULL,           NULL,   FlyingDo,   FlyingTransitions,  1,      0, HSM_NONE },
+    { "LANDING",    AIRBORNE,   LandingEntry,   NULL,   NULL,       LandingTransitions, 1,      0, HSM_NONE },
+    { "HOMING",     AIRBORNE,   HomingEntry,    NULL,   NULL,       HomingTransitions,  1,      HOMING_TIMEOUT_MS, FAULT },
+    { "FAULT",      HSM_NONE,   FaultEntry,     FaultExit, FaultDo, FaultTransitions,   1,      0, HSM_NONE },
+    { "AIRBORNE",   HSM_NONE,   NULL,           NULL,   NULL,       AirborneTransitions, 1,     0, HSM_NONE },
+};
+
+//*****************************************************************************
+//
+// Logs each transition to the debugger.
+//
+//*****************************************************************************
+static void TransitionHook(const HSM_LOG_ENTRY *entry)
+{
+    SendToDebugger (entry->ui8To, STATE); // Send the new state of the fsm to be logged.
+}
+
 //*****************************************************************************
 //
-// Initialisation of state as IDLE.
+// Starts the state machine in IDLE. The rotor task must already exist.
 //
 //*****************************************************************************
-State state = IDLE;
+void fsm_init(void)
+{
+    vHsmInit(&g_sFlight, state_table, NUM_FSM_STATES, IDLE, TransitionHook);
+}
 
 //*****************************************************************************
 //
@@ -153,6 +337,47 @@ State state = IDLE;
 //*****************************************************************************
 void fsm_update()
 {
-    state = state_table[state]();
-    SendToDebugger (state, STATE); // Send the current state of the fsm to be logged.
+    g_bButPushed = (GetButPushed() == 1); // Each press is seen by one update only
+    vHsmUpdate(&g_sFlight);
+}
+
+//*****************************************************************************
+//
+// Returns the current state.
+//
+//*****************************************************************************
+State fsm_get_state(void)
+{
+    return (State) ui8HsmGetState(&g_sFlight);
+}
+
+//*****************************************************************************
+//
+// Returns the name of a state.
+//
+//*****************************************************************************
+const char *fsm_state_name(uint8_t state)
+{
+    return (state < NUM_FSM_STATES) ? state_table[state].pcName : "?";
+}
+
+//*****************************************************************************
+//
+// Copies up to max of the most recent transitions, oldest first.
+//
+//*****************************************************************************
+uint32_t fsm_get_log(HSM_LOG_ENTRY *log, uint32_t max)
+{
+    return ui32HsmGetLog(&g_sFlight, log, max);
+}
+
+//*****************************************************************************
+//
+// Returns the duty cycles last sent to the rotors.
+//
+//*****************************************************************************
+void fsm_get_duties(uint16_t *tail, uint16_t *main)
+{
+    *tail = tailDuty;
+    *main = mainDuty;
 }
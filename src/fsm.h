@@ -20,6 +20,8 @@
 #ifndef FSM_H_
 #define FSM_H_
 
+#include "hsm.h"
+
 //*****************************************************************************
 //
 // Enumeration definition of each state.
@@ -29,7 +31,9 @@ typedef enum {
     IDLE,
     TAKEOFF,
     FLYING,
-    LANDING
+    LANDING,
+    HOMING,
+    FAULT
 } State;
 
 //*****************************************************************************
@@ -37,7 +41,18 @@ typedef enum {
 // Function called frequently by controller.c. Updates current state.
 //
 //*****************************************************************************
+void fsm_init(void);
 void fsm_update();
 
+//*****************************************************************************
+//
+// Functions to read the current state and rotor duty cycles.
+//
+//*****************************************************************************
+State fsm_get_state(void);
+const char *fsm_state_name(uint8_t);
+uint32_t fsm_get_log(HSM_LOG_ENTRY *, uint32_t);
+void fsm_get_duties(uint16_t *, uint16_t *);
+
 #endif /* FSM_H_ */
 
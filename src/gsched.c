@@ -0,0 +1,278 @@
+/*
+ * File: gsched.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module holds the gain schedule of the tail controller.
+ * The tail torque needed to hold yaw depends on the main rotor duty, so kp,
+ * ki and the duty offset are tabulated against main duty and height and
+ * bilinearly interpolated in Q8 fixed point. The table is loaded from the
+ * last flash block at start up, or from the defaults if the block is blank
+ * or corrupt, and is only written back on request.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "driverlib/flash.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "gsched.h"
+
+//*****************************************************************************
+//
+// The parameter block. It must match the PARAMS region of tm4c123gh6pm.cmd.
+//
+//*****************************************************************************
+#define GSCHED_FLASH_ADDR       0x0003FC00
+#define GSCHED_MAGIC            0x47534348  // "GSCH"
+#define GSCHED_VERSION          1
+#define GSCHED_Q                8
+
+//*****************************************************************************
+//
+// Struct for the parameter block as stored in flash.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Magic;
+    uint16_t ui16Version;
+    uint16_t ui16Size;
+    GSCHED_POINT psTable[GSCHED_DUTY_POINTS][GSCHED_HEIGHT_POINTS];
+    uint32_t ui32Checksum;
+} GSCHED_BLOCK;
+
+//*****************************************************************************
+//
+// Breakpoints of the table. Main duty covers the LANDING, TAKEOFF and FLYING
+// duties in fsm.c.
+//
+//*****************************************************************************
+static const uint8_t g_pui8DutyPoints[GSCHED_DUTY_POINTS] = { 30, 50, 70, 90 };
+static const uint8_t g_pui8HeightPoints[GSCHED_HEIGHT_POINTS] = { 0, 50, 100 };
+
+//*****************************************************************************
+//
+// Default schedule, flat at the original fixed gains.
+//
+//*****************************************************************************
+#define GSCHED_DEFAULT          { 5, 0, 74, 0 }
+
+static GSCHED_BLOCK g_sSchedule = {
+    GSCHED_MAGIC, GSCHED_VERSION, sizeof(GSCHED_BLOCK),
+    {
+        { GSCHED_DEFAULT, GSCHED_DEFAULT, GSCHED_DEFAULT },
+        { GSCHED_DEFAULT, GSCHED_DEFAULT, GSCHED_DEFAULT },
+        { GSCHED_DEFAULT, GSCHED_DEFAULT, GSCHED_DEFAULT },
+        { GSCHED_DEFAULT, GSCHED_DEFAULT, GSCHED_DEFAULT },
+    },
+    0
+};
+
+//*****************************************************************************
+//
+// Local prototypes for the gain schedule module.
+//
+//*****************************************************************************
+static uint32_t ui32Checksum (const GSCHED_BLOCK *psBlock);
+static uint8_t ui8Segment (const uint8_t *pui8Points, uint8_t ui8Count,
+                           uint16_t ui16Value, uint16_t *pui16Frac);
+static uint8_t ui8Lerp (uint8_t ui8A, uint8_t ui8B, uint16_t ui16Frac);
+
+//*****************************************************************************
+//
+// Rotating sum of every word of the block before the checksum.
+//
+//*****************************************************************************
+static uint32_t
+ui32Checksum (const GSCHED_BLOCK *psBlock)
+{
+    const uint32_t *pui32Word = (const uint32_t *) psBlock;
+    uint32_t ui32Count = offsetof(GSCHED_BLOCK, ui32Checksum) / sizeof(uint32_t);
+    uint32_t ui32Sum = 0;
+
+    while (ui32Count--)
+    {
+        ui32Sum = ((ui32Sum << 1) | (ui32Sum >> 31)) + *pui32Word++;
+    }
+    return ~ui32Sum;
+}
+
+//*****************************************************************************
+//
+// Finds the segment of a breakpoint axis containing a value, and the Q8
+// fraction of the way along it. Values outside the axis are clamped.
+//
+//*****************************************************************************
+static uint8_t
+ui8Segment (const uint8_t *pui8Points, uint8_t ui8Count, uint16_t ui16Value,
+            uint16_t *pui16Frac)
+{
+    uint8_t i;
+
+    if (ui16Value <= pui8Points[0])
+    {
+        *pui16Frac = 0;
+        return 0;
+    }
+
+    for (i = 0; i < ui8Count - 1; i++)
+    {
+        if (ui16Value < pui8Points[i + 1])
+        {
+            *pui16Frac = ((ui16Value - pui8Points[i]) << GSCHED_Q)
+                         / (pui8Points[i + 1] - pui8Points[i]);
+            return i;
+        }
+    }
+
+    *pui16Frac = 1 << GSCHED_Q;
+    return ui8Count - 2;
+}
+
+static uint8_t
+ui8Lerp (uint8_t ui8A, uint8_t ui8B, uint16_t ui16Frac)
+{
+    int32_t i32Value = ((int32_t) ui8A << GSCHED_Q) + ((int32_t) ui8B - ui8A) * ui16Frac;
+
+    return (uint8_t) ((i32Value + (1 << (GSCHED_Q - 1))) >> GSCHED_Q);
+}
+
+//*****************************************************************************
+//
+// Loads the schedule from flash. Returns false, keeping the defaults, if the
+// block is blank, from another version or corrupt.
+//
+//*****************************************************************************
+bool
+bGSchedInit (void)
+{
+    const GSCHED_BLOCK *psFlash = (const GSCHED_BLOCK *) GSCHED_FLASH_ADDR;
+
+    if (psFlash->ui32Magic != GSCHED_MAGIC
+        || psFlash->ui16Version != GSCHED_VERSION
+        || psFlash->ui16Size != sizeof(GSCHED_BLOCK)
+        || psFlash->ui32Checksum != ui32Checksum(psFlash))
+    {
+        return false;
+    }
+
+    memcpy(&g_sSchedule, psFlash, sizeof(GSCHED_BLOCK));
+    return true;
+}
+
+//*****************************************************************************
+//
+// Interpolates the schedule at a main rotor duty and height.
+//
+//*****************************************************************************
+void
+vGSchedLookup (uint16_t ui16Main, uint16_t ui16Height, GSCHED_POINT *psPoint)
+{
+    const GSCHED_POINT *ps00, *ps01, *ps10, *ps11;
+    uint16_t ui16DutyFrac, ui16HeightFrac;
+    uint8_t d, h;
+
+    d = ui8Segment(g_pui8DutyPoints, GSCHED_DUTY_POINTS, ui16Main, &ui16DutyFrac);
+    h = ui8Segment(g_pui8HeightPoints, GSCHED_HEIGHT_POINTS, ui16Height, &ui16HeightFrac);
+
+    ps00 = &g_sSchedule.psTable[d][h];
+    ps01 = &g_sSchedule.psTable[d][h + 1];
+    ps10 = &g_sSchedule.psTable[d + 1][h];
+    ps11 = &g_sSchedule.psTable[d + 1][h + 1];
+
+    psPoint->ui8Kp = ui8Lerp(ui8Lerp(ps00->ui8Kp, ps10->ui8Kp, ui16DutyFrac),
+                             ui8Lerp(ps01->ui8Kp, ps11->ui8Kp, ui16DutyFrac), ui16HeightFrac);
+    psPoint->ui8Ki = ui8Lerp(ui8Lerp(ps00->ui8Ki, ps10->ui8Ki, ui16DutyFrac),
+                             ui8Lerp(ps01->ui8Ki, ps11->ui8Ki, ui16DutyFrac), ui16HeightFrac);
+    psPoint->ui8Offset = ui8Lerp(ui8Lerp(ps00->ui8Offset, ps10->ui8Offset, ui16DutyFrac),
+                                 ui8Lerp(ps01->ui8Offset, ps11->ui8Offset, ui16DutyFrac), ui16HeightFrac);
+    psPoint->ui8Reserved = 0;
+}
+
+//*****************************************************************************
+//
+// Return the main duty and height of a breakpoint.
+//
+//*****************************************************************************
+uint8_t
+ui8GSchedDutyPoint (uint8_t ui8Index)
+{
+    return g_pui8DutyPoints[ui8Index];
+}
+
+uint8_t
+ui8GSchedHeightPoint (uint8_t ui8Index)
+{
+    return g_pui8HeightPoints[ui8Index];
+}
+
+//*****************************************************************************
+//
+// Read and write one point of the table by breakpoint index. Changes are
+// used straight away but are lost at reset unless saved.
+//
+//*****************************************************************************
+void
+vGSchedGet (uint8_t ui8Duty, uint8_t ui8Height, GSCHED_POINT *psPoint)
+{
+    *psPoint = g_sSchedule.psTable[ui8Duty][ui8Height];
+}
+
+void
+vGSchedSet (uint8_t ui8Duty, uint8_t ui8Height, const GSCHED_POINT *psPoint)
+{
+    taskENTER_CRITICAL();
+    g_sSchedule.psTable[ui8Duty][ui8Height] = *psPoint;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Erases the parameter block and programs the current table into it. The
+// CPU stalls while the flash is busy, so only call this with the rotors off.
+// Returns 0 on success, 1 on failure.
+//
+//*****************************************************************************
+uint32_t
+ui32GSchedSave (void)
+{
+    g_sSchedule.ui32Magic = GSCHED_MAGIC;
+    g_sSchedule.ui16Version = GSCHED_VERSION;
+    g_sSchedule.ui16Size = sizeof(GSCHED_BLOCK);
+    g_sSchedule.ui32Checksum = ui32Checksum(&g_sSchedule);
+
+    if (FlashErase(GSCHED_FLASH_ADDR) != 0)
+    {
+        return(1);
+    }
+
+    if (FlashProgram((uint32_t *) &g_sSchedule, GSCHED_FLASH_ADDR, sizeof(GSCHED_BLOCK)) != 0)
+    {
+        return(1);
+    }
+
+    //
+    // Read back to catch a worn or locked block.
+    //
+    if (memcmp((const void *) GSCHED_FLASH_ADDR, &g_sSchedule, sizeof(GSCHED_BLOCK)) != 0)
+    {
+        return(1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,59 @@
+/*
+ * File: gsched.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the gain schedule module. The tail PI gains
+ * and duty offset are kept in a table over main rotor duty and height, which
+ * is interpolated each control tick and saved in flash.
+ *
+ *
+ */
+
+#ifndef GSCHED_H_
+#define GSCHED_H_
+
+//*****************************************************************************
+//
+// Number of breakpoints on each axis of the table.
+//
+//*****************************************************************************
+#define GSCHED_DUTY_POINTS      4
+#define GSCHED_HEIGHT_POINTS    3
+
+//*****************************************************************************
+//
+// Struct for one point of the schedule. Four bytes so the table can be
+// programmed into flash a word at a time.
+//
+//*****************************************************************************
+typedef struct {
+    uint8_t ui8Kp;
+    uint8_t ui8Ki;
+    uint8_t ui8Offset;          // Tail duty with zero error
+    uint8_t ui8Reserved;
+} GSCHED_POINT;
+
+//*****************************************************************************
+//
+// Prototypes for the gain schedule module.
+//
+//*****************************************************************************
+bool bGSchedInit (void);
+void vGSchedLookup (uint16_t ui16Main, uint16_t ui16Height, GSCHED_POINT *psPoint);
+uint8_t ui8GSchedDutyPoint (uint8_t ui8Index);
+uint8_t ui8GSchedHeightPoint (uint8_t ui8Index);
+void vGSchedGet (uint8_t ui8Duty, uint8_t ui8Height, GSCHED_POINT *psPoint);
+void vGSchedSet (uint8_t ui8Duty, uint8_t ui8Height, const GSCHED_POINT *psPoint);
+uint32_t ui32GSchedSave (void);
+
+#endif /* GSCHED_H_ */
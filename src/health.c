@@ -0,0 +1,304 @@
+/*
+ * File: health.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module monitors the height and yaw sensors. It is called
+ * by the controller task once per control cycle, before the state machine,
+ * and makes a few cheap checks on the latest batch of height samples and the
+ * encoder edge count: range, rate of change, stuck samples, staleness, and
+ * encoder edges while the helicopter should be turning. A check must fail on consecutive cycles
+ * before its fault is latched. Latched faults stay set until cleared, and
+ * the state machine enters FAULT and lands while any are set. Faults can be
+ * injected from the console to exercise the path on the bench.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "health.h"
+#include "height.h"
+#include "yaw.h"
+#include "fsm.h"
+#include "controller.h"
+
+//*****************************************************************************
+//
+// Limits of the checks. Raw ADC counts are 12 bit. A batch covers one
+// control period.
+//
+//*****************************************************************************
+#define HEALTH_ADC_MIN          8       // At or below is the ground rail
+#define HEALTH_ADC_MAX          4087    // At or above is the supply rail
+#define HEALTH_ADC_STEP         600     // Largest change between batches
+#define HEALTH_SPIN_MARGIN      15      // Tail duty from the zero error duty that must turn it
+#define HEALTH_SPIN_ERROR       20      // Yaw error, degrees, the tail duty is chasing
+#define HEALTH_EDGE_TIMEOUT_MS  2000    // Time it should turn without an edge
+
+//*****************************************************************************
+//
+// Consecutive failed cycles before each check latches, in check order.
+//
+//*****************************************************************************
+static const uint8_t g_pui8Persist[NUM_HEALTH_CHECKS] = {
+    4,      // Range, 100ms
+    2,      // Rate
+    40,     // Stuck, 1s
+    4,      // Stale, 4 missed batches
+    1,      // Encoder, already timed
+};
+
+static const char * const g_ppcNames[NUM_HEALTH_CHECKS] = {
+    "range", "rate", "stuck", "stale", "encoder"
+};
+
+//*****************************************************************************
+//
+// Global variables for the health module.
+//
+//*****************************************************************************
+static HEALTH_STATUS g_sHealth;
+static uint8_t g_pui8Failed[NUM_HEALTH_CHECKS];   // Consecutive failed cycles
+static uint32_t g_ui32PrevMean;
+static bool g_bPrevValid = false;
+static HEALTH_SPIN g_sSpin;
+static TickType_t g_xPrevUpdate;
+
+//*****************************************************************************
+//
+// Counts a failed check, or resets it on a pass. Injected faults fail the
+// check regardless of the measurement. Latches the fault once the check has
+// failed for long enough.
+//
+//*****************************************************************************
+static void
+vHealthCheck(HealthCheck eCheck, bool bFailed)
+{
+    uint32_t ui32Fault = HEALTH_FAULT(eCheck);
+
+    if (!bFailed && !(g_sHealth.ui32Injected & ui32Fault))
+    {
+        g_pui8Failed[eCheck] = 0;
+        return;
+    }
+
+    if (g_pui8Failed[eCheck] < g_pui8Persist[eCheck])
+    {
+        g_pui8Failed[eCheck]++;
+    }
+
+    if (g_pui8Failed[eCheck] >= g_pui8Persist[eCheck] && !(g_sHealth.ui32Faults & ui32Fault))
+    {
+        if (g_sHealth.ui32Faults == 0)
+        {
+            g_sHealth.xFaultTick = xTaskGetTickCount();
+        }
+        g_sHealth.ui32Faults |= ui32Fault;
+        g_sHealth.pui32Trips[eCheck]++;
+    }
+}
+
+//*****************************************************************************
+//
+// Returns true if the helicopter should be turning. In HOMING it is spun on
+// purpose. While the PI controller holds the yaw, the tail duty sits at its
+// zero error offset and the helicopter may rightly not move at all, so it
+// only must turn while the duty is well away from the offset chasing a large
+// yaw error. Elsewhere the yaw is not controlled.
+//
+//*****************************************************************************
+bool
+bHealthShouldTurn(uint8_t ui8State, uint16_t ui16Tail, uint16_t ui16Offset, int16_t i16Error)
+{
+    switch (ui8State)
+    {
+    case HOMING:
+        return true;
+
+    case TAKEOFF:
+    case FLYING:
+        return ((ui16Tail >= ui16Offset + HEALTH_SPIN_MARGIN || ui16Tail + HEALTH_SPIN_MARGIN <= ui16Offset)
+                && (i16Error >= HEALTH_SPIN_ERROR || i16Error <= -HEALTH_SPIN_ERROR));
+
+    default:
+        return false;
+    }
+}
+
+//*****************************************************************************
+//
+// Updates the encoder check with the edge count after ui32Ms more. Returns
+// true once the helicopter should have turned for HEALTH_EDGE_TIMEOUT_MS
+// without an edge.
+//
+//*****************************************************************************
+bool
+bHealthSpinUpdate(HEALTH_SPIN *psSpin, uint32_t ui32Edges, bool bShouldTurn, uint32_t ui32Ms)
+{
+    if (ui32Edges != psSpin->ui32PrevEdges || !bShouldTurn)
+    {
+        psSpin->ui32StillMs = 0;
+    }
+    else if (psSpin->ui32StillMs < HEALTH_EDGE_TIMEOUT_MS)
+    {
+        psSpin->ui32StillMs += ui32Ms;
+    }
+    psSpin->ui32PrevEdges = ui32Edges;
+
+    return (psSpin->ui32StillMs >= HEALTH_EDGE_TIMEOUT_MS);
+}
+
+//*****************************************************************************
+//
+// Runs the checks for one control cycle. bFresh is false if the cycle ran
+// without a new batch of height samples.
+//
+//*****************************************************************************
+void
+vHealthUpdate(bool bFresh)
+{
+    uint32_t ui32Mean, ui32Min, ui32Max;
+    uint16_t ui16Tail, ui16Main;
+    uint8_t ui8Offset;
+    int16_t i16Error;
+    TickType_t xNow = xTaskGetTickCount();
+    bool bStep, bTurn;
+
+    //
+    // Inputs to the encoder check, from the last control cycle.
+    //
+    fsm_get_duties(&ui16Tail, &ui16Main);
+    ui8Offset = ui8ControlDutyOffset();
+    i16Error = i16GetError(i16ControlGetRefYaw(), GetYawAngle());
+    bTurn = bHealthShouldTurn(fsm_get_state(), ui16Tail, ui8Offset, i16Error) && ui16Main != 0;
+
+    taskENTER_CRITICAL();
+
+    vHealthCheck(HEALTH_STALE, !bFresh);
+
+    //
+    // Height checks, on the newest batch only.
+    //
+    if (bFresh)
+    {
+        vHeightGetBatch(&ui32Mean, &ui32Min, &ui32Max);
+
+        vHealthCheck(HEALTH_RANGE, ui32Mean <= HEALTH_ADC_MIN || ui32Mean >= HEALTH_ADC_MAX);
+
+        bStep = g_bPrevValid && (ui32Mean > g_ui32PrevMean + HEALTH_ADC_STEP ||
+                                 g_ui32PrevMean > ui32Mean + HEALTH_ADC_STEP);
+        vHealthCheck(HEALTH_RATE, bStep);
+
+        vHealthCheck(HEALTH_STUCK, ui32Min == ui32Max);
+
+        g_ui32PrevMean = ui32Mean;
+        g_bPrevValid = true;
+    }
+
+    //
+    // The encoder must move while the helicopter should be turning.
+    //
+    vHealthCheck(HEALTH_ENCODER, bHealthSpinUpdate(&g_sSpin, ui32YawEdges(), bTurn,
+                                                   (xNow - g_xPrevUpdate) * portTICK_PERIOD_MS));
+    g_xPrevUpdate = xNow;
+
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Returns true while any fault is latched.
+//
+//*****************************************************************************
+bool
+bHealthFault(void)
+{
+    return (g_sHealth.ui32Faults != 0);
+}
+
+//*****************************************************************************
+//
+// Returns false if a height fault is latched, so the height cannot be used
+// to tell when the helicopter has landed.
+//
+//*****************************************************************************
+bool
+bHealthHeightValid(void)
+{
+    return ((g_sHealth.ui32Faults & HEALTH_HEIGHT_FAULTS) == 0);
+}
+
+//*****************************************************************************
+//
+// Clears the latched and injected faults. A fault that is still present
+// latches again once its check fails for long enough.
+//
+//*****************************************************************************
+void
+vHealthClear(void)
+{
+    uint32_t i;
+
+    taskENTER_CRITICAL();
+    g_sHealth.ui32Faults = 0;
+    g_sHealth.ui32Injected = 0;
+    for (i = 0; i < NUM_HEALTH_CHECKS; i++)
+    {
+        g_pui8Failed[i] = 0;
+    }
+    g_bPrevValid = false;
+    g_sSpin.ui32StillMs = 0;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Makes the checks in the mask fail from the next update until cleared. The
+// fault still has to persist before it latches, as a real one would.
+//
+//*****************************************************************************
+void
+vHealthInject(uint32_t ui32Faults)
+{
+    taskENTER_CRITICAL();
+    g_sHealth.ui32Injected |= ui32Faults;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Copies the health status.
+//
+//*****************************************************************************
+void
+vHealthGetStatus(HEALTH_STATUS *psStatus)
+{
+    taskENTER_CRITICAL();
+    *psStatus = g_sHealth;
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Returns the name of a check.
+//
+//*****************************************************************************
+const char *
+pcHealthName(HealthCheck eCheck)
+{
+    return (eCheck < NUM_HEALTH_CHECKS) ? g_ppcNames[eCheck] : "?";
+}
@@ -0,0 +1,80 @@
+/*
+ * File: health.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the health module. The sensors are checked
+ * once per control cycle and any fault is latched until cleared, so the state
+ * machine can bring the helicopter down.
+ *
+ *
+ */
+
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+//*****************************************************************************
+//
+// The checks. Each one latches the matching bit of the fault mask.
+//
+//*****************************************************************************
+typedef enum {
+    HEALTH_RANGE,           // Height sample at a rail
+    HEALTH_RATE,            // Height changed faster than the helicopter can move
+    HEALTH_STUCK,           // Every sample in a batch identical
+    HEALTH_STALE,           // No height samples
+    HEALTH_ENCODER,         // No encoder edges while the helicopter should turn
+    NUM_HEALTH_CHECKS
+} HealthCheck;
+
+#define HEALTH_FAULT(check)     (1 << (check))
+#define HEALTH_HEIGHT_FAULTS    (HEALTH_FAULT(HEALTH_RANGE) | HEALTH_FAULT(HEALTH_RATE) | \
+                                 HEALTH_FAULT(HEALTH_STUCK) | HEALTH_FAULT(HEALTH_STALE))
+
+//*****************************************************************************
+//
+// Struct for the health status.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Faults;        // Latched faults
+    uint32_t ui32Injected;      // Faults injected for the next checks
+    TickType_t xFaultTick;      // Tick of the first latched fault
+    uint32_t pui32Trips[NUM_HEALTH_CHECKS];  // Times each check has latched
+} HEALTH_STATUS;
+
+//*****************************************************************************
+//
+// State of the encoder check.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32PrevEdges;
+    uint32_t ui32StillMs;       // Time it should have turned without an edge
+} HEALTH_SPIN;
+
+//*****************************************************************************
+//
+// Prototypes for the health module.
+//
+//*****************************************************************************
+void vHealthUpdate(bool);
+bool bHealthFault(void);
+bool bHealthHeightValid(void);
+void vHealthClear(void);
+void vHealthInject(uint32_t);
+void vHealthGetStatus(HEALTH_STATUS *);
+const char *pcHealthName(HealthCheck);
+bool bHealthShouldTurn(uint8_t, uint16_t, uint16_t, int16_t);
+bool bHealthSpinUpdate(HEALTH_SPIN *, uint32_t, bool, uint32_t);
+
+#endif /* HEALTH_H_ */
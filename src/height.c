@@ -13,9 +13,12 @@
  * Created on: 28.08.21
  *
  * Description: This module samples the ADC peripheral to get the height of the
- * helicopter. An interrupt is triggered at 10Hz, giving a semaphore to the ADC
- * handling task. A counting semaphore has been used to ensure no samples are
- * missed.
+ * helicopter. It is the start of the control pipeline: hardware timer TIMER0A
+ * triggers conversions at 2kHz and the conversion interrupt pushes each raw
+ * sample into a stream buffer. The controller task receives a control
+ * period's batch at a time, waking once per batch, and the batch is averaged
+ * into a single height. A software timer reports the height to the debugger
+ * and display at 10Hz.
  *
  * Note: ADCIntHandler is adapted from "Master the FreeRTOS Real Time Kernel" by Richard Barry.
  *
@@ -25,19 +28,28 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/adc.h"
+#include "driverlib/timer.h"
 #include "utils/ustdlib.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "timers.h"
+#include "stream_buffer.h"
 
 #include "height.h"
+#include "controller.h"
+#include "cycles.h"
+#include "calib.h"
+#include "memmap.h"
 #include "priorities.h"
 #include "debugger.h"
+#include "display.h"
 
 //*****************************************************************************
 //
@@ -45,195 +57,322 @@
 //
 //*****************************************************************************
 uint32_t g_ui32Height;
+static volatile uint32_t g_ui32SenseCycles = 0;  // Trigger to sample stored
+static volatile uint32_t g_ui32BatchCycles = 0;  // Cycle count at the trigger ending the batch
+static volatile uint32_t g_ui32BatchFill = 0;    // Samples stored towards the next batch
+static volatile uint32_t g_ui32Dropped = 0;      // Samples lost with the stream buffer full
 
 //*****************************************************************************
 //
-// The stack of the height task.
+// The trigger timer and the period of the height reports in ms.
 //
 //*****************************************************************************
-#define PERIODICTASKSTACKSIZE    128
-#define ADCTASKSTACKSIZE         128
+#define ADC_TIMER_BASE          TIMER0_BASE
+#define ADC_TIMER_PERIPH        SYSCTL_PERIPH_TIMER0
+#define HEIGHT_REPORT_DELAY     100
 
 //*****************************************************************************
 //
-// The delay of the ADC Interrupt Trigger.
+// Sample rate and batch size. One batch covers a control period. The stream
+// buffer must hold at least two batches so the ISR can keep filling while
+// the controller runs.
 //
 //*****************************************************************************
-#define ADC_DELAY               100
+#define HEIGHT_SAMPLE_HZ        2000
+#define HEIGHT_BATCH_SAMPLES    (HEIGHT_SAMPLE_HZ * CONTROLLER_PERIOD_MS / 1000)
+#define HEIGHT_BATCH_BYTES      (HEIGHT_BATCH_SAMPLES * sizeof(uint16_t))
 
 //*****************************************************************************
 //
-// The upper and lower limits for conversion of the height reading to percentage.
+// Software timer for the height reports.
 //
 //*****************************************************************************
-#define HEIGHT_LIMIT_UPPER               2210
-#define HEIGHT_LIMIT_LOWER               160
-#define HEIGHT_CONVERSION_MULTIPLIER     0.05
+static TimerHandle_t xReportTimer;
 
 //*****************************************************************************
 //
-//Counting semaphore to process ADC readings.
+// Raw samples from the ADC interrupt, and the batch being received.
 //
 //*****************************************************************************
-static SemaphoreHandle_t xCountingSemaphore;
+static StreamBufferHandle_t g_xSampleStream;
+static uint16_t g_pui16Batch[HEIGHT_BATCH_SAMPLES];
+static size_t g_xBatchBytes = 0;
+static uint32_t g_ui32BatchMin;
+static uint32_t g_ui32BatchMax;
 
 //*****************************************************************************
 //
 // Local prototypes for the height module.
 //
 //*****************************************************************************
-static void vPeriodicADCTask (void *pvParameters);
-static void vADCHandlingTask (void *pvParameters);
+static void vHeightReportService (TimerHandle_t xTimer);
 void ADCIntHandler( void );
 void vInitADC(void);
 
 //*****************************************************************************
 //
-// Converts height voltage reading to a percentage.
-// NOTE: Currently altered to read height from Orbit BoosterPack potentiometer
+// Converts height voltage reading to a percentage, using the limits and
+// scale from the calibration.
 //
 //*****************************************************************************
-static void
-vGetPercentage(void)
+static uint32_t
+ui32GetPercentage(uint32_t ui32Raw)
 {
+    const CALIB_FACTORS *psCalib = psCalibFactors();
+    uint32_t ui32Percent;
 
-    if (g_ui32Height >= HEIGHT_LIMIT_UPPER) {         // Check for upper limit
-        g_ui32Height = 100;
-    } else if (g_ui32Height < HEIGHT_LIMIT_LOWER) {    // Check for lower limit
-        g_ui32Height = 0;
+    if (ui32Raw >= psCalib->ui16HeightUpper) {         // Check for upper limit
+        ui32Percent = 100;
+    } else if (ui32Raw < psCalib->ui16HeightLower) {    // Check for lower limit
+        ui32Percent = 0;
     } else {
-        g_ui32Height = (g_ui32Height-HEIGHT_LIMIT_LOWER)*HEIGHT_CONVERSION_MULTIPLIER;
+        ui32Percent = ((ui32Raw - psCalib->ui16HeightLower) * psCalib->ui32HeightScale) >> CALIB_Q;
     }
+
+    return ui32Percent;
 }
 
 //*****************************************************************************
 //
-// Getter function to get updated height percentage.
+// Getter function to get updated height percentage. The raw sample is left
+// untouched so repeated calls from different tasks agree.
 //
 //*****************************************************************************
 uint32_t
 GetHeight(void)
 {
-    vGetPercentage();
-    return g_ui32Height;
+    return ui32GetPercentage(g_ui32Height);
 }
 
 //*****************************************************************************
 //
-// A periodic task to trigger the ADC interrupt at 10Hz.
+// Returns the CPU cycles since the trigger of the last sample in the most
+// recent batch, i.e. since the start of the current control cycle.
 //
 //*****************************************************************************
-static void
-vPeriodicADCTask (void *pvParameters)
+uint32_t
+ui32HeightCyclesSinceTrigger(void)
 {
-    portTickType ui16DelayTime;
-    ui16DelayTime = xTaskGetTickCount();
+    return CyclesGet() - g_ui32BatchCycles;
+}
 
-    while (1)
-    {
-        ADCProcessorTrigger(ADC0_BASE, 3);
-        vTaskDelayUntil(&ui16DelayTime, ADC_DELAY / portTICK_RATE_MS);
-    }
+//*****************************************************************************
+//
+// Returns the CPU cycles from the trigger to the last sample being stored.
+//
+//*****************************************************************************
+uint32_t
+ui32HeightSenseCycles(void)
+{
+    return g_ui32SenseCycles;
 }
 
 //*****************************************************************************
 //
-// Handling task for the ADC. Takes the semaphore and samples the ADC, storing
-// the value in a global variable.
+// Returns the number of samples dropped because the stream buffer was full.
 //
 //*****************************************************************************
-static void
-vADCHandlingTask (void *pvParameters)
+uint32_t
+ui32HeightDropped(void)
 {
+    return g_ui32Dropped;
+}
 
-    while(1)
+//*****************************************************************************
+//
+// Waits for the next batch of samples and averages it into the height.
+// Returns the number of batches received: 0 on timeout, more than 1 if the
+// caller fell behind, in which case only the newest batch is used. The
+// trigger level is set to the rest of the batch so the caller wakes once.
+//
+//*****************************************************************************
+uint32_t
+ui32HeightReceiveBatches(TickType_t xTicksToWait)
+{
+    TimeOut_t xTimeOut;
+    uint32_t ui32Batches = 0;
+    uint32_t ui32Sum = 0;
+    uint32_t ui32Min = UINT32_MAX;
+    uint32_t ui32Max = 0;
+    uint32_t i;
+
+    vTaskSetTimeOutState(&xTimeOut);
+
+    do
     {
-        xSemaphoreTake( xCountingSemaphore, portMAX_DELAY );
-        ADCSequenceDataGet(ADC0_BASE, 3, &g_ui32Height);      // Get the single sample from ADC0.
-        SendToDebugger (g_ui32Height, HEIGHT);
+        while (g_xBatchBytes < HEIGHT_BATCH_BYTES)
+        {
+            if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdTRUE)
+            {
+                return 0;
+            }
+            xStreamBufferSetTriggerLevel(g_xSampleStream, HEIGHT_BATCH_BYTES - g_xBatchBytes);
+            g_xBatchBytes += xStreamBufferReceive(g_xSampleStream, (uint8_t *) g_pui16Batch + g_xBatchBytes,
+                                                  HEIGHT_BATCH_BYTES - g_xBatchBytes, xTicksToWait);
+        }
+        g_xBatchBytes = 0;
+        ui32Batches++;
+    } while (xStreamBufferBytesAvailable(g_xSampleStream) >= HEIGHT_BATCH_BYTES);
+
+    for (i = 0; i < HEIGHT_BATCH_SAMPLES; i++)
+    {
+        ui32Sum += g_pui16Batch[i];
+        if (g_pui16Batch[i] < ui32Min)
+        {
+            ui32Min = g_pui16Batch[i];
+        }
+        if (g_pui16Batch[i] > ui32Max)
+        {
+            ui32Max = g_pui16Batch[i];
+        }
     }
+    g_ui32Height = (ui32Sum + HEIGHT_BATCH_SAMPLES / 2) / HEIGHT_BATCH_SAMPLES;
+    g_ui32BatchMin = ui32Min;
+    g_ui32BatchMax = ui32Max;
+
+    return ui32Batches;
 }
 
 //*****************************************************************************
 //
-// Handles the ADC interrupt and clears it. Gives a semaphore to allow the ADC
-// task to run.
+// Returns the raw mean, minimum and maximum of the last batch, for the
+// sensor checks.
+//
+//*****************************************************************************
+void
+vHeightGetBatch(uint32_t *pui32Mean, uint32_t *pui32Min, uint32_t *pui32Max)
+{
+    *pui32Mean = g_ui32Height;
+    *pui32Min = g_ui32BatchMin;
+    *pui32Max = g_ui32BatchMax;
+}
+
+//*****************************************************************************
+//
+// Timer callback that reports the height to the debugger and display at
+// 10Hz. Runs in the FreeRTOS timer task.
+//
+//*****************************************************************************
+static void
+vHeightReportService (TimerHandle_t xTimer)
+{
+    SendToDebugger (g_ui32Height, HEIGHT);
+    DisplayValueUpdated (DISPLAY_HEIGHT, GetHeight());
+}
+
+//*****************************************************************************
+//
+// Handles the ADC interrupt and clears it. Pushes the raw sample into the
+// stream buffer, which wakes the controller task once the batch is complete.
 //
 //*****************************************************************************
 void
 ADCIntHandler( void )
 {
      BaseType_t xHigherPriorityTaskWoken;
+     uint32_t ui32Sample;
+     uint16_t ui16Sample;
+     uint32_t ui32Since;
 
      ADCIntClear(ADC0_BASE, 3);
+     ADCSequenceDataGet(ADC0_BASE, 3, &ui32Sample);        // Get the single sample from ADC0.
+     ui32Since = TimerLoadGet(ADC_TIMER_BASE, TIMER_A) - TimerValueGet(ADC_TIMER_BASE, TIMER_A);
+     g_ui32SenseCycles = ui32Since;
+     ui16Sample = ui32Sample;
 
      /* The xHigherPriorityTaskWoken parameter must be initialized to pdFALSE as it
      will get set to pdTRUE inside the interrupt safe API function if a context switch
      is required. */
      xHigherPriorityTaskWoken = pdFALSE;
 
-     /* 'Give' the semaphore. Will unblock the deferred interrupt handling task. */
-     xSemaphoreGiveFromISR( xCountingSemaphore, &xHigherPriorityTaskWoken );
-
-     /*If xHigherPriorityTaskWoken was set to pdTRUE inside xSemaphoreGiveFromISR() then
+     /* Only whole samples are written, so the batches stay aligned. */
+     if (xStreamBufferSpacesAvailable(g_xSampleStream) < sizeof(ui16Sample))
+     {
+         g_ui32Dropped++;
+     }
+     else
+     {
+         if (++g_ui32BatchFill == HEIGHT_BATCH_SAMPLES)
+         {
+             g_ui32BatchFill = 0;
+             g_ui32BatchCycles = CyclesGet() - ui32Since;
+         }
+         xStreamBufferSendFromISR(g_xSampleStream, &ui16Sample, sizeof(ui16Sample),
+                                  &xHigherPriorityTaskWoken);
+     }
+
+     /*If xHigherPriorityTaskWoken was set to pdTRUE inside xStreamBufferSendFromISR() then
      calling portYIELD_FROM_ISR() will request a context switch. */
      portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
 }
 
 //*****************************************************************************
 //
-// Initializes the ADC peripheral and interrupt.
+// Initializes the ADC peripheral and interrupt. Conversions are triggered by
+// TIMER0A, which is started by InitReadHeight. The channel comes from the
+// calibration: 0 for the emulator, 9 for the potentiometer.
 //
 //*****************************************************************************
 void
 vInitADC(void)
 {
-        // NOTE: change ADC_CTL_CH9 to ADC_CTL_CH0 for sampling from emulator. Currently sampling from potentiometer
+        CALIB_RECORD sCalib;
+
+        vCalibGet(&sCalib);
 
         SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);                             // The ADC0 peripheral must be enabled for configuration and use.
 
-        ADCSequenceConfigure(ADC0_BASE, 3, ADC_TRIGGER_PROCESSOR, 0);           // Enable sample sequence 3 with a processor signal trigger.
+        ADCSequenceConfigure(ADC0_BASE, 3, ADC_TRIGGER_TIMER, 0);               // Enable sample sequence 3 with a timer trigger.
 
-        ADCSequenceStepConfigure(ADC0_BASE, 3, 0, ADC_CTL_CH9 | ADC_CTL_IE |
+        ADCSequenceStepConfigure(ADC0_BASE, 3, 0, sCalib.ui8AdcChannel | ADC_CTL_IE |
                                  ADC_CTL_END);                                  // Configure step 0 on sequence 3.
 
         ADCSequenceEnable(ADC0_BASE, 3);                                        // Since sample sequence 3 is now configured, it must be enabled.
 
         ADCIntRegister(ADC0_BASE, 3, ADCIntHandler);
+        IntPrioritySet(INT_ADC0SS3, ADC_INT_PRIORITY);
 
         ADCIntEnable(ADC0_BASE, 3);                                             // Enable interrupts for ADC0 sequence 3 (clears any outstanding interrupts)
 }
 
 //*****************************************************************************
 //
-// Initializes the ADC and periodic task.
+// Initializes the sample stream, the ADC, its trigger timer and the report
+// timer.
 //
 //****************************************************************************
 uint32_t
 InitReadHeight (void)
 {
-    vInitADC (); // Initialise the ADC peripheral.
-
-    // Create counting semaphore with max count of 10.
-    xCountingSemaphore = xSemaphoreCreateCounting( 10, 0 );
+    CyclesInit();
 
-    //
-    // Create the a task to periodically trigger the ADC.
-    //
-    if(xTaskCreate(vPeriodicADCTask, (const portCHAR *)"PeriodicTask",
-                   PERIODICTASKSTACKSIZE, NULL,  tskIDLE_PRIORITY + PERIODICTASKPRIORITY, NULL) != pdTRUE)
+    g_xSampleStream = xMemMapStreamBufferCreate(MEMMAP_STREAM_HEIGHT, HEIGHT_BATCH_BYTES);
+    if(g_xSampleStream == NULL ||
+       xStreamBufferSpacesAvailable(g_xSampleStream) < 2 * HEIGHT_BATCH_BYTES)
     {
         return(1);
     }
 
+    vInitADC (); // Initialise the ADC peripheral.
+
     //
-    // Create the ADC handling task to read the ADC.
+    // Create a timer to report the height.
     //
-    if(xTaskCreate(vADCHandlingTask, (const portCHAR *)"ADCRead",
-                   ADCTASKSTACKSIZE, NULL,  tskIDLE_PRIORITY + ADCTASKPRIORITY, NULL) != pdTRUE)
+    xReportTimer = xMemMapTimerCreate(MEMMAP_TIMER_HEIGHT_REPORT, pdMS_TO_TICKS(HEIGHT_REPORT_DELAY),
+                                      pdTRUE, vHeightReportService);
+    if(xReportTimer == NULL || xTimerStart(xReportTimer, 0) != pdPASS)
     {
         return(1);
     }
 
+    //
+    // Trigger conversions at the sample rate.
+    //
+    SysCtlPeripheralEnable(ADC_TIMER_PERIPH);
+    TimerConfigure(ADC_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(ADC_TIMER_BASE, TIMER_A, SysCtlClockGet() / HEIGHT_SAMPLE_HZ - 1);
+    TimerControlTrigger(ADC_TIMER_BASE, TIMER_A, true);
+    TimerEnable(ADC_TIMER_BASE, TIMER_A);
+
     return(0);
 }
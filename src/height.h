@@ -28,5 +28,10 @@
 //*****************************************************************************
 uint32_t InitReadHeight(void);
 uint32_t GetHeight(void);
+uint32_t ui32HeightCyclesSinceTrigger(void);
+uint32_t ui32HeightSenseCycles(void);
+uint32_t ui32HeightDropped(void);
+uint32_t ui32HeightReceiveBatches(TickType_t);
+void vHeightGetBatch(uint32_t *, uint32_t *, uint32_t *);
 
 #endif /* HEIGHT_H_ */
@@ -0,0 +1,279 @@
+/*
+ * File: hsm.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: A small hierarchical state machine engine. Each update runs
+ * the do actions of the active states, then takes at most one transition: a
+ * timeout, or the first transition whose guard passes, checking the
+ * innermost state first. A transition exits states up to the nearest common
+ * parent of the source and target, then enters states down to the target.
+ * The last HSM_LOG_SIZE transitions are logged with the tick they happened
+ * on.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hsm.h"
+
+//*****************************************************************************
+//
+// Local prototypes for the hsm module.
+//
+//*****************************************************************************
+static uint8_t ui8HsmPath (const HSM *psHsm, uint8_t ui8State, uint8_t *pui8Path);
+static void vHsmTransition (HSM *psHsm, uint8_t ui8Target, bool bTimeout);
+
+//*****************************************************************************
+//
+// Fills pui8Path with the state and its parents, innermost first. Returns
+// the number of states in the path.
+//
+//*****************************************************************************
+static uint8_t
+ui8HsmPath (const HSM *psHsm, uint8_t ui8State, uint8_t *pui8Path)
+{
+    uint8_t ui8Depth = 0;
+
+    while (ui8State != HSM_NONE && ui8Depth < HSM_MAX_DEPTH)
+    {
+        pui8Path[ui8Depth++] = ui8State;
+        ui8State = psHsm->psStates[ui8State].ui8Parent;
+    }
+
+    return ui8Depth;
+}
+
+//*****************************************************************************
+//
+// Moves from the current state to ui8Target, running exit and entry actions,
+// and records the transition.
+//
+//*****************************************************************************
+static void
+vHsmTransition (HSM *psHsm, uint8_t ui8Target, bool bTimeout)
+{
+    uint8_t pui8From[HSM_MAX_DEPTH];
+    uint8_t pui8To[HSM_MAX_DEPTH];
+    uint8_t ui8FromDepth;
+    uint8_t ui8ToDepth;
+    uint8_t ui8Common = 0;
+    uint8_t ui8Source = psHsm->ui8Current;
+    TickType_t xNow = xTaskGetTickCount();
+    HSM_LOG_ENTRY *psEntry;
+    int32_t i;
+
+    ui8FromDepth = ui8HsmPath(psHsm, ui8Source, pui8From);
+    ui8ToDepth = ui8HsmPath(psHsm, ui8Target, pui8To);
+
+    //
+    // Count the parents shared by both paths, working in from the root. A
+    // transition to the same state exits and re-enters it.
+    //
+    while (ui8Common < ui8FromDepth && ui8Common < ui8ToDepth &&
+           pui8From[ui8FromDepth - 1 - ui8Common] == pui8To[ui8ToDepth - 1 - ui8Common])
+    {
+        ui8Common++;
+    }
+    if (ui8Source == ui8Target && ui8Common > 0)
+    {
+        ui8Common--;
+    }
+
+    for (i = 0; i < ui8FromDepth - ui8Common; i++)
+    {
+        if (psHsm->psStates[pui8From[i]].pfnExit != NULL)
+        {
+            psHsm->psStates[pui8From[i]].pfnExit();
+        }
+    }
+
+    psHsm->ui8Current = ui8Target;
+
+    for (i = ui8ToDepth - ui8Common - 1; i >= 0; i--)
+    {
+        psHsm->pxEntered[pui8To[i]] = xNow;
+        if (psHsm->psStates[pui8To[i]].pfnEntry != NULL)
+        {
+            psHsm->psStates[pui8To[i]].pfnEntry();
+        }
+    }
+
+    psEntry = &psHsm->psLog[psHsm->ui32Transitions % HSM_LOG_SIZE];
+    psEntry->xTick = xNow;
+    psEntry->ui8From = ui8Source;
+    psEntry->ui8To = ui8Target;
+    psEntry->bTimeout = bTimeout;
+    psHsm->ui32Transitions++;
+
+    if (psHsm->pfnHook != NULL)
+    {
+        psHsm->pfnHook(psEntry);
+    }
+}
+
+//*****************************************************************************
+//
+// Starts a machine in ui8Initial, running the entry actions of the state
+// and its parents, outermost first.
+//
+//*****************************************************************************
+void
+vHsmInit (HSM *psHsm, const HSM_STATE *psStates, uint8_t ui8NumStates,
+          uint8_t ui8Initial, HsmTransitionHook pfnHook)
+{
+    uint8_t pui8Path[HSM_MAX_DEPTH];
+    uint8_t ui8Depth;
+    TickType_t xNow = xTaskGetTickCount();
+    int32_t i;
+
+    configASSERT(ui8NumStates <= HSM_MAX_STATES);
+
+    psHsm->psStates = psStates;
+    psHsm->ui8NumStates = ui8NumStates;
+    psHsm->ui8Current = ui8Initial;
+    psHsm->pfnHook = pfnHook;
+    psHsm->ui32Transitions = 0;
+
+    ui8Depth = ui8HsmPath(psHsm, ui8Initial, pui8Path);
+    for (i = ui8Depth - 1; i >= 0; i--)
+    {
+        psHsm->pxEntered[pui8Path[i]] = xNow;
+        if (psStates[pui8Path[i]].pfnEntry != NULL)
+        {
+            psStates[pui8Path[i]].pfnEntry();
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Runs one step of the machine.
+//
+//*****************************************************************************
+void
+vHsmUpdate (HSM *psHsm)
+{
+    uint8_t pui8Path[HSM_MAX_DEPTH];
+    uint8_t ui8Depth;
+    const HSM_STATE *psState;
+    TickType_t xNow;
+    int32_t i;
+    uint32_t j;
+
+    ui8Depth = ui8HsmPath(psHsm, psHsm->ui8Current, pui8Path);
+
+    for (i = ui8Depth - 1; i >= 0; i--)
+    {
+        if (psHsm->psStates[pui8Path[i]].pfnDo != NULL)
+        {
+            psHsm->psStates[pui8Path[i]].pfnDo();
+        }
+    }
+
+    xNow = xTaskGetTickCount();
+
+    for (i = 0; i < ui8Depth; i++)
+    {
+        psState = &psHsm->psStates[pui8Path[i]];
+
+        if (psState->ui32TimeoutMs != 0 &&
+            (xNow - psHsm->pxEntered[pui8Path[i]]) >= pdMS_TO_TICKS(psState->ui32TimeoutMs))
+        {
+            vHsmTransition(psHsm, psState->ui8TimeoutTarget, true);
+            return;
+        }
+
+        for (j = 0; j < psState->ui8NumTransitions; j++)
+        {
+            if (psState->psTransitions[j].pfnGuard == NULL ||
+                psState->psTransitions[j].pfnGuard())
+            {
+                vHsmTransition(psHsm, psState->psTransitions[j].ui8Target, false);
+                return;
+            }
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Returns the innermost active state.
+//
+//*****************************************************************************
+uint8_t
+ui8HsmGetState (const HSM *psHsm)
+{
+    return psHsm->ui8Current;
+}
+
+//*****************************************************************************
+//
+// Returns true if ui8State is the current state or one of its parents.
+//
+//*****************************************************************************
+bool
+bHsmInState (const HSM *psHsm, uint8_t ui8State)
+{
+    uint8_t ui8Active = psHsm->ui8Current;
+
+    while (ui8Active != HSM_NONE)
+    {
+        if (ui8Active == ui8State)
+        {
+            return true;
+        }
+        ui8Active = psHsm->psStates[ui8Active].ui8Parent;
+    }
+
+    return false;
+}
+
+//*****************************************************************************
+//
+// Copies up to ui32Max logged transitions, oldest first. Returns the number
+// copied.
+//
+//*****************************************************************************
+uint32_t
+ui32HsmGetLog (const HSM *psHsm, HSM_LOG_ENTRY *psLog, uint32_t ui32Max)
+{
+    uint32_t ui32Count;
+    uint32_t ui32First;
+    uint32_t i;
+
+    taskENTER_CRITICAL();
+    ui32Count = psHsm->ui32Transitions;
+    if (ui32Count > HSM_LOG_SIZE)
+    {
+        ui32Count = HSM_LOG_SIZE;
+    }
+    if (ui32Count > ui32Max)
+    {
+        ui32Count = ui32Max;
+    }
+    ui32First = psHsm->ui32Transitions - ui32Count;
+
+    for (i = 0; i < ui32Count; i++)
+    {
+        psLog[i] = psHsm->psLog[(ui32First + i) % HSM_LOG_SIZE];
+    }
+    taskEXIT_CRITICAL();
+
+    return ui32Count;
+}
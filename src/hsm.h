@@ -0,0 +1,118 @@
+/*
+ * File: hsm.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the hierarchical state machine engine. A
+ * machine is a constant table of states. Each state may have a parent, entry,
+ * exit and do actions, a list of guarded transitions and a timeout.
+ *
+ *
+ */
+
+#ifndef HSM_H_
+#define HSM_H_
+
+//*****************************************************************************
+//
+// Limits of the engine.
+//
+//*****************************************************************************
+#define HSM_MAX_STATES          8
+#define HSM_MAX_DEPTH           4           // Nesting levels, including the leaf
+#define HSM_LOG_SIZE            8           // Transitions kept in the log
+#define HSM_NONE                0xFF        // No parent or no timeout target
+
+//*****************************************************************************
+//
+// Actions and guards. A NULL guard is always true.
+//
+//*****************************************************************************
+typedef void (*HsmAction)(void);
+typedef bool (*HsmGuard)(void);
+
+//*****************************************************************************
+//
+// A transition, taken when its guard returns true.
+//
+//*****************************************************************************
+typedef struct {
+    HsmGuard        pfnGuard;
+    uint8_t         ui8Target;
+} HSM_TRANSITION;
+
+//*****************************************************************************
+//
+// A state. The do action runs every update while the state is active,
+// outermost state first. Transitions of the innermost state are checked
+// first, then those of its parents. A timeout of zero never expires.
+//
+//*****************************************************************************
+typedef struct {
+    const char              *pcName;
+    uint8_t                 ui8Parent;
+    HsmAction               pfnEntry;
+    HsmAction               pfnExit;
+    HsmAction               pfnDo;
+    const HSM_TRANSITION    *psTransitions;
+    uint8_t                 ui8NumTransitions;
+    uint32_t                ui32TimeoutMs;
+    uint8_t                 ui8TimeoutTarget;
+} HSM_STATE;
+
+//*****************************************************************************
+//
+// A logged transition. bTimeout is set when the state timed out.
+//
+//*****************************************************************************
+typedef struct {
+    TickType_t      xTick;
+    uint8_t         ui8From;
+    uint8_t         ui8To;
+    bool            bTimeout;
+} HSM_LOG_ENTRY;
+
+//*****************************************************************************
+//
+// Called after every transition, e.g. to send it to the telemetry.
+//
+//*****************************************************************************
+typedef void (*HsmTransitionHook)(const HSM_LOG_ENTRY *);
+
+//*****************************************************************************
+//
+// A running machine.
+//
+//*****************************************************************************
+typedef struct {
+    const HSM_STATE     *psStates;
+    uint8_t             ui8NumStates;
+    uint8_t             ui8Current;
+    TickType_t          pxEntered[HSM_MAX_STATES];
+    HsmTransitionHook   pfnHook;
+    HSM_LOG_ENTRY       psLog[HSM_LOG_SIZE];
+    uint32_t            ui32Transitions;
+} HSM;
+
+//*****************************************************************************
+//
+// Prototypes for the hsm module.
+//
+//*****************************************************************************
+void vHsmInit (HSM *psHsm, const HSM_STATE *psStates, uint8_t ui8NumStates,
+               uint8_t ui8Initial, HsmTransitionHook pfnHook);
+void vHsmUpdate (HSM *psHsm);
+uint8_t ui8HsmGetState (const HSM *psHsm);
+bool bHsmInState (const HSM *psHsm, uint8_t ui8State);
+uint32_t ui32HsmGetLog (const HSM *psHsm, HSM_LOG_ENTRY *psLog, uint32_t ui32Max);
+
+#endif /* HSM_H_ */
@@ -0,0 +1,142 @@
+/*
+ * File: idle.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Measures tickless idle. When every task is blocked for two or
+ * more ticks the port stops the 1 kHz tick, reloads SysTick for the whole idle
+ * period and waits for an interrupt. On wakeup the kernel steps the tick count
+ * forward by the periods that passed. The hooks here count each sleep, time
+ * it with the DWT cycle counter around the WFI, and count the ticks skipped.
+ *
+ * Any interrupt ends a sleep, and the 2 kHz ADC trigger fires during every
+ * one, so a sleep lasts at most 0.5 ms and few ticks are ever skipped. The
+ * idle share is therefore taken from the cycles actually spent asleep, not
+ * from the skipped ticks.
+ *
+ * The CPU uses sleep rather than deep sleep, so the PWM, ADC, UART and
+ * SysTick keep their clocks while it waits.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "idle.h"
+#include "cycles.h"
+
+//*****************************************************************************
+//
+// Counters updated by the kernel hooks, and their values at the last report.
+//
+//*****************************************************************************
+static volatile uint32_t g_ui32Sleeps = 0;
+static volatile uint32_t g_ui32SkippedTicks = 0;
+static volatile uint64_t g_ui64SleepCycles = 0;
+static uint32_t g_ui32SleepStart;
+
+static uint32_t g_ui32LastSleeps = 0;
+static uint32_t g_ui32LastSkippedTicks = 0;
+static uint64_t g_ui64LastSleepCycles = 0;
+static TickType_t g_xLastReport = 0;
+
+//*****************************************************************************
+//
+// Called with interrupts disabled just before the WFI.
+//
+//*****************************************************************************
+void
+vIdlePreSleep (void)
+{
+    CyclesInit();
+    g_ui32SleepStart = CyclesGet();
+}
+
+//*****************************************************************************
+//
+// Called with interrupts still disabled once an interrupt has woken the CPU.
+// A sleep is far shorter than the cycle counter wrap, as SysTick can be
+// reloaded for at most a third of a second.
+//
+//*****************************************************************************
+void
+vIdlePostSleep (void)
+{
+    g_ui64SleepCycles += CyclesGet() - g_ui32SleepStart;
+    g_ui32Sleeps++;
+}
+
+//*****************************************************************************
+//
+// Called when the kernel steps the tick count forward after a sleep.
+//
+//*****************************************************************************
+void
+vIdleTicksSkipped (uint32_t ui32Ticks)
+{
+    g_ui32SkippedTicks += ui32Ticks;
+}
+
+//*****************************************************************************
+//
+// Reports the sleeps since the last call. The first call covers the time
+// since the scheduler started.
+//
+//*****************************************************************************
+void
+IdleGetStats (IDLE_STATS *psStats)
+{
+    TickType_t xNow;
+    uint32_t ui32Sleeps;
+    uint32_t ui32Skipped;
+    uint64_t ui64Cycles;
+    uint64_t ui64Asleep;
+
+    taskENTER_CRITICAL();
+    xNow = xTaskGetTickCount();
+    ui32Sleeps = g_ui32Sleeps;
+    ui32Skipped = g_ui32SkippedTicks;
+    ui64Cycles = g_ui64SleepCycles;
+    taskEXIT_CRITICAL();
+
+    ui64Asleep = ui64Cycles - g_ui64LastSleepCycles;
+
+    psStats->ui32ElapsedTicks = xNow - g_xLastReport;
+    psStats->ui32Sleeps = ui32Sleeps - g_ui32LastSleeps;
+    psStats->ui32SkippedTicks = ui32Skipped - g_ui32LastSkippedTicks;
+    psStats->ui32AsleepUs = (uint32_t) (ui64Asleep / (configCPU_CLOCK_HZ / 1000000));
+    psStats->ui32MeanSleepUs = 0;
+    psStats->ui32WakeupsPerSec = 0;
+    psStats->ui32IdlePermille = 0;
+
+    if (psStats->ui32Sleeps > 0)
+    {
+        psStats->ui32MeanSleepUs = psStats->ui32AsleepUs / psStats->ui32Sleeps;
+    }
+
+    if (psStats->ui32ElapsedTicks > 0)
+    {
+        psStats->ui32WakeupsPerSec = (uint32_t) (((uint64_t) psStats->ui32Sleeps * configTICK_RATE_HZ)
+                                                 / psStats->ui32ElapsedTicks);
+        psStats->ui32IdlePermille = (uint32_t) ((ui64Asleep * 1000 * configTICK_RATE_HZ)
+                                                / ((uint64_t) psStats->ui32ElapsedTicks * configCPU_CLOCK_HZ));
+    }
+
+    g_xLastReport = xNow;
+    g_ui32LastSleeps = ui32Sleeps;
+    g_ui32LastSkippedTicks = ui32Skipped;
+    g_ui64LastSleepCycles = ui64Cycles;
+}
@@ -0,0 +1,52 @@
+/*
+ * File: idle.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the idle module. The module counts and times
+ * the sleeps taken by the tickless idle code in the FreeRTOS port and counts
+ * the ticks they skip, so the console can report wakeups per second and idle
+ * time.
+ *
+ *
+ */
+
+#ifndef IDLE_H_
+#define IDLE_H_
+
+//*****************************************************************************
+//
+// Sleep statistics since the previous call to IdleGetStats().
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t    ui32ElapsedTicks;
+    uint32_t    ui32Sleeps;
+    uint32_t    ui32SkippedTicks;
+    uint32_t    ui32AsleepUs;           // Time spent in WFI
+    uint32_t    ui32MeanSleepUs;
+    uint32_t    ui32WakeupsPerSec;      // Sleeps ended per second
+    uint32_t    ui32IdlePermille;       // Share of time spent asleep
+} IDLE_STATS;
+
+//*****************************************************************************
+//
+// Prototypes for the idle module. The first three are called by the kernel
+// through the hooks in FreeRTOSConfig.h.
+//
+//*****************************************************************************
+void vIdlePreSleep (void);
+void vIdlePostSleep (void);
+void vIdleTicksSkipped (uint32_t ui32Ticks);
+void IdleGetStats (IDLE_STATS *psStats);
+
+#endif /* IDLE_H_ */
@@ -0,0 +1,335 @@
+/*
+ * File: instruments.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module draws a yaw dial and an altitude bar into the OLED
+ * frame buffer using the OrbitOledGrph primitives. The dial shows a needle
+ * for the current yaw and a marker for the reference yaw. The bar shows the
+ * current height with a tick at the reference height.
+ *
+ * The moving parts are drawn in XOR mode so they can be erased by drawing
+ * them again. Only parts whose position has changed are touched, so an
+ * update costs a few short lines rather than a full redraw.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "OrbitOLED/lib_OrbitOled/OrbitOled.h"
+#include "OrbitOLED/lib_OrbitOled/OrbitOledGrph.h"
+#include "OrbitOLED/lib_OrbitOled/FillPat.h"
+
+#include "instruments.h"
+
+//*****************************************************************************
+//
+// Yaw dial geometry, in pixels.
+//
+//*****************************************************************************
+#define DIAL_CENTRE_X           16
+#define DIAL_CENTRE_Y           16
+#define DIAL_RADIUS             15
+#define DIAL_NEEDLE_RADIUS      11
+#define DIAL_MARKER_RADIUS      13
+#define DIAL_RING_STEP          15          // Degrees per ring segment
+#define DIAL_ANGLE_STEP         5           // Resolution of the sine table
+
+//*****************************************************************************
+//
+// Altitude bar geometry, in pixels.
+//
+//*****************************************************************************
+#define BAR_LEFT                36
+#define BAR_RIGHT               43
+#define BAR_TOP                 0
+#define BAR_BOTTOM              31
+#define BAR_FILL_LEFT           (BAR_LEFT + 2)
+#define BAR_FILL_RIGHT          (BAR_RIGHT - 2)
+#define BAR_FILL_BOTTOM         (BAR_BOTTOM - 1)
+#define BAR_FILL_HEIGHT         (BAR_BOTTOM - BAR_TOP - 1)
+#define BAR_TICK_LEFT           (BAR_RIGHT + 2)
+#define BAR_TICK_RIGHT          (BAR_RIGHT + 6)
+
+//*****************************************************************************
+//
+// sin() scaled by 256 for 0 to 90 degrees in DIAL_ANGLE_STEP increments.
+//
+//*****************************************************************************
+static const int16_t g_pi16Sin256[] = {
+      0,  22,  44,  66,  88, 108, 128, 147, 165, 181,
+    196, 210, 222, 232, 241, 247, 252, 255, 256
+};
+
+//*****************************************************************************
+//
+// Positions of the moving parts currently in the frame buffer.
+//
+//*****************************************************************************
+static bool g_bDrawn = false;
+static int16_t g_i16NeedleAngle;
+static int16_t g_i16MarkerAngle;
+static int16_t g_i16BarLevel;
+static int16_t g_i16TickY;
+
+//*****************************************************************************
+//
+// Local prototypes for the instruments module.
+//
+//*****************************************************************************
+static int16_t i16QuantiseAngle (int16_t);
+static int16_t i16Sin256 (int16_t);
+static void vDialPoint (int16_t, int16_t, int *, int *);
+static void vXorNeedle (int16_t);
+static void vXorMarker (int16_t);
+static void vXorBarRows (int16_t, int16_t);
+static void vXorTick (int16_t);
+static int16_t i16HeightToLevel (uint32_t);
+
+//*****************************************************************************
+//
+// Wraps an angle into 0-359 and rounds it to the sine table resolution.
+//
+//*****************************************************************************
+static int16_t
+i16QuantiseAngle (int16_t i16Angle)
+{
+    i16Angle %= 360;
+    if (i16Angle < 0)
+    {
+        i16Angle += 360;
+    }
+
+    i16Angle = ((i16Angle + DIAL_ANGLE_STEP / 2) / DIAL_ANGLE_STEP) * DIAL_ANGLE_STEP;
+
+    return (i16Angle >= 360) ? 0 : i16Angle;
+}
+
+//*****************************************************************************
+//
+// Returns 256 * sin(angle) for a quantised angle in 0-359.
+//
+//*****************************************************************************
+static int16_t
+i16Sin256 (int16_t i16Angle)
+{
+    if (i16Angle <= 90)
+    {
+        return g_pi16Sin256[i16Angle / DIAL_ANGLE_STEP];
+    }
+    else if (i16Angle <= 180)
+    {
+        return g_pi16Sin256[(180 - i16Angle) / DIAL_ANGLE_STEP];
+    }
+    else if (i16Angle <= 270)
+    {
+        return -g_pi16Sin256[(i16Angle - 180) / DIAL_ANGLE_STEP];
+    }
+    return -g_pi16Sin256[(360 - i16Angle) / DIAL_ANGLE_STEP];
+}
+
+//*****************************************************************************
+//
+// Calculates the pixel at the given radius and angle on the dial. Zero
+// degrees is at the top of the dial and angles increase clockwise.
+//
+//*****************************************************************************
+static void
+vDialPoint (int16_t i16Angle, int16_t i16Radius, int *piX, int *piY)
+{
+    int16_t i16Cos = i16Sin256((i16Angle + 90) % 360);
+
+    *piX = DIAL_CENTRE_X + (i16Radius * i16Sin256(i16Angle)) / 256;
+    *piY = DIAL_CENTRE_Y - (i16Radius * i16Cos) / 256;
+}
+
+//*****************************************************************************
+//
+// Toggles the needle pixels for the given angle.
+//
+//*****************************************************************************
+static void
+vXorNeedle (int16_t i16Angle)
+{
+    int iX, iY;
+
+    vDialPoint(i16Angle, DIAL_NEEDLE_RADIUS, &iX, &iY);
+    OrbitOledMoveTo(DIAL_CENTRE_X, DIAL_CENTRE_Y);
+    OrbitOledLineTo(iX, iY);
+}
+
+//*****************************************************************************
+//
+// Toggles the 3x3 reference marker pixels for the given angle.
+//
+//*****************************************************************************
+static void
+vXorMarker (int16_t i16Angle)
+{
+    int iX, iY;
+
+    vDialPoint(i16Angle, DIAL_MARKER_RADIUS, &iX, &iY);
+    OrbitOledMoveTo(iX - 1, iY - 1);
+    OrbitOledFillRect(iX + 1, iY + 1);
+}
+
+//*****************************************************************************
+//
+// Toggles the bar fill between two levels, so only the rows that differ
+// between the old and new height are touched.
+//
+//*****************************************************************************
+static void
+vXorBarRows (int16_t i16From, int16_t i16To)
+{
+    int16_t i16Low = (i16From < i16To) ? i16From : i16To;
+    int16_t i16High = (i16From < i16To) ? i16To : i16From;
+
+    if (i16Low == i16High)
+    {
+        return;
+    }
+
+    OrbitOledMoveTo(BAR_FILL_LEFT, BAR_FILL_BOTTOM - i16High + 1);
+    OrbitOledFillRect(BAR_FILL_RIGHT, BAR_FILL_BOTTOM - i16Low);
+}
+
+//*****************************************************************************
+//
+// Toggles the reference height tick beside the bar.
+//
+//*****************************************************************************
+static void
+vXorTick (int16_t i16Y)
+{
+    OrbitOledMoveTo(BAR_TICK_LEFT, i16Y);
+    OrbitOledLineTo(BAR_TICK_RIGHT, i16Y);
+}
+
+//*****************************************************************************
+//
+// Converts a height percentage to a number of filled bar rows.
+//
+//*****************************************************************************
+static int16_t
+i16HeightToLevel (uint32_t ui32Height)
+{
+    if (ui32Height > 100)
+    {
+        ui32Height = 100;
+    }
+    return (ui32Height * BAR_FILL_HEIGHT) / 100;
+}
+
+//*****************************************************************************
+//
+// Draws the static parts of the instruments. The frame buffer must be clear
+// in the instrument area before calling.
+//
+//*****************************************************************************
+void
+vInstrumentsDrawBackground (void)
+{
+    int16_t i16Angle;
+    int iX, iY;
+
+    OrbitOledSetDrawMode(modOledSet);
+    OrbitOledSetDrawColor(1);
+    OrbitOledSetFillPattern(OrbitOledGetStdPattern(iptnSolid));
+
+    //
+    // Dial ring as a polygon.
+    //
+    vDialPoint(0, DIAL_RADIUS, &iX, &iY);
+    OrbitOledMoveTo(iX, iY);
+    for (i16Angle = DIAL_RING_STEP; i16Angle <= 360; i16Angle += DIAL_RING_STEP)
+    {
+        vDialPoint(i16Angle % 360, DIAL_RADIUS, &iX, &iY);
+        OrbitOledLineTo(iX, iY);
+    }
+
+    //
+    // Altitude bar outline.
+    //
+    OrbitOledMoveTo(BAR_LEFT, BAR_TOP);
+    OrbitOledDrawRect(BAR_RIGHT, BAR_BOTTOM);
+
+    g_bDrawn = false;
+}
+
+//*****************************************************************************
+//
+// Moves any instrument part whose position has changed. Returns true if the
+// frame buffer was modified.
+//
+//*****************************************************************************
+bool
+bInstrumentsUpdate (int16_t i16Yaw, int16_t i16RefYaw, uint32_t ui32Height,
+                    uint32_t ui32RefHeight)
+{
+    int16_t i16NeedleAngle = i16QuantiseAngle(i16Yaw);
+    int16_t i16MarkerAngle = i16QuantiseAngle(i16RefYaw);
+    int16_t i16BarLevel = i16HeightToLevel(ui32Height);
+    int16_t i16TickY = BAR_FILL_BOTTOM - i16HeightToLevel(ui32RefHeight);
+    bool bChanged = false;
+
+    OrbitOledSetDrawMode(modOledXor);
+    OrbitOledSetDrawColor(1);
+    OrbitOledSetFillPattern(OrbitOledGetStdPattern(iptnSolid));
+
+    if (!g_bDrawn)
+    {
+        vXorNeedle(i16NeedleAngle);
+        vXorMarker(i16MarkerAngle);
+        vXorBarRows(0, i16BarLevel);
+        vXorTick(i16TickY);
+        bChanged = true;
+    }
+    else
+    {
+        if (i16NeedleAngle != g_i16NeedleAngle)
+        {
+            vXorNeedle(g_i16NeedleAngle);
+            vXorNeedle(i16NeedleAngle);
+            bChanged = true;
+        }
+        if (i16MarkerAngle != g_i16MarkerAngle)
+        {
+            vXorMarker(g_i16MarkerAngle);
+            vXorMarker(i16MarkerAngle);
+            bChanged = true;
+        }
+        if (i16BarLevel != g_i16BarLevel)
+        {
+            vXorBarRows(g_i16BarLevel, i16BarLevel);
+            bChanged = true;
+        }
+        if (i16TickY != g_i16TickY)
+        {
+            vXorTick(g_i16TickY);
+            vXorTick(i16TickY);
+            bChanged = true;
+        }
+    }
+
+    g_i16NeedleAngle = i16NeedleAngle;
+    g_i16MarkerAngle = i16MarkerAngle;
+    g_i16BarLevel = i16BarLevel;
+    g_i16TickY = i16TickY;
+    g_bDrawn = true;
+
+    OrbitOledSetDrawMode(modOledSet);
+
+    return bChanged;
+}
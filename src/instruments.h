@@ -0,0 +1,32 @@
+/*
+ * File: instruments.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the instruments module. Contains prototypes to
+ * draw the yaw dial and altitude bar into the OLED frame buffer.
+ *
+ *
+ */
+
+#ifndef INSTRUMENTS_H_
+#define INSTRUMENTS_H_
+
+//*****************************************************************************
+//
+// Prototypes for the instruments module.
+//
+//*****************************************************************************
+void vInstrumentsDrawBackground (void);
+bool bInstrumentsUpdate (int16_t, int16_t, uint32_t, uint32_t);
+
+#endif /* INSTRUMENTS_H_ */
@@ -32,8 +32,8 @@
  * - Controller: Controls the state machine of the helicopter and calculates the tail
  * rotor duty cycle using a PI controller.
  *
- * - Height: Reads the height of the helicopter from the ADC using periodically triggered
- * interrupts.
+ * - Height: Reads the height of the helicopter from the ADC. A hardware timer triggers
+ * conversions at 2kHz and the samples reach the controller in a batch per control period.
  *
  * - Angle: Reads the yaw of the helicopter. ISR's are triggered at each edge change by
  * the rotary encoder.
@@ -41,6 +41,9 @@
  * - Debug: Takes information from the controller, height and angle tasks to print to the
  * UART via a FreeRTOS queue.
  *
+ * - Console: Reads commands from the UART to set references and gains, show statistics
+ * and change the telemetry rate.
+ *
  * NOTE: The prototypes vApplicationStackOverflowHook and __error__ have been
  * adapted from freertos_demo.c - Simple FreeRTOS example.
  *
@@ -67,6 +70,10 @@
 #include "controller.h"
 #include "display.h"
 #include "debugger.h"
+#include "console.h"
+#include "bench.h"
+#include "recorder.h"
+#include "calib.h"
 
 //*****************************************************************************
 //
@@ -116,6 +123,11 @@ main(void)
     //Enable interrupts to the processor.
     IntMasterEnable();
 
+    //
+    // Load the sensor calibration before the height and angle tasks use it.
+    //
+    bCalibInit(); // Keeps the defaults if the EEPROM holds none.
+
     //
     // Create display task
     //
@@ -166,6 +178,16 @@ main(void)
         }
     }
 
+    //
+    // Start the flight recorder
+    //
+    if(InitRecorder() != 0)
+    {
+        while(1)
+        {
+        }
+    }
+
     //
     // Create angle task
     //
@@ -187,6 +209,26 @@ main(void)
         }
     }
 
+    //
+    // Create bench task
+    //
+    if (InitBenchTask() != 0)
+    {
+        while(1)
+        {
+        }
+    }
+
+    //
+    // Create console task. Uses the UART set up by the debug task.
+    //
+    if (InitConsoleTask() != 0)
+    {
+        while(1)
+        {
+        }
+    }
+
     //
     // Start the scheduler.  This should not return.
     //
@@ -0,0 +1,375 @@
+/*
+ * File: memmap.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module owns the memory of every FreeRTOS object listed in
+ * memmap.h. With configSUPPORT_STATIC_ALLOCATION set the stacks, TCBs and
+ * queue storage are placed in .bss and the totals are checked against
+ * MEMMAP_RAM_BUDGET at compile time, so the build fails rather than the
+ * helicopter. vMemMapPrint() reports the map and stack usage over the UART.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils/uartstdio.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+#include "timers.h"
+
+#include "memmap.h"
+#include "debugger.h"
+#include "rotor.h"
+#include "bench.h"
+
+//*****************************************************************************
+//
+// Size of each object in the lists, in bytes.
+//
+//*****************************************************************************
+#define MEMMAP_TASK_BYTES(id, name, words)          + ((words) * sizeof(StackType_t) + sizeof(StaticTask_t))
+#define MEMMAP_QUEUE_BYTES(id, name, length, type)  + ((length) * sizeof(type) + sizeof(StaticQueue_t))
+#define MEMMAP_SEMAPHORE_BYTES(id, name)            + sizeof(StaticSemaphore_t)
+#define MEMMAP_STREAM_BYTES(id, name, size)         + ((size) + 1 + sizeof(StaticStreamBuffer_t))
+#define MEMMAP_TIMER_BYTES(id, name)                + sizeof(StaticTimer_t)
+
+#define MEMMAP_IDLE_BYTES       (configMINIMAL_STACK_SIZE * sizeof(StackType_t) + sizeof(StaticTask_t))
+#define MEMMAP_TIMER_TASK_BYTES (configTIMER_TASK_STACK_DEPTH * sizeof(StackType_t) + sizeof(StaticTask_t))
+
+#define MEMMAP_OBJECT_BYTES     (0 MEMMAP_TASKS(MEMMAP_TASK_BYTES)              \
+                                   MEMMAP_QUEUES(MEMMAP_QUEUE_BYTES)            \
+                                   MEMMAP_SEMAPHORES(MEMMAP_SEMAPHORE_BYTES)    \
+                                   MEMMAP_STREAMS(MEMMAP_STREAM_BYTES)          \
+                                   MEMMAP_TIMERS(MEMMAP_TIMER_BYTES)            \
+                                   + MEMMAP_IDLE_BYTES + MEMMAP_TIMER_TASK_BYTES)
+
+//*****************************************************************************
+//
+// Compile time budget check. A negative array size stops the build if the
+// objects no longer fit.
+//
+//*****************************************************************************
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+#define MEMMAP_TOTAL_BYTES      (MEMMAP_OBJECT_BYTES + configTOTAL_HEAP_SIZE)
+#else
+#define MEMMAP_TOTAL_BYTES      configTOTAL_HEAP_SIZE
+typedef char MemMapHeapCheck[(MEMMAP_OBJECT_BYTES <= configTOTAL_HEAP_SIZE) ? 1 : -1];
+#endif
+
+typedef char MemMapBudgetCheck[(MEMMAP_TOTAL_BYTES <= MEMMAP_RAM_BUDGET) ? 1 : -1];
+
+//*****************************************************************************
+//
+// Tables describing each object, generated from the lists in memmap.h.
+//
+//*****************************************************************************
+#define MEMMAP_TASK_NAME(id, name, words)           name,
+#define MEMMAP_TASK_WORDS(id, name, words)          words,
+#define MEMMAP_QUEUE_NAME(id, name, length, type)   name,
+#define MEMMAP_QUEUE_LENGTH(id, name, length, type) length,
+#define MEMMAP_QUEUE_ITEM(id, name, length, type)   sizeof(type),
+#define MEMMAP_SEMAPHORE_NAME(id, name)             name,
+#define MEMMAP_STREAM_NAME(id, name, size)          name,
+#define MEMMAP_STREAM_SIZE(id, name, size)          size,
+#define MEMMAP_TIMER_NAME(id, name)                 name,
+
+static const char * const g_ppcTaskNames[] = { MEMMAP_TASKS(MEMMAP_TASK_NAME) };
+static const uint16_t g_pui16TaskWords[] = { MEMMAP_TASKS(MEMMAP_TASK_WORDS) };
+static const char * const g_ppcQueueNames[] = { MEMMAP_QUEUES(MEMMAP_QUEUE_NAME) };
+static const uint16_t g_pui16QueueLength[] = { MEMMAP_QUEUES(MEMMAP_QUEUE_LENGTH) };
+static const uint16_t g_pui16QueueItem[] = { MEMMAP_QUEUES(MEMMAP_QUEUE_ITEM) };
+static const char * const g_ppcSemaphoreNames[] = { MEMMAP_SEMAPHORES(MEMMAP_SEMAPHORE_NAME) };
+static const char * const g_ppcStreamNames[] = { MEMMAP_STREAMS(MEMMAP_STREAM_NAME) };
+static const uint16_t g_pui16StreamSize[] = { MEMMAP_STREAMS(MEMMAP_STREAM_SIZE) };
+static const char * const g_ppcTimerNames[] = { MEMMAP_TIMERS(MEMMAP_TIMER_NAME) };
+
+//*****************************************************************************
+//
+// Handles of the created tasks, used to read their stack high water marks.
+//
+//*****************************************************************************
+static TaskHandle_t g_pxTaskHandles[NUM_MEMMAP_TASKS];
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+//*****************************************************************************
+//
+// Statically placed storage for each object.
+//
+//*****************************************************************************
+#define MEMMAP_TASK_STORAGE(id, name, words)                    \
+    static StackType_t g_puxStack##id[words];                   \
+    static StaticTask_t g_xTask##id;
+#define MEMMAP_QUEUE_STORAGE(id, name, length, type)            \
+    static uint8_t g_pui8Queue##id[(length) * sizeof(type)];    \
+    static StaticQueue_t g_xQueue##id;
+#define MEMMAP_SEMAPHORE_STORAGE(id, name)                      \
+    static StaticSemaphore_t g_xSemaphore##id;
+#define MEMMAP_STREAM_STORAGE(id, name, size)                   \
+    static uint8_t g_pui8Stream##id[(size) + 1];                \
+    static StaticStreamBuffer_t g_xStream##id;
+#define MEMMAP_TIMER_STORAGE(id, name)                          \
+    static StaticTimer_t g_xTimer##id;
+
+MEMMAP_TASKS(MEMMAP_TASK_STORAGE)
+MEMMAP_QUEUES(MEMMAP_QUEUE_STORAGE)
+MEMMAP_SEMAPHORES(MEMMAP_SEMAPHORE_STORAGE)
+MEMMAP_STREAMS(MEMMAP_STREAM_STORAGE)
+MEMMAP_TIMERS(MEMMAP_TIMER_STORAGE)
+
+static StackType_t g_puxIdleStack[configMINIMAL_STACK_SIZE];
+static StaticTask_t g_xIdleTask;
+static StackType_t g_puxTimerTaskStack[configTIMER_TASK_STACK_DEPTH];
+static StaticTask_t g_xTimerTask;
+
+#define MEMMAP_TASK_STACK(id, name, words)          g_puxStack##id,
+#define MEMMAP_TASK_TCB(id, name, words)            &g_xTask##id,
+#define MEMMAP_QUEUE_STORE(id, name, length, type)  g_pui8Queue##id,
+#define MEMMAP_QUEUE_STRUCT(id, name, length, type) &g_xQueue##id,
+#define MEMMAP_SEMAPHORE_STRUCT(id, name)           &g_xSemaphore##id,
+#define MEMMAP_STREAM_STORE(id, name, size)         g_pui8Stream##id,
+#define MEMMAP_STREAM_STRUCT(id, name, size)        &g_xStream##id,
+#define MEMMAP_TIMER_STRUCT(id, name)               &g_xTimer##id,
+
+static StackType_t * const g_ppuxTaskStacks[] = { MEMMAP_TASKS(MEMMAP_TASK_STACK) };
+static StaticTask_t * const g_ppxTaskTCBs[] = { MEMMAP_TASKS(MEMMAP_TASK_TCB) };
+static uint8_t * const g_ppui8QueueStores[] = { MEMMAP_QUEUES(MEMMAP_QUEUE_STORE) };
+static StaticQueue_t * const g_ppxQueues[] = { MEMMAP_QUEUES(MEMMAP_QUEUE_STRUCT) };
+static StaticSemaphore_t * const g_ppxSemaphores[] = { MEMMAP_SEMAPHORES(MEMMAP_SEMAPHORE_STRUCT) };
+static uint8_t * const g_ppui8StreamStores[] = { MEMMAP_STREAMS(MEMMAP_STREAM_STORE) };
+static StaticStreamBuffer_t * const g_ppxStreams[] = { MEMMAP_STREAMS(MEMMAP_STREAM_STRUCT) };
+static StaticTimer_t * const g_ppxTimers[] = { MEMMAP_TIMERS(MEMMAP_TIMER_STRUCT) };
+
+//*****************************************************************************
+//
+// Supplies the memory for the idle task. Called by the scheduler.
+//
+//*****************************************************************************
+void
+vApplicationGetIdleTaskMemory (StaticTask_t **ppxIdleTaskTCBBuffer,
+                               StackType_t **ppxIdleTaskStackBuffer,
+                               uint32_t *pulIdleTaskStackSize)
+{
+    *ppxIdleTaskTCBBuffer = &g_xIdleTask;
+    *ppxIdleTaskStackBuffer = g_puxIdleStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+//*****************************************************************************
+//
+// Supplies the memory for the timer task. Called by the scheduler.
+//
+//*****************************************************************************
+void
+vApplicationGetTimerTaskMemory (StaticTask_t **ppxTimerTaskTCBBuffer,
+                                StackType_t **ppxTimerTaskStackBuffer,
+                                uint32_t *pulTimerTaskStackSize)
+{
+    *ppxTimerTaskTCBBuffer = &g_xTimerTask;
+    *ppxTimerTaskStackBuffer = g_puxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
+//*****************************************************************************
+//
+// Creates a task from the memory map.
+//
+//*****************************************************************************
+BaseType_t
+xMemMapTaskCreate (MemMapTask eTask, TaskFunction_t pxTaskCode, void *pvParameters,
+                   UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    TaskHandle_t xHandle;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    xHandle = xTaskCreateStatic(pxTaskCode, g_ppcTaskNames[eTask], g_pui16TaskWords[eTask],
+                                pvParameters, uxPriority, g_ppuxTaskStacks[eTask],
+                                g_ppxTaskTCBs[eTask]);
+#else
+    if (xTaskCreate(pxTaskCode, g_ppcTaskNames[eTask], g_pui16TaskWords[eTask],
+                    pvParameters, uxPriority, &xHandle) != pdTRUE)
+    {
+        xHandle = NULL;
+    }
+#endif
+
+    g_pxTaskHandles[eTask] = xHandle;
+    if (pxCreatedTask != NULL)
+    {
+        *pxCreatedTask = xHandle;
+    }
+
+    return (xHandle != NULL) ? pdTRUE : pdFALSE;
+}
+
+//*****************************************************************************
+//
+// Creates a queue from the memory map.
+//
+//*****************************************************************************
+QueueHandle_t
+xMemMapQueueCreate (MemMapQueue eQueue)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    return xQueueCreateStatic(g_pui16QueueLength[eQueue], g_pui16QueueItem[eQueue],
+                              g_ppui8QueueStores[eQueue], g_ppxQueues[eQueue]);
+#else
+    return xQueueCreate(g_pui16QueueLength[eQueue], g_pui16QueueItem[eQueue]);
+#endif
+}
+
+//*****************************************************************************
+//
+// Creates a mutex from the memory map.
+//
+//*****************************************************************************
+SemaphoreHandle_t
+xMemMapSemaphoreCreateMutex (MemMapSemaphore eSemaphore)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    return xSemaphoreCreateMutexStatic(g_ppxSemaphores[eSemaphore]);
+#else
+    return xSemaphoreCreateMutex();
+#endif
+}
+
+//*****************************************************************************
+//
+// Creates a binary semaphore from the memory map.
+//
+//*****************************************************************************
+SemaphoreHandle_t
+xMemMapSemaphoreCreateBinary (MemMapSemaphore eSemaphore)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    return xSemaphoreCreateBinaryStatic(g_ppxSemaphores[eSemaphore]);
+#else
+    return xSemaphoreCreateBinary();
+#endif
+}
+
+//*****************************************************************************
+//
+// Creates a counting semaphore from the memory map.
+//
+//*****************************************************************************
+SemaphoreHandle_t
+xMemMapSemaphoreCreateCounting (MemMapSemaphore eSemaphore, UBaseType_t uxMaxCount,
+                                UBaseType_t uxInitialCount)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    return xSemaphoreCreateCountingStatic(uxMaxCount, uxInitialCount, g_ppxSemaphores[eSemaphore]);
+#else
+    return xSemaphoreCreateCounting(uxMaxCount, uxInitialCount);
+#endif
+}
+
+//*****************************************************************************
+//
+// Creates a stream buffer from the memory map.
+//
+//*****************************************************************************
+StreamBufferHandle_t
+xMemMapStreamBufferCreate (MemMapStream eStream, size_t xTriggerLevel)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    return xStreamBufferCreateStatic(g_pui16StreamSize[eStream], xTriggerLevel,
+                                     g_ppui8StreamStores[eStream], g_ppxStreams[eStream]);
+#else
+    return xStreamBufferCreate(g_pui16StreamSize[eStream], xTriggerLevel);
+#endif
+}
+
+//*****************************************************************************
+//
+// Creates a software timer from the memory map. The timer must still be
+// started with xTimerStart().
+//
+//*****************************************************************************
+TimerHandle_t
+xMemMapTimerCreate (MemMapTimer eTimer, TickType_t xPeriod, UBaseType_t uxAutoReload,
+                    TimerCallbackFunction_t pxCallback)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    return xTimerCreateStatic(g_ppcTimerNames[eTimer], xPeriod, uxAutoReload, NULL,
+                              pxCallback, g_ppxTimers[eTimer]);
+#else
+    return xTimerCreate(g_ppcTimerNames[eTimer], xPeriod, uxAutoReload, NULL, pxCallback);
+#endif
+}
+
+//*****************************************************************************
+//
+// Prints the memory map over the UART. Stack figures are in bytes, with the
+// least free stack each task has had since it started.
+//
+//*****************************************************************************
+void
+vMemMapPrint (void)
+{
+    uint32_t i;
+    uint32_t ui32Free;
+
+    xSemaphoreTake(xUARTSemaphore, portMAX_DELAY);
+
+    UARTprintf("%s allocation\n",
+               (configSUPPORT_STATIC_ALLOCATION == 1) ? "static" : "heap");
+    UARTprintf("task             stack  tcb   free\n");
+    for (i = 0; i < NUM_MEMMAP_TASKS; i++)
+    {
+        ui32Free = 0;
+        if (g_pxTaskHandles[i] != NULL)
+        {
+            ui32Free = uxTaskGetStackHighWaterMark(g_pxTaskHandles[i]) * sizeof(StackType_t);
+        }
+        UARTprintf("%16s %5u %4u %5u\n", g_ppcTaskNames[i],
+                   g_pui16TaskWords[i] * sizeof(StackType_t), sizeof(StaticTask_t), ui32Free);
+    }
+    UARTprintf("%16s %5u %4u %5u\n", "IDLE",
+               configMINIMAL_STACK_SIZE * sizeof(StackType_t), sizeof(StaticTask_t),
+               uxTaskGetStackHighWaterMark(xTaskGetIdleTaskHandle()) * sizeof(StackType_t));
+    UARTprintf("%16s %5u %4u %5u\n", "Tmr Svc",
+               configTIMER_TASK_STACK_DEPTH * sizeof(StackType_t), sizeof(StaticTask_t),
+               uxTaskGetStackHighWaterMark(xTimerGetTimerDaemonTaskHandle()) * sizeof(StackType_t));
+
+    UARTprintf("queue            items  size\n");
+    for (i = 0; i < NUM_MEMMAP_QUEUES; i++)
+    {
+        UARTprintf("%16s %2ux%u  %5u\n", g_ppcQueueNames[i], g_pui16QueueLength[i],
+                   g_pui16QueueItem[i],
+                   g_pui16QueueLength[i] * g_pui16QueueItem[i] + sizeof(StaticQueue_t));
+    }
+    for (i = 0; i < NUM_MEMMAP_SEMAPHORES; i++)
+    {
+        UARTprintf("%16s       %5u\n", g_ppcSemaphoreNames[i], sizeof(StaticSemaphore_t));
+    }
+    for (i = 0; i < NUM_MEMMAP_STREAMS; i++)
+    {
+        UARTprintf("%16s       %5u\n", g_ppcStreamNames[i],
+                   g_pui16StreamSize[i] + 1 + sizeof(StaticStreamBuffer_t));
+    }
+    for (i = 0; i < NUM_MEMMAP_TIMERS; i++)
+    {
+        UARTprintf("%16s       %5u\n", g_ppcTimerNames[i], sizeof(StaticTimer_t));
+    }
+
+    UARTprintf("objects %u heap %u total %u of %u\n", MEMMAP_OBJECT_BYTES,
+               configTOTAL_HEAP_SIZE, MEMMAP_TOTAL_BYTES, MEMMAP_RAM_BUDGET);
+
+    xSemaphoreGive(xUARTSemaphore);
+}
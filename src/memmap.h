@@ -0,0 +1,135 @@
+/*
+ * File: memmap.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This header file specifies the stack size of each FreeRTOS
+ * task and the size of each queue, semaphore and stream buffer, and lists the
+ * software timers. memmap.c
+ * generates the storage for these objects and a memory map of them from the
+ * lists below.
+ *
+ * When configSUPPORT_STATIC_ALLOCATION is 1 every object is placed in .bss at
+ * link time and creating it cannot fail. Otherwise the same calls allocate
+ * from the FreeRTOS heap.
+ *
+ *
+ */
+
+#ifndef MEMMAP_H_
+#define MEMMAP_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+#include "timers.h"
+
+//*****************************************************************************
+//
+// RAM available to the objects below, the FreeRTOS heap and the idle task.
+// The TM4C123 has 32 KB of SRAM; the rest is left for the system stack and
+// the application's own globals.
+//
+//*****************************************************************************
+#define MEMMAP_RAM_BUDGET           (24 * 1024)
+
+//*****************************************************************************
+//
+// Tasks: identifier, name, stack size in words.
+//
+//*****************************************************************************
+#define MEMMAP_TASKS(X)                             \
+    X(DISPLAY,      "Display",          128)        \
+    X(ROTOR,        "Rotor",            128)        \
+    X(BUTTON,       "ButtonTask",       128)        \
+    X(CONTROLLER,   "Controller",       128)        \
+    X(YAW,          "YawHandlingTask",  128)        \
+    X(DEBUG,        "Debug",            128)        \
+    X(BENCH,        "Bench",            128)        \
+    X(CONSOLE,      "Console",          256)
+
+//*****************************************************************************
+//
+// Queues: identifier, name, length, item type.
+//
+//*****************************************************************************
+#define MEMMAP_QUEUES(X)                            \
+    X(DEBUG,        "Debug",            10, DEBUG_VALUES *) \
+    X(ROTOR,        "Rotor",            10, MOTOR_OUTPUT)   \
+    X(BENCH_4,      "Bench 4",          1,  BENCH_MSG_4)    \
+    X(BENCH_32,     "Bench 32",         1,  BENCH_MSG_32)   \
+    X(BENCH_256,    "Bench 256",        1,  BENCH_MSG_256)  \
+    X(BENCH_REF,    "Bench ref",        1,  void *)
+
+//*****************************************************************************
+//
+// Semaphores and mutexes: identifier, name.
+//
+//*****************************************************************************
+#define MEMMAP_SEMAPHORES(X)                        \
+    X(UART,         "UART mutex")                   \
+    X(BENCH,        "Bench binary")
+
+//*****************************************************************************
+//
+// Stream buffers: identifier, name, size in bytes.
+//
+//*****************************************************************************
+#define MEMMAP_STREAMS(X)                           \
+    X(CONSOLE,      "Console RX",       64)         \
+    X(HEIGHT,       "Height samples",   256)
+
+//*****************************************************************************
+//
+// Software timers: identifier, name. Short periodic jobs run as callbacks in
+// the timer task rather than each having a task and stack of their own. The
+// callbacks must not block.
+//
+//*****************************************************************************
+#define MEMMAP_TIMERS(X)                            \
+    X(HEIGHT_REPORT, "Height report")               \
+    X(RECORDER,     "Recorder flush")
+
+//*****************************************************************************
+//
+// Identifiers used to create each object.
+//
+//*****************************************************************************
+#define MEMMAP_TASK_ID(id, name, words)             MEMMAP_TASK_##id,
+#define MEMMAP_QUEUE_ID(id, name, length, type)     MEMMAP_QUEUE_##id,
+#define MEMMAP_SEMAPHORE_ID(id, name)               MEMMAP_SEMAPHORE_##id,
+#define MEMMAP_STREAM_ID(id, name, size)            MEMMAP_STREAM_##id,
+#define MEMMAP_TIMER_ID(id, name)                   MEMMAP_TIMER_##id,
+
+typedef enum { MEMMAP_TASKS(MEMMAP_TASK_ID) NUM_MEMMAP_TASKS } MemMapTask;
+typedef enum { MEMMAP_QUEUES(MEMMAP_QUEUE_ID) NUM_MEMMAP_QUEUES } MemMapQueue;
+typedef enum { MEMMAP_SEMAPHORES(MEMMAP_SEMAPHORE_ID) NUM_MEMMAP_SEMAPHORES } MemMapSemaphore;
+typedef enum { MEMMAP_STREAMS(MEMMAP_STREAM_ID) NUM_MEMMAP_STREAMS } MemMapStream;
+typedef enum { MEMMAP_TIMERS(MEMMAP_TIMER_ID) NUM_MEMMAP_TIMERS } MemMapTimer;
+
+//*****************************************************************************
+//
+// Prototypes for the memmap module.
+//
+//*****************************************************************************
+BaseType_t xMemMapTaskCreate (MemMapTask, TaskFunction_t, void *, UBaseType_t, TaskHandle_t *);
+QueueHandle_t xMemMapQueueCreate (MemMapQueue);
+SemaphoreHandle_t xMemMapSemaphoreCreateMutex (MemMapSemaphore);
+SemaphoreHandle_t xMemMapSemaphoreCreateBinary (MemMapSemaphore);
+SemaphoreHandle_t xMemMapSemaphoreCreateCounting (MemMapSemaphore, UBaseType_t, UBaseType_t);
+StreamBufferHandle_t xMemMapStreamBufferCreate (MemMapStream, size_t);
+TimerHandle_t xMemMapTimerCreate (MemMapTimer, TickType_t, UBaseType_t, TimerCallbackFunction_t);
+void vMemMapPrint (void);
+
+#endif /* MEMMAP_H_ */
@@ -0,0 +1,215 @@
+/*
+ * File: mempool.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Fixed size block pools. Each pool keeps a bitmap of its free
+ * blocks. A block is claimed by clearing its bit with a compare and swap built
+ * on the Cortex-M4 LDREX and STREX instructions, and the counters are updated
+ * the same way. Any exception between the two clears the exclusive monitor,
+ * so the STREX fails and the operation is retried. The pool is lock free: it
+ * never masks interrupts, suspends the scheduler or takes a mutex, and can be
+ * used from tasks and from interrupts of any priority. The console
+ * 'bench pool' command stresses a pool from a task and an interrupt at once.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#include "mempool.h"
+
+//*****************************************************************************
+//
+// Index of the lowest set bit. The argument must not be zero.
+//
+//*****************************************************************************
+#if defined(__TI_ARM__)
+#define MEMPOOL_LOWEST_BIT(x)       (31 - __clz((x) & (0U - (x))))
+#else
+#define MEMPOOL_LOWEST_BIT(x)       (31 - __builtin_clz((x) & (0U - (x))))
+#endif
+
+//*****************************************************************************
+//
+// Local prototypes for the mempool module.
+//
+//*****************************************************************************
+static bool bMemPoolCas (volatile uint32_t *pui32Value, uint32_t ui32Expected, uint32_t ui32New);
+static uint32_t ui32MemPoolAdd (volatile uint32_t *pui32Value, uint32_t ui32Add);
+
+//*****************************************************************************
+//
+// Stores ui32New if the value still holds ui32Expected. Returns false if it
+// did not. Other compilers, such as the host build, use the GCC builtin,
+// which is also LDREX and STREX on the Cortex-M4.
+//
+//*****************************************************************************
+static bool
+bMemPoolCas (volatile uint32_t *pui32Value, uint32_t ui32Expected, uint32_t ui32New)
+{
+#if defined(__TI_ARM__)
+    do
+    {
+        if ((uint32_t) __ldrex((void *) pui32Value) != ui32Expected)
+        {
+            __asm(" clrex");
+            return false;
+        }
+    }
+    while (__strex(ui32New, (void *) pui32Value) != 0);
+
+    return true;
+#else
+    return __atomic_compare_exchange_n(pui32Value, &ui32Expected, ui32New, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+//*****************************************************************************
+//
+// Adds ui32Add to the value and returns the new value. Subtract by adding
+// the two's complement.
+//
+//*****************************************************************************
+static uint32_t
+ui32MemPoolAdd (volatile uint32_t *pui32Value, uint32_t ui32Add)
+{
+    uint32_t ui32Old;
+
+    do
+    {
+        ui32Old = *pui32Value;
+    }
+    while (!bMemPoolCas(pui32Value, ui32Old, ui32Old + ui32Add));
+
+    return ui32Old + ui32Add;
+}
+
+//*****************************************************************************
+//
+// Sets up a pool over pvStorage, which must hold ui32NumBlocks blocks of
+// ui32BlockSize bytes. The storage and block size must be word aligned.
+//
+//*****************************************************************************
+void
+vMemPoolInit (MEMPOOL *psPool, void *pvStorage, uint32_t ui32BlockSize, uint32_t ui32NumBlocks)
+{
+    configASSERT(ui32NumBlocks > 0 && ui32NumBlocks <= MEMPOOL_MAX_BLOCKS);
+    configASSERT(((uintptr_t) pvStorage & 3) == 0);
+    configASSERT((ui32BlockSize & 3) == 0);
+
+    psPool->pui8Storage = (uint8_t *) pvStorage;
+    psPool->ui32BlockSize = ui32BlockSize;
+    psPool->ui32NumBlocks = ui32NumBlocks;
+    psPool->ui32FreeMask = (ui32NumBlocks == 32) ? 0xFFFFFFFF : ((1U << ui32NumBlocks) - 1);
+    psPool->ui32InUse = 0;
+    psPool->ui32Peak = 0;
+    psPool->ui32Allocs = 0;
+    psPool->ui32Failures = 0;
+}
+
+//*****************************************************************************
+//
+// Takes a block from the pool. Returns NULL if every block is in use.
+//
+//*****************************************************************************
+void *
+pvMemPoolAlloc (MEMPOOL *psPool)
+{
+    uint32_t ui32Mask;
+    uint32_t ui32Bit;
+    uint32_t ui32InUse;
+    uint32_t ui32Peak;
+
+    do
+    {
+        ui32Mask = psPool->ui32FreeMask;
+        if (ui32Mask == 0)
+        {
+            ui32MemPoolAdd(&psPool->ui32Failures, 1);
+            return NULL;
+        }
+        ui32Bit = MEMPOOL_LOWEST_BIT(ui32Mask);
+    }
+    while (!bMemPoolCas(&psPool->ui32FreeMask, ui32Mask, ui32Mask & ~(1U << ui32Bit)));
+
+    ui32MemPoolAdd(&psPool->ui32Allocs, 1);
+    ui32InUse = ui32MemPoolAdd(&psPool->ui32InUse, 1);
+
+    //
+    // Raise the high water mark if this is the most blocks used so far.
+    //
+    do
+    {
+        ui32Peak = psPool->ui32Peak;
+        if (ui32InUse <= ui32Peak)
+        {
+            break;
+        }
+    }
+    while (!bMemPoolCas(&psPool->ui32Peak, ui32Peak, ui32InUse));
+
+    return psPool->pui8Storage + ui32Bit * psPool->ui32BlockSize;
+}
+
+//*****************************************************************************
+//
+// Returns a block to the pool it came from.
+//
+//*****************************************************************************
+void
+vMemPoolFree (MEMPOOL *psPool, void *pvBlock)
+{
+    uint32_t ui32Offset;
+    uint32_t ui32Bit;
+    uint32_t ui32Mask;
+
+    if (pvBlock == NULL)
+    {
+        return;
+    }
+
+    ui32Offset = (uint8_t *) pvBlock - psPool->pui8Storage;
+    ui32Bit = ui32Offset / psPool->ui32BlockSize;
+
+    configASSERT(ui32Offset % psPool->ui32BlockSize == 0);
+    configASSERT(ui32Bit < psPool->ui32NumBlocks);
+    configASSERT((psPool->ui32FreeMask & (1U << ui32Bit)) == 0);
+
+    ui32MemPoolAdd(&psPool->ui32InUse, 0U - 1);
+
+    do
+    {
+        ui32Mask = psPool->ui32FreeMask;
+    }
+    while (!bMemPoolCas(&psPool->ui32FreeMask, ui32Mask, ui32Mask | (1U << ui32Bit)));
+}
+
+//*****************************************************************************
+//
+// Copies the pool's usage counters.
+//
+//*****************************************************************************
+void
+vMemPoolGetStats (MEMPOOL *psPool, MEMPOOL_STATS *psStats)
+{
+    psStats->ui32BlockSize = psPool->ui32BlockSize;
+    psStats->ui32NumBlocks = psPool->ui32NumBlocks;
+    psStats->ui32InUse = psPool->ui32InUse;
+    psStats->ui32Peak = psPool->ui32Peak;
+    psStats->ui32Allocs = psPool->ui32Allocs;
+    psStats->ui32Failures = psPool->ui32Failures;
+}
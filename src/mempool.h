@@ -0,0 +1,73 @@
+/*
+ * File: mempool.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Fixed size block pools. A pool hands out blocks of one size
+ * from a buffer supplied by its owner, so messages can be filled in place and
+ * passed through a queue by pointer rather than copied. Blocks can be taken
+ * and returned from tasks and from interrupts of any priority without a lock.
+ *
+ *
+ */
+
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+//*****************************************************************************
+//
+// Largest number of blocks in one pool. One bit of the free mask per block.
+//
+//*****************************************************************************
+#define MEMPOOL_MAX_BLOCKS          32
+
+//*****************************************************************************
+//
+// Struct describing a pool. Only the mempool module should touch the fields.
+//
+//*****************************************************************************
+typedef struct {
+    uint8_t             *pui8Storage;
+    uint32_t            ui32BlockSize;
+    uint32_t            ui32NumBlocks;
+    volatile uint32_t   ui32FreeMask;       // Bit set while the block is free
+    volatile uint32_t   ui32InUse;
+    volatile uint32_t   ui32Peak;
+    volatile uint32_t   ui32Allocs;
+    volatile uint32_t   ui32Failures;
+} MEMPOOL;
+
+//*****************************************************************************
+//
+// Snapshot of a pool's usage.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t    ui32BlockSize;
+    uint32_t    ui32NumBlocks;
+    uint32_t    ui32InUse;
+    uint32_t    ui32Peak;
+    uint32_t    ui32Allocs;
+    uint32_t    ui32Failures;
+} MEMPOOL_STATS;
+
+//*****************************************************************************
+//
+// Prototypes for the mempool module.
+//
+//*****************************************************************************
+void vMemPoolInit (MEMPOOL *psPool, void *pvStorage, uint32_t ui32BlockSize, uint32_t ui32NumBlocks);
+void *pvMemPoolAlloc (MEMPOOL *psPool);
+void vMemPoolFree (MEMPOOL *psPool, void *pvBlock);
+void vMemPoolGetStats (MEMPOOL *psPool, MEMPOOL_STATS *psStats);
+
+#endif /* MEMPOOL_H_ */
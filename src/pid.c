@@ -41,6 +41,17 @@ void pi_init(PI *pi, uint8_t kp, uint8_t ki, uint8_t limit)
     pi->error = 0;
 }
 
+//*****************************************************************************
+//
+// Change the gains of a PI instance, keeping the accumulator.
+//
+//*****************************************************************************
+void pi_set_gains(PI *pi, uint8_t kp, uint8_t ki)
+{
+    pi->kp = kp;
+    pi->ki = ki;
+}
+
 //*****************************************************************************
 //
 // Update a PI controller with a new error.
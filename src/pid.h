@@ -46,6 +46,13 @@ typedef struct
 //*****************************************************************************
 void pi_init(PI*, uint8_t, uint8_t, uint8_t);
 
+//*****************************************************************************
+//
+// Change the gains of a PI instance, keeping the accumulator.
+//
+//*****************************************************************************
+void pi_set_gains(PI*, uint8_t, uint8_t);
+
 //*****************************************************************************
 //
 // Update a PI controller with a new error.
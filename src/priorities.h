@@ -13,7 +13,7 @@
  * Created on: 28.08.21
  *
  * Description: This header file specifies the priorities of each
- * FreeRTOS task.
+ * FreeRTOS task and of the interrupts that use the FreeRTOS API.
  *
  *
  */
@@ -27,12 +27,25 @@
 //
 //*****************************************************************************
 #define BUTTONTASKPRIORITY         1
-#define CONTROLLERTASKPRIORITY     1
+#define CONSOLETASKPRIORITY        1
+#define CONTROLLERTASKPRIORITY     4   // Woken by each height sample
 #define DEBUGTASKPRIORITY          1
 #define DISPLAYTASKPRIORITY        1
-#define ADCTASKPRIORITY            2
-#define PERIODICTASKPRIORITY       1
-#define ROTORTASKPRIORITY          1
-#define YAWTASKPRIORITY            3
+#define ROTORTASKPRIORITY          5   // Writes the PWM before the controller resumes
+#define BENCHTASKPRIORITY          7   // Only runs during the console bench command
+#define YAWTASKPRIORITY            6   // Above the control pipeline so no encoder edge waits
+
+//*****************************************************************************
+//
+// The priorities of interrupts that use the FreeRTOS API. These must not be
+// more urgent than configMAX_SYSCALL_INTERRUPT_PRIORITY, so the upper three
+// bits are never below (1 << 5).
+//
+//*****************************************************************************
+#define YAW_INT_PRIORITY           (2 << 5)
+#define ADC_INT_PRIORITY           (3 << 5)
+#define BENCH_INT_PRIORITY         (4 << 5)
+#define BUTTON_INT_PRIORITY        (5 << 5)
+#define CONSOLE_INT_PRIORITY       (6 << 5)
 
 #endif /* PRIORITIES_H_ */
@@ -0,0 +1,679 @@
+/*
+ * File: recorder.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module is a flight data recorder. The controller task
+ * samples the yaw, height, references, state and duties at 20Hz into a RAM
+ * ring holding the last 8 s. A trigger, either the state machine entering
+ * FAULT or the console, records 4 s more and freezes the ring. Once the
+ * rotors have stopped, a software timer delta encodes the capture into the
+ * RECORDER region of flash. The CPU stalls while the flash is erased, which
+ * would lose encoder edges in flight, so nothing is written until then.
+ *
+ * Captures start on a sector boundary after the previous capture and wrap
+ * around the region, so erases are spread evenly over its sectors and the
+ * oldest captures are overwritten first.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "driverlib/flash.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "timers.h"
+
+#include "recorder.h"
+#include "yaw.h"
+#include "height.h"
+#include "button_task.h"
+#include "fsm.h"
+#include "rotor.h"
+#include "memmap.h"
+
+//*****************************************************************************
+//
+// The flash region. It must match the RECORDER region of tm4c123gh6pm.cmd.
+//
+//*****************************************************************************
+#define REC_FLASH_ADDR          0x0003BC00
+#define REC_SECTOR_BYTES        1024
+#define REC_SECTORS             16
+#define REC_FLASH_BYTES         (REC_SECTORS * REC_SECTOR_BYTES)
+#define REC_MAGIC               0x52454330  // "REC0"
+
+//*****************************************************************************
+//
+// Sampling. The controller runs every 25 ms, so every second cycle is kept.
+//
+//*****************************************************************************
+#define REC_DIVIDER             2
+#define REC_PERIOD_MS           50
+#define REC_PRE_SAMPLES         160         // 8 s before the trigger
+#define REC_POST_SAMPLES        80          // 4 s after it
+#define REC_RING_SAMPLES        (REC_PRE_SAMPLES + REC_POST_SAMPLES)
+#define REC_FLUSH_PERIOD_MS     100
+
+//*****************************************************************************
+//
+// Encoding. Each sample is a key frame holding every field, or a mask byte
+// of the fields that changed followed by their signed 8 bit deltas. Key
+// frames are written at the start, periodically, and when a delta does not
+// fit.
+//
+//*****************************************************************************
+#define REC_KEY                 0xFF
+#define REC_KEY_INTERVAL        40
+
+//*****************************************************************************
+//
+// Struct for the capture header, at the start of its first sector.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Magic;
+    uint32_t ui32Sequence;
+    uint16_t ui16Samples;
+    uint16_t ui16Trigger;
+    uint16_t ui16Bytes;
+    uint8_t ui8PeriodMs;
+    uint8_t ui8Reason;
+    uint32_t ui32DataSum;       // Rotating sum of the encoded bytes
+    uint32_t ui32Checksum;      // Rotating sum of the words above
+} REC_HEADER;
+
+//*****************************************************************************
+//
+// Struct for programming the encoded bytes a word at a time.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Offset;
+    uint32_t ui32Word;
+    uint8_t ui8Fill;
+    uint32_t ui32Sum;
+    bool bError;
+} REC_WRITER;
+
+//*****************************************************************************
+//
+// Recorder state. The ring is only written by the controller task while not
+// frozen, and only read by the flush timer while frozen.
+//
+//*****************************************************************************
+typedef enum {
+    REC_RECORDING,
+    REC_TRIGGERED,
+    REC_FROZEN
+} RecState;
+
+static REC_SAMPLE g_psRing[REC_RING_SAMPLES];
+static uint16_t g_ui16Head = 0;
+static uint16_t g_ui16Count = 0;
+static uint16_t g_ui16Post = 0;
+static uint16_t g_ui16TriggerHead = 0;  // Ring index of the trigger sample
+static volatile RecState g_eState = REC_RECORDING;
+static uint8_t g_ui8Reason;
+static uint8_t g_ui8PrevState = IDLE;
+
+static uint32_t g_ui32Sequence = 0;     // Of the newest capture in flash
+static uint8_t g_ui8NextSector = 0;
+static uint32_t g_ui32Saved = 0;
+static uint32_t g_ui32Errors = 0;
+
+static TimerHandle_t xFlushTimer;
+
+//*****************************************************************************
+//
+// Local prototypes for the recorder module.
+//
+//*****************************************************************************
+static uint32_t ui32Rotate (uint32_t ui32Sum, uint32_t ui32Value);
+static uint32_t ui32HeaderChecksum (const REC_HEADER *psHeader);
+static uint8_t ui8ReadByte (uint32_t ui32Offset);
+static bool bReadHeader (uint8_t ui8Sector, REC_HEADER *psHeader);
+static void vHeaderCapture (const REC_HEADER *psHeader, uint8_t ui8Sector, REC_CAPTURE *psCapture);
+static void vSampleValues (const REC_SAMPLE *psSample, int16_t *pi16Values);
+static void vWriteByte (REC_WRITER *psWriter, uint8_t ui8Byte);
+static bool bSaveCapture (void);
+static void vRecordFlushService (TimerHandle_t xTimer);
+
+static uint32_t
+ui32Rotate (uint32_t ui32Sum, uint32_t ui32Value)
+{
+    return ((ui32Sum << 1) | (ui32Sum >> 31)) + ui32Value;
+}
+
+//*****************************************************************************
+//
+// Rotating sum of every word of the header before the checksum.
+//
+//*****************************************************************************
+static uint32_t
+ui32HeaderChecksum (const REC_HEADER *psHeader)
+{
+    const uint32_t *pui32Word = (const uint32_t *) psHeader;
+    uint32_t ui32Count = (sizeof(REC_HEADER) - sizeof(uint32_t)) / sizeof(uint32_t);
+    uint32_t ui32Sum = 0;
+
+    while (ui32Count--)
+    {
+        ui32Sum = ui32Rotate(ui32Sum, *pui32Word++);
+    }
+    return ~ui32Sum;
+}
+
+//*****************************************************************************
+//
+// Reads a byte of the region. Offsets past the end wrap to the start.
+//
+//*****************************************************************************
+static uint8_t
+ui8ReadByte (uint32_t ui32Offset)
+{
+    return *((const uint8_t *) (REC_FLASH_ADDR + ui32Offset % REC_FLASH_BYTES));
+}
+
+//*****************************************************************************
+//
+// Reads the header at the start of a sector. Returns true if it is the start
+// of a capture whose header and data are both intact.
+//
+//*****************************************************************************
+static bool
+bReadHeader (uint8_t ui8Sector, REC_HEADER *psHeader)
+{
+    uint32_t ui32Offset = ui8Sector * REC_SECTOR_BYTES;
+    uint32_t ui32Sum = 0;
+    uint32_t i;
+
+    memcpy(psHeader, (const void *) (REC_FLASH_ADDR + ui32Offset), sizeof(REC_HEADER));
+
+    if (psHeader->ui32Magic != REC_MAGIC ||
+        psHeader->ui32Checksum != ui32HeaderChecksum(psHeader) ||
+        psHeader->ui16Bytes > REC_FLASH_BYTES - sizeof(REC_HEADER))
+    {
+        return false;
+    }
+
+    ui32Offset += sizeof(REC_HEADER);
+    for (i = 0; i < psHeader->ui16Bytes; i++)
+    {
+        ui32Sum = ui32Rotate(ui32Sum, ui8ReadByte(ui32Offset + i));
+    }
+
+    return (ui32Sum == psHeader->ui32DataSum);
+}
+
+static void
+vHeaderCapture (const REC_HEADER *psHeader, uint8_t ui8Sector, REC_CAPTURE *psCapture)
+{
+    psCapture->ui32Sequence = psHeader->ui32Sequence;
+    psCapture->ui16Samples = psHeader->ui16Samples;
+    psCapture->ui16Trigger = psHeader->ui16Trigger;
+    psCapture->ui16Bytes = psHeader->ui16Bytes;
+    psCapture->ui8PeriodMs = psHeader->ui8PeriodMs;
+    psCapture->ui8Reason = psHeader->ui8Reason;
+    psCapture->ui8Sector = ui8Sector;
+}
+
+static void
+vSampleValues (const REC_SAMPLE *psSample, int16_t *pi16Values)
+{
+    pi16Values[0] = psSample->i16Yaw;
+    pi16Values[1] = psSample->i16RefYaw;
+    pi16Values[2] = psSample->ui8Height;
+    pi16Values[3] = psSample->ui8RefHeight;
+    pi16Values[4] = psSample->ui8State;
+    pi16Values[5] = psSample->ui8Tail;
+    pi16Values[6] = psSample->ui8Main;
+}
+
+//*****************************************************************************
+//
+// Adds a byte to the capture. Each sector is erased as the capture reaches
+// it and each word is programmed once it is full.
+//
+//*****************************************************************************
+static void
+vWriteByte (REC_WRITER *psWriter, uint8_t ui8Byte)
+{
+    uint32_t ui32Addr;
+
+    psWriter->ui32Sum = ui32Rotate(psWriter->ui32Sum, ui8Byte);
+    psWriter->ui32Word |= (uint32_t) ui8Byte << (8 * psWriter->ui8Fill);
+
+    if (++psWriter->ui8Fill < sizeof(uint32_t))
+    {
+        return;
+    }
+
+    ui32Addr = REC_FLASH_ADDR + psWriter->ui32Offset % REC_FLASH_BYTES;
+    if ((ui32Addr % REC_SECTOR_BYTES) == 0 && FlashErase(ui32Addr) != 0)
+    {
+        psWriter->bError = true;
+    }
+    if (FlashProgram(&psWriter->ui32Word, ui32Addr, sizeof(uint32_t)) != 0)
+    {
+        psWriter->bError = true;
+    }
+
+    psWriter->ui32Offset += sizeof(uint32_t);
+    psWriter->ui32Word = 0;
+    psWriter->ui8Fill = 0;
+}
+
+//*****************************************************************************
+//
+// Encodes the frozen ring into the next free sectors. The header is left
+// erased while the data is written and programmed last, so a capture cut
+// short by a reset is never listed. Returns true on success.
+//
+//*****************************************************************************
+static bool
+bSaveCapture (void)
+{
+    REC_WRITER sWriter;
+    REC_HEADER sHeader;
+    int16_t pi16Prev[REC_FIELDS] = { 0 };
+    int16_t pi16Values[REC_FIELDS];
+    int16_t i16Delta;
+    uint32_t ui32Start = g_ui8NextSector * REC_SECTOR_BYTES;
+    uint16_t ui16Oldest = (g_ui16Head + REC_RING_SAMPLES - g_ui16Count) % REC_RING_SAMPLES;
+    uint8_t ui8Mask;
+    bool bKey;
+    uint16_t i;
+    uint8_t j;
+
+    if (FlashErase(REC_FLASH_ADDR + ui32Start) != 0)
+    {
+        return false;
+    }
+
+    sWriter.ui32Offset = ui32Start + sizeof(REC_HEADER);
+    sWriter.ui32Word = 0;
+    sWriter.ui8Fill = 0;
+    sWriter.ui32Sum = 0;
+    sWriter.bError = false;
+
+    for (i = 0; i < g_ui16Count; i++)
+    {
+        vSampleValues(&g_psRing[(ui16Oldest + i) % REC_RING_SAMPLES], pi16Values);
+
+        bKey = (i % REC_KEY_INTERVAL) == 0;
+        ui8Mask = 0;
+        for (j = 0; j < REC_FIELDS; j++)
+        {
+            i16Delta = pi16Values[j] - pi16Prev[j];
+            if (!bKey && i16Delta != 0)
+            {
+                ui8Mask |= 1 << j;
+                bKey = (i16Delta > INT8_MAX || i16Delta < INT8_MIN);
+            }
+        }
+
+        if (bKey)
+        {
+            vWriteByte(&sWriter, REC_KEY);
+            for (j = 0; j < REC_FIELDS; j++)
+            {
+                vWriteByte(&sWriter, (uint16_t) pi16Values[j] & 0xFF);
+                vWriteByte(&sWriter, (uint16_t) pi16Values[j] >> 8);
+            }
+        }
+        else
+        {
+            vWriteByte(&sWriter, ui8Mask);
+            for (j = 0; j < REC_FIELDS; j++)
+            {
+                if (ui8Mask & (1 << j))
+                {
+                    vWriteByte(&sWriter, (int8_t) (pi16Values[j] - pi16Prev[j]));
+                }
+            }
+        }
+        memcpy(pi16Prev, pi16Values, sizeof(pi16Prev));
+    }
+
+    //
+    // Pad the last word. The padding is not covered by the data sum.
+    //
+    sHeader.ui16Bytes = sWriter.ui32Offset - ui32Start - sizeof(REC_HEADER) + sWriter.ui8Fill;
+    sHeader.ui32DataSum = sWriter.ui32Sum;
+    while (sWriter.ui8Fill != 0)
+    {
+        vWriteByte(&sWriter, 0xFF);
+    }
+
+    if (sWriter.bError)
+    {
+        return false;
+    }
+
+    sHeader.ui32Magic = REC_MAGIC;
+    sHeader.ui32Sequence = g_ui32Sequence + 1;
+    sHeader.ui16Samples = g_ui16Count;
+    sHeader.ui16Trigger = (g_ui16TriggerHead + g_ui16Count - g_ui16Head) % REC_RING_SAMPLES;
+    sHeader.ui8PeriodMs = REC_PERIOD_MS;
+    sHeader.ui8Reason = g_ui8Reason;
+    sHeader.ui32Checksum = ui32HeaderChecksum(&sHeader);
+
+    if (FlashProgram((uint32_t *) &sHeader, REC_FLASH_ADDR + ui32Start, sizeof(REC_HEADER)) != 0)
+    {
+        return false;
+    }
+
+    g_ui32Sequence = sHeader.ui32Sequence;
+    g_ui8NextSector = ((sWriter.ui32Offset + REC_SECTOR_BYTES - 1) / REC_SECTOR_BYTES) % REC_SECTORS;
+
+    return true;
+}
+
+//*****************************************************************************
+//
+// Timer callback that saves a frozen capture once the main rotor output has
+// ramped down to zero, then starts recording again. Runs in the FreeRTOS
+// timer task.
+//
+//*****************************************************************************
+static void
+vRecordFlushService (TimerHandle_t xTimer)
+{
+    uint16_t ui16Tail, ui16Main;
+
+    vGetRotorOutputs(&ui16Tail, &ui16Main);
+    if (g_eState != REC_FROZEN || ui16Main != 0)
+    {
+        return;
+    }
+
+    if (bSaveCapture())
+    {
+        g_ui32Saved++;
+    }
+    else
+    {
+        g_ui32Errors++;
+    }
+
+    g_ui16Head = 0;
+    g_ui16Count = 0;
+    g_eState = REC_RECORDING;
+}
+
+//*****************************************************************************
+//
+// Called by the controller task every control cycle. Records every
+// REC_DIVIDER cycles and triggers when the state machine enters FAULT.
+//
+//*****************************************************************************
+void
+vRecordSample(void)
+{
+    static uint8_t ui8Divide = 0;
+    REC_SAMPLE *psSample;
+    uint16_t ui16Tail, ui16Main;
+    uint8_t ui8State;
+
+    if (++ui8Divide < REC_DIVIDER || g_eState == REC_FROZEN)
+    {
+        return;
+    }
+    ui8Divide = 0;
+
+    ui8State = fsm_get_state();
+    fsm_get_duties(&ui16Tail, &ui16Main);
+
+    psSample = &g_psRing[g_ui16Head];
+    psSample->i16Yaw = GetYawAngle();
+    psSample->i16RefYaw = GetRefYaw();
+    psSample->ui8Height = GetHeight();
+    psSample->ui8RefHeight = GetRefHeight();
+    psSample->ui8State = ui8State;
+    psSample->ui8Tail = ui16Tail;
+    psSample->ui8Main = ui16Main;
+
+    //
+    // Trigger before moving on, so this sample is the trigger sample.
+    //
+    if (ui8State == FAULT && g_ui8PrevState != FAULT)
+    {
+        vRecordTrigger(REC_REASON_FAULT);
+    }
+    g_ui8PrevState = ui8State;
+
+    g_ui16Head = (g_ui16Head + 1) % REC_RING_SAMPLES;
+    if (g_ui16Count < REC_RING_SAMPLES)
+    {
+        g_ui16Count++;
+    }
+
+    taskENTER_CRITICAL();
+    if (g_eState == REC_TRIGGERED && ++g_ui16Post >= REC_POST_SAMPLES)
+    {
+        g_eState = REC_FROZEN;
+    }
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Triggers a capture. Ignored while one is already in progress. The trigger
+// sample, t=0 in the capture, is the one at the ring head: the next sample
+// for a trigger from the console, or the sample being stored for one from
+// vRecordSample. It is also the first of the REC_POST_SAMPLES.
+//
+//*****************************************************************************
+void
+vRecordTrigger(uint8_t ui8Reason)
+{
+    taskENTER_CRITICAL();
+    if (g_eState == REC_RECORDING)
+    {
+        g_eState = REC_TRIGGERED;
+        g_ui16Post = 0;
+        g_ui16TriggerHead = g_ui16Head;
+        g_ui8Reason = ui8Reason;
+    }
+    taskEXIT_CRITICAL();
+}
+
+//*****************************************************************************
+//
+// Returns the recorder status.
+//
+//*****************************************************************************
+void
+vRecordGetStatus(REC_STATUS *psStatus)
+{
+    psStatus->bTriggered = (g_eState == REC_TRIGGERED);
+    psStatus->bPending = (g_eState == REC_FROZEN);
+    psStatus->ui16Buffered = g_ui16Count;
+    psStatus->ui32Saved = g_ui32Saved;
+    psStatus->ui32Errors = g_ui32Errors;
+}
+
+//*****************************************************************************
+//
+// Lists up to ui32Max of the captures in flash, oldest first. Returns the
+// number found.
+//
+//*****************************************************************************
+uint32_t
+ui32RecordList(REC_CAPTURE *psCaptures, uint32_t ui32Max)
+{
+    REC_HEADER sHeader;
+    REC_CAPTURE psAll[REC_SECTORS];
+    REC_CAPTURE sCapture;
+    uint32_t ui32Found = 0;
+    uint32_t i, j;
+
+    //
+    // Insertion sort by sequence number. There is at most one capture per
+    // sector.
+    //
+    for (i = 0; i < REC_SECTORS; i++)
+    {
+        if (!bReadHeader(i, &sHeader))
+        {
+            continue;
+        }
+
+        vHeaderCapture(&sHeader, i, &sCapture);
+        for (j = ui32Found; j > 0 && psAll[j - 1].ui32Sequence > sCapture.ui32Sequence; j--)
+        {
+            psAll[j] = psAll[j - 1];
+        }
+        psAll[j] = sCapture;
+        ui32Found++;
+    }
+
+    //
+    // Keep the newest.
+    //
+    i = (ui32Found > ui32Max) ? ui32Found - ui32Max : 0;
+    memcpy(psCaptures, &psAll[i], (ui32Found - i) * sizeof(REC_CAPTURE));
+
+    return ui32Found - i;
+}
+
+//*****************************************************************************
+//
+// Opens the capture with the given sequence number for reading. Returns
+// false if it is not in flash.
+//
+//*****************************************************************************
+bool
+bRecordOpen(uint32_t ui32Sequence, REC_CAPTURE *psCapture, REC_READER *psReader)
+{
+    REC_HEADER sHeader;
+    uint8_t i;
+
+    for (i = 0; i < REC_SECTORS; i++)
+    {
+        if (bReadHeader(i, &sHeader) && sHeader.ui32Sequence == ui32Sequence)
+        {
+            vHeaderCapture(&sHeader, i, psCapture);
+
+            psReader->ui32Offset = i * REC_SECTOR_BYTES + sizeof(REC_HEADER);
+            psReader->ui32Left = sHeader.ui16Bytes;
+            psReader->ui16Index = 0;
+            psReader->ui16Samples = sHeader.ui16Samples;
+            memset(psReader->pi16Values, 0, sizeof(psReader->pi16Values));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//*****************************************************************************
+//
+// Decodes the next sample of an open capture. Returns false at the end, or
+// if the data is malformed.
+//
+//*****************************************************************************
+bool
+bRecordNext(REC_READER *psReader, REC_SAMPLE *psSample)
+{
+    int16_t *pi16Values = psReader->pi16Values;
+    uint8_t ui8Mask;
+    uint8_t ui8Need = 1;
+    uint8_t j;
+
+    if (psReader->ui16Index >= psReader->ui16Samples || psReader->ui32Left == 0)
+    {
+        return false;
+    }
+
+    ui8Mask = ui8ReadByte(psReader->ui32Offset);
+    if (ui8Mask == REC_KEY)
+    {
+        ui8Need += 2 * REC_FIELDS;
+    }
+    else
+    {
+        for (j = 0; j < REC_FIELDS; j++)
+        {
+            ui8Need += (ui8Mask >> j) & 1;
+        }
+    }
+    if (ui8Need > psReader->ui32Left)
+    {
+        return false;
+    }
+    psReader->ui32Offset++;
+
+    for (j = 0; j < REC_FIELDS; j++)
+    {
+        if (ui8Mask == REC_KEY)
+        {
+            pi16Values[j] = ui8ReadByte(psReader->ui32Offset) |
+                            (ui8ReadByte(psReader->ui32Offset + 1) << 8);
+            psReader->ui32Offset += 2;
+        }
+        else if (ui8Mask & (1 << j))
+        {
+            pi16Values[j] += (int8_t) ui8ReadByte(psReader->ui32Offset);
+            psReader->ui32Offset++;
+        }
+    }
+    psReader->ui32Left -= ui8Need;
+    psReader->ui16Index++;
+
+    psSample->i16Yaw = pi16Values[0];
+    psSample->i16RefYaw = pi16Values[1];
+    psSample->ui8Height = pi16Values[2];
+    psSample->ui8RefHeight = pi16Values[3];
+    psSample->ui8State = pi16Values[4];
+    psSample->ui8Tail = pi16Values[5];
+    psSample->ui8Main = pi16Values[6];
+
+    return true;
+}
+
+//*****************************************************************************
+//
+// Finds the newest capture in flash, so the next is written after it, and
+// starts the flush timer. Returns 0 on success, 1 on failure.
+//
+//*****************************************************************************
+uint32_t
+InitRecorder(void)
+{
+    REC_HEADER sHeader;
+    uint8_t i;
+
+    for (i = 0; i < REC_SECTORS; i++)
+    {
+        if (bReadHeader(i, &sHeader) && sHeader.ui32Sequence >= g_ui32Sequence)
+        {
+            g_ui32Sequence = sHeader.ui32Sequence;
+            g_ui8NextSector = (i + (sizeof(REC_HEADER) + sHeader.ui16Bytes + REC_SECTOR_BYTES - 1)
+                               / REC_SECTOR_BYTES) % REC_SECTORS;
+        }
+    }
+
+    xFlushTimer = xMemMapTimerCreate(MEMMAP_TIMER_RECORDER, pdMS_TO_TICKS(REC_FLUSH_PERIOD_MS),
+                                     pdTRUE, vRecordFlushService);
+    if(xFlushTimer == NULL || xTimerStart(xFlushTimer, 0) != pdPASS)
+    {
+        return(1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,105 @@
+/*
+ * File: recorder.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the flight data recorder. Samples are kept in
+ * RAM around a trigger and then saved to a circular region of flash, from
+ * which they can be read back sample by sample.
+ *
+ *
+ */
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+//*****************************************************************************
+//
+// Why a capture was triggered.
+//
+//*****************************************************************************
+#define REC_REASON_FAULT        1   // The state machine entered FAULT
+#define REC_REASON_CONSOLE      2   // Triggered from the console
+
+#define REC_FIELDS              7   // Fields in a sample
+
+//*****************************************************************************
+//
+// Struct for one recorded sample.
+//
+//*****************************************************************************
+typedef struct {
+    int16_t i16Yaw;
+    int16_t i16RefYaw;
+    uint8_t ui8Height;
+    uint8_t ui8RefHeight;
+    uint8_t ui8State;
+    uint8_t ui8Tail;
+    uint8_t ui8Main;
+} REC_SAMPLE;
+
+//*****************************************************************************
+//
+// Struct describing a capture saved in flash. Sample ui16Trigger was taken
+// when the trigger fired.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Sequence;
+    uint16_t ui16Samples;
+    uint16_t ui16Trigger;
+    uint16_t ui16Bytes;         // Encoded size
+    uint8_t ui8PeriodMs;
+    uint8_t ui8Reason;
+    uint8_t ui8Sector;          // First sector of the capture
+} REC_CAPTURE;
+
+//*****************************************************************************
+//
+// Struct for reading a capture back. Filled by bRecordOpen.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Offset;
+    uint32_t ui32Left;
+    uint16_t ui16Index;
+    uint16_t ui16Samples;
+    int16_t pi16Values[REC_FIELDS];
+} REC_READER;
+
+//*****************************************************************************
+//
+// Struct for the recorder status.
+//
+//*****************************************************************************
+typedef struct {
+    bool bTriggered;            // Recording the window after a trigger
+    bool bPending;              // Waiting for the rotors to stop to be saved
+    uint16_t ui16Buffered;      // Samples in RAM
+    uint32_t ui32Saved;         // Captures saved since power up
+    uint32_t ui32Errors;        // Captures lost to flash errors
+} REC_STATUS;
+
+//*****************************************************************************
+//
+// Prototypes for the recorder module.
+//
+//*****************************************************************************
+void vRecordSample(void);
+void vRecordTrigger(uint8_t);
+void vRecordGetStatus(REC_STATUS *);
+uint32_t ui32RecordList(REC_CAPTURE *, uint32_t);
+bool bRecordOpen(uint32_t, REC_CAPTURE *, REC_READER *);
+bool bRecordNext(REC_READER *, REC_SAMPLE *);
+uint32_t InitRecorder(void);
+
+#endif /* RECORDER_H_ */
@@ -0,0 +1,99 @@
+/*
+ * File: refqueue.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Queues that pass pool blocks by reference. The send and
+ * receive calls block exactly as xQueueSend() and xQueueReceive() do; only
+ * the pointer goes through the queue storage.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#include "refqueue.h"
+
+//*****************************************************************************
+//
+// Pairs a queue with the pool its messages come from. The queue must have
+// been created with an item size of sizeof(void *).
+//
+//*****************************************************************************
+void
+vRefQueueInit (REFQUEUE *psQueue, QueueHandle_t xQueue, MEMPOOL *psPool)
+{
+    psQueue->xQueue = xQueue;
+    psQueue->psPool = psPool;
+}
+
+//*****************************************************************************
+//
+// Takes an empty message from the pool. Returns NULL if none are free. The
+// caller owns the message until it is sent or released.
+//
+//*****************************************************************************
+void *
+pvRefQueueAlloc (REFQUEUE *psQueue)
+{
+    return pvMemPoolAlloc(psQueue->psPool);
+}
+
+//*****************************************************************************
+//
+// Sends a message, passing ownership to the receiver. If the queue stays
+// full for xTicksToWait the send fails and the caller still owns the message.
+//
+//*****************************************************************************
+BaseType_t
+xRefQueueSend (REFQUEUE *psQueue, void *pvMessage, TickType_t xTicksToWait)
+{
+    return xQueueSend(psQueue->xQueue, &pvMessage, xTicksToWait);
+}
+
+//*****************************************************************************
+//
+// Sends a message from an interrupt. Never blocks.
+//
+//*****************************************************************************
+BaseType_t
+xRefQueueSendFromISR (REFQUEUE *psQueue, void *pvMessage, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    return xQueueSendFromISR(psQueue->xQueue, &pvMessage, pxHigherPriorityTaskWoken);
+}
+
+//*****************************************************************************
+//
+// Waits for a message. On success the caller owns *ppvMessage and must
+// release it.
+//
+//*****************************************************************************
+BaseType_t
+xRefQueueReceive (REFQUEUE *psQueue, void **ppvMessage, TickType_t xTicksToWait)
+{
+    return xQueueReceive(psQueue->xQueue, ppvMessage, xTicksToWait);
+}
+
+//*****************************************************************************
+//
+// Returns a message to the pool.
+//
+//*****************************************************************************
+void
+vRefQueueRelease (REFQUEUE *psQueue, void *pvMessage)
+{
+    vMemPoolFree(psQueue->psPool, pvMessage);
+}
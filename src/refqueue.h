@@ -0,0 +1,50 @@
+/*
+ * File: refqueue.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Queues that pass messages by reference. A message is a block
+ * from a memory pool; sending it moves ownership to whichever task receives
+ * it, which must release it back to the pool once done. Only the pointer is
+ * copied through the FreeRTOS queue, whatever the size of the message.
+ *
+ *
+ */
+
+#ifndef REFQUEUE_H_
+#define REFQUEUE_H_
+
+#include "mempool.h"
+
+//*****************************************************************************
+//
+// A queue of pointers paired with the pool its messages come from.
+//
+//*****************************************************************************
+typedef struct {
+    QueueHandle_t   xQueue;
+    MEMPOOL         *psPool;
+} REFQUEUE;
+
+//*****************************************************************************
+//
+// Prototypes for the refqueue module.
+//
+//*****************************************************************************
+void vRefQueueInit (REFQUEUE *psQueue, QueueHandle_t xQueue, MEMPOOL *psPool);
+void *pvRefQueueAlloc (REFQUEUE *psQueue);
+BaseType_t xRefQueueSend (REFQUEUE *psQueue, void *pvMessage, TickType_t xTicksToWait);
+BaseType_t xRefQueueSendFromISR (REFQUEUE *psQueue, void *pvMessage, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xRefQueueReceive (REFQUEUE *psQueue, void **ppvMessage, TickType_t xTicksToWait);
+void vRefQueueRelease (REFQUEUE *psQueue, void *pvMessage);
+
+#endif /* REFQUEUE_H_ */
@@ -14,7 +14,12 @@
  *
  * Description: This module initialises the PWM peripherals for the main
  * and tail rotor. It takes a duty cycle from the controller to set the
- * tail rotor.
+ * tail rotor. Duty cycles are in per-mille. The PWM period is computed once
+ * at start up and the generators use global synchronous updates, so a new
+ * pulse width is only applied at the end of a PWM period and the tail and
+ * main are committed together. Each rotor ramps towards its commanded duty
+ * at a limited slew rate, stepped once per PWM period, so state changes do
+ * not reach the motors as steps.
  *
  * Note: The prototypes: vSetTailPWM, vSetMainPWM, vInitTailPWM, vInitMainPWM
  * have been adapted from pwmGen.c created by P.J.Bones 20.3.2017.
@@ -38,23 +43,9 @@
 #include "semphr.h"
 
 #include "rotor.h"
+#include "memmap.h"
 #include "priorities.h"
 
-//*****************************************************************************
-//
-// The stack size for the rotor task.
-//
-//*****************************************************************************
-#define ROTORTASKSTACKSIZE        128         // Stack size in words
-
-//*****************************************************************************
-//
-// The queue length and size for the rotor task.
-//
-//*****************************************************************************
-#define ROTOR_QUEUE_SIZE          10
-#define ROTOR_ITEM_SIZE           sizeof(MOTOR_OUTPUT)
-
 //*****************************************************************************
 //
 // PWM Configuration Details.
@@ -64,13 +55,23 @@
 #define PWM_RATE_STEP_HZ   50
 #define PWM_RATE_MIN_HZ    50
 #define PWM_RATE_MAX_HZ    400
-#define PWM_FIXED_PC       10
+#define PWM_FIXED_PERMILLE 100
 #define PWM_DIVIDER_CODE  SYSCTL_PWMDIV_4
 #define PWM_DIVIDER  4
 
+//*****************************************************************************
+//
+// Slew rate limits. The outputs are stepped once per PWM period.
+//
+//*****************************************************************************
+#define ROTOR_STEP_MS           (1000 / PWM_START_RATE_HZ)
+#define ROTOR_TAIL_SLEW         1000        // Per-mille per second
+#define ROTOR_MAIN_SLEW         500         // Per-mille per second
+
 //---Tail Rotor PWM: M1PWM5,PF1
 #define PWM_TAIL_BASE        PWM1_BASE
 #define PWM_TAIL_GEN         PWM_GEN_2
+#define PWM_TAIL_GENBIT      PWM_GEN_2_BIT
 #define PWM_TAIL_OUTNUM      PWM_OUT_5
 #define PWM_TAIL_OUTBIT      PWM_OUT_5_BIT
 #define PWM_TAIL_PERIPH_PWM   SYSCTL_PERIPH_PWM1
@@ -82,6 +83,7 @@
 //---Main Rotor PWM: M0PWM7,PC5, J4-05
 #define PWM_MAIN_BASE        PWM0_BASE
 #define PWM_MAIN_GEN         PWM_GEN_3
+#define PWM_MAIN_GENBIT      PWM_GEN_3_BIT
 #define PWM_MAIN_OUTNUM      PWM_OUT_7
 #define PWM_MAIN_OUTBIT      PWM_OUT_7_BIT
 #define PWM_MAIN_PERIPH_PWM   SYSCTL_PERIPH_PWM0
@@ -90,47 +92,111 @@
 #define PWM_MAIN_GPIO_CONFIG GPIO_PC5_M0PWM7
 #define PWM_MAIN_GPIO_PIN    GPIO_PIN_5
 
+//*****************************************************************************
+//
+// PWM period in PWM clocks, set once by InitRotorTask, and the pulse widths
+// last written to each generator.
+//
+//*****************************************************************************
+static uint32_t g_ui32PWMPeriod;
+static uint32_t g_ui32TailWidth = 0;
+static uint32_t g_ui32MainWidth = 0;
+
+//*****************************************************************************
+//
+// Slew limiter state, in per-mille. The steps are the largest change per
+// PWM period.
+//
+//*****************************************************************************
+static uint16_t g_ui16TailStep;
+static uint16_t g_ui16MainStep;
+static volatile uint16_t g_ui16TailOut = PWM_FIXED_PERMILLE;
+static volatile uint16_t g_ui16MainOut = PWM_FIXED_PERMILLE;
+
 //*****************************************************************************
 //
 // Local prototypes for the Rotor task.
 //
 //*****************************************************************************
-void vSetTailPWM (uint32_t ui32Freq, uint32_t ui32Duty);
-void vSetMainPWM (uint32_t ui32Freq, uint32_t ui32Duty);
+static uint32_t ui32PulseWidth (uint32_t ui32Permille);
+static uint16_t ui16Slew (uint16_t ui16Out, uint16_t ui16Target, uint32_t ui32MaxStep);
+bool bSetTailPWM (uint32_t ui32Permille);
+bool bSetMainPWM (uint32_t ui32Permille);
 void vInitTailPWM (void);
 void vInitMainPWM (void);
 static void RotorTask (void *pvParameters);
 
 //*****************************************************************************
 //
-// Sets the PWM of the tail rotor with a specified frequency and duty cycle.
+// Converts a per-mille duty cycle to a pulse width in PWM clocks.
 //
 //*****************************************************************************
-void
-vSetTailPWM (uint32_t ui32Freq, uint32_t ui32Duty)
+static uint32_t
+ui32PulseWidth (uint32_t ui32Permille)
 {
-    // Calculate the PWM period corresponding to the freq.
-    uint32_t ui32Period = SysCtlClockGet() / PWM_DIVIDER / ui32Freq;
+    if (ui32Permille > 1000)
+    {
+        ui32Permille = 1000;
+    }
+    return g_ui32PWMPeriod * ui32Permille / 1000;
+}
 
-    PWMGenPeriodSet(PWM_TAIL_BASE, PWM_TAIL_GEN, ui32Period);
-    PWMPulseWidthSet(PWM_TAIL_BASE, PWM_TAIL_OUTNUM,
-        ui32Period * ui32Duty / 100);
+//*****************************************************************************
+//
+// Moves an output towards its target by no more than ui32MaxStep.
+//
+//*****************************************************************************
+static uint16_t
+ui16Slew (uint16_t ui16Out, uint16_t ui16Target, uint32_t ui32MaxStep)
+{
+    if (ui16Target > ui16Out)
+    {
+        return (ui16Target - ui16Out > ui32MaxStep) ? ui16Out + ui32MaxStep : ui16Target;
+    }
+    else
+    {
+        return (ui16Out - ui16Target > ui32MaxStep) ? ui16Out - ui32MaxStep : ui16Target;
+    }
 }
 
 //*****************************************************************************
 //
-// Sets the PWM of the main rotor with a specified frequency and duty cycle.
+// Sets the duty cycle of the tail rotor in per-mille. The pulse width is only
+// written if it has changed, and takes effect at the next PWMSyncUpdate.
+// Returns true if it was written.
 //
 //*****************************************************************************
-void
-vSetMainPWM (uint32_t ui32Freq, uint32_t ui32Duty)
+bool
+bSetTailPWM (uint32_t ui32Permille)
 {
-    // Calculate the PWM period corresponding to the freq.
-    uint32_t ui32Period = SysCtlClockGet() / PWM_DIVIDER / ui32Freq;
+    uint32_t ui32Width = ui32PulseWidth(ui32Permille);
 
-    PWMGenPeriodSet(PWM_MAIN_BASE, PWM_MAIN_GEN, ui32Period);
-    PWMPulseWidthSet(PWM_MAIN_BASE, PWM_MAIN_OUTNUM,
-        ui32Period * ui32Duty / 100);
+    if (ui32Width == g_ui32TailWidth)
+    {
+        return false;
+    }
+    g_ui32TailWidth = ui32Width;
+    PWMPulseWidthSet(PWM_TAIL_BASE, PWM_TAIL_OUTNUM, ui32Width);
+    return true;
+}
+
+//*****************************************************************************
+//
+// Sets the duty cycle of the main rotor in per-mille. As bSetTailPWM.
+//
+//*****************************************************************************
+bool
+bSetMainPWM (uint32_t ui32Permille)
+{
+    uint32_t ui32Width = ui32PulseWidth(ui32Permille);
+
+    if (ui32Width == g_ui32MainWidth)
+    {
+        return false;
+    }
+    g_ui32MainWidth = ui32Width;
+    PWMPulseWidthSet(PWM_MAIN_BASE, PWM_MAIN_OUTNUM, ui32Width);
+    return true;
 }
 
 
@@ -148,11 +214,14 @@ vInitMainPWM (void)
     GPIOPinConfigure(PWM_MAIN_GPIO_CONFIG);
     GPIOPinTypePWM(PWM_MAIN_GPIO_BASE, PWM_MAIN_GPIO_PIN);
 
+    // Period and pulse width writes are held until PWMSyncUpdate.
     PWMGenConfigure(PWM_MAIN_BASE, PWM_MAIN_GEN,
-                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
+                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_SYNC | PWM_GEN_MODE_GEN_SYNC_GLOBAL);
 
     // Set the initial PWM parameters
-    vSetMainPWM (PWM_START_RATE_HZ, PWM_FIXED_PC);
+    PWMGenPeriodSet(PWM_MAIN_BASE, PWM_MAIN_GEN, g_ui32PWMPeriod);
+    bSetMainPWM (PWM_FIXED_PERMILLE);
+    PWMSyncUpdate(PWM_MAIN_BASE, PWM_MAIN_GENBIT);
 
     PWMGenEnable(PWM_MAIN_BASE, PWM_MAIN_GEN);
 
@@ -177,11 +246,14 @@ vInitTailPWM (void)
     GPIOPinConfigure(PWM_TAIL_GPIO_CONFIG);
     GPIOPinTypePWM(PWM_TAIL_GPIO_BASE, PWM_TAIL_GPIO_PIN);
 
+    // Period and pulse width writes are held until PWMSyncUpdate.
     PWMGenConfigure(PWM_TAIL_BASE, PWM_TAIL_GEN,
-                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
+                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_SYNC | PWM_GEN_MODE_GEN_SYNC_GLOBAL);
 
     // Set the initial PWM parameters
-    vSetTailPWM (PWM_START_RATE_HZ, PWM_FIXED_PC);
+    PWMGenPeriodSet(PWM_TAIL_BASE, PWM_TAIL_GEN, g_ui32PWMPeriod);
+    bSetTailPWM (PWM_FIXED_PERMILLE);
+    PWMSyncUpdate(PWM_TAIL_BASE, PWM_TAIL_GENBIT);
 
     PWMGenEnable(PWM_TAIL_BASE, PWM_TAIL_GEN);
 
@@ -191,28 +263,111 @@ vInitTailPWM (void)
 
 //*****************************************************************************
 //
-// Gets the updated duty cycle for the tail rotor from the controller.
+// Gets the updated duty cycle for the tail rotor from the controller and
+// ramps the outputs towards it. The task only wakes each PWM period while an
+// output is still ramping.
 //
 //*****************************************************************************
 static void
 RotorTask (void *pvParameters)
 {
-    MOTOR_OUTPUT DutyStruct;
-    DutyStruct.mainDuty = 90;
+    MOTOR_OUTPUT DutyStruct = { 0, 0 };
+    TickType_t xLastStep = xTaskGetTickCount();
+    TickType_t xWait;
+    TickType_t xNow;
+    uint32_t ui32Steps;
+    bool bRamping = false;
+    bool bTail, bMain;
 
     while (1)
     {
-        if(xQueueReceive(g_pRotorQueue, &(DutyStruct), 0) == pdPASS) // Receive the tail rotor duty cycle and check it was successful.
+        xWait = bRamping ? (ROTOR_STEP_MS / portTICK_PERIOD_MS) : portMAX_DELAY;
+
+        if(xQueueReceive(g_pRotorQueue, &(DutyStruct), xWait) == pdPASS && !bRamping) // Receive the tail rotor duty cycle and check it was successful.
         {
-            vSetTailPWM (PWM_START_RATE_HZ, DutyStruct.tailDuty);
-            vSetMainPWM (PWM_START_RATE_HZ, DutyStruct.mainDuty);
+            //
+            // Start a new ramp straight away.
+            //
+            xLastStep = xTaskGetTickCount() - ROTOR_STEP_MS / portTICK_PERIOD_MS;
+        }
+
+        //
+        // Step once for each PWM period since the last step.
+        //
+        xNow = xTaskGetTickCount();
+        ui32Steps = (xNow - xLastStep) / (ROTOR_STEP_MS / portTICK_PERIOD_MS);
+        if (ui32Steps == 0)
+        {
+            continue;
+        }
+        xLastStep += ui32Steps * (ROTOR_STEP_MS / portTICK_PERIOD_MS);
+
+        g_ui16TailOut = ui16Slew(g_ui16TailOut, DutyStruct.tailDuty, ui32Steps * g_ui16TailStep);
+        g_ui16MainOut = ui16Slew(g_ui16MainOut, DutyStruct.mainDuty, ui32Steps * g_ui16MainStep);
+        bRamping = (g_ui16TailOut != DutyStruct.tailDuty || g_ui16MainOut != DutyStruct.mainDuty);
+
+        bTail = bSetTailPWM (g_ui16TailOut);
+        bMain = bSetMainPWM (g_ui16MainOut);
+
+        //
+        // Commit both generators back to back. The rotors are on separate
+        // PWM modules, so each changes at the end of its current period.
+        //
+        if (bTail)
+        {
+            PWMSyncUpdate(PWM_TAIL_BASE, PWM_TAIL_GENBIT);
+        }
+        if (bMain)
+        {
+            PWMSyncUpdate(PWM_MAIN_BASE, PWM_MAIN_GENBIT);
         }
     }
 }
 
 //*****************************************************************************
 //
-// Sends the PWM of the rotor from a received duty cycle.
+// Sets the slew rate limits in per-mille per second. Rates below one step
+// per PWM period are rounded up.
+//
+//*****************************************************************************
+void
+vSetRotorSlew(uint16_t tailRate, uint16_t mainRate)
+{
+    uint16_t ui16TailStep = tailRate * ROTOR_STEP_MS / 1000;
+    uint16_t ui16MainStep = mainRate * ROTOR_STEP_MS / 1000;
+
+    g_ui16TailStep = (ui16TailStep > 0) ? ui16TailStep : 1;
+    g_ui16MainStep = (ui16MainStep > 0) ? ui16MainStep : 1;
+}
+
+//*****************************************************************************
+//
+// Returns the slew rate limits in per-mille per second.
+//
+//*****************************************************************************
+void
+vGetRotorSlew(uint16_t *tailRate, uint16_t *mainRate)
+{
+    *tailRate = g_ui16TailStep * 1000 / ROTOR_STEP_MS;
+    *mainRate = g_ui16MainStep * 1000 / ROTOR_STEP_MS;
+}
+
+//*****************************************************************************
+//
+// Returns the duty cycles being output to the rotors, in per-mille. These lag
+// the commanded duties while ramping.
+//
+//*****************************************************************************
+void
+vGetRotorOutputs(uint16_t *tailDuty, uint16_t *mainDuty)
+{
+    *tailDuty = g_ui16TailOut;
+    *mainDuty = g_ui16MainOut;
+}
+
+//*****************************************************************************
+//
+// Sends the duty cycles of the rotors, in per-mille, to the rotor task.
 //
 //*****************************************************************************
 void
@@ -245,10 +400,18 @@ vSetMotorOutputs(uint16_t tailDuty, uint16_t mainDuty)
 uint32_t
 InitRotorTask (void)
 {
+    //
+    // The PWM clock is the system clock divided by PWM_DIVIDER. The period is
+    // fixed, so it is only calculated here.
+    //
+    SysCtlPWMClockSet(PWM_DIVIDER_CODE);
+    g_ui32PWMPeriod = SysCtlClockGet() / PWM_DIVIDER / PWM_START_RATE_HZ;
+    vSetRotorSlew(ROTOR_TAIL_SLEW, ROTOR_MAIN_SLEW);
+
     vInitMainPWM (); // Initialise the main rotor PWM peripheral.
     vInitTailPWM (); // Initialise the tail rotor PWM peripheral.
 
-    g_pRotorQueue = xQueueCreate(ROTOR_QUEUE_SIZE, ROTOR_ITEM_SIZE); // Create a queue to hold the duty cycle.
+    g_pRotorQueue = xMemMapQueueCreate(MEMMAP_QUEUE_ROTOR); // Create a queue to hold the duty cycle.
 
     // Initialisation is complete, so turn on the output.
     PWMOutputState(PWM_MAIN_BASE, PWM_MAIN_OUTBIT, true);
@@ -257,8 +420,8 @@ InitRotorTask (void)
     //
     // Create the rotor task to set the desired PWM.
     //
-    if(xTaskCreate(RotorTask, (const portCHAR *)"Rotor",
-                       ROTORTASKSTACKSIZE, NULL,  tskIDLE_PRIORITY + ROTORTASKPRIORITY, NULL) != pdTRUE)
+    if(xMemMapTaskCreate(MEMMAP_TASK_ROTOR, RotorTask, NULL,
+                       tskIDLE_PRIORITY + ROTORTASKPRIORITY, NULL) != pdTRUE)
     {
         return(1);
     }
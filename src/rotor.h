@@ -25,7 +25,14 @@
 
 //*****************************************************************************
 //
-// Struct to hold the rotor duty.
+// Converts a duty cycle in percent to per-mille.
+//
+//*****************************************************************************
+#define ROTOR_PERMILLE(pc)      ((pc) * 10)
+
+//*****************************************************************************
+//
+// Struct to hold the rotor duty cycles in per-mille.
 //
 //*****************************************************************************
 typedef struct {
@@ -40,6 +47,9 @@ typedef struct {
 //*****************************************************************************
 uint32_t InitRotorTask (void);
 void vSetMotorOutputs (uint16_t, uint16_t);
+void vSetRotorSlew (uint16_t, uint16_t);
+void vGetRotorSlew (uint16_t *, uint16_t *);
+void vGetRotorOutputs (uint16_t *, uint16_t *);
 
 //*****************************************************************************
 //
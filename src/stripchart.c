@@ -0,0 +1,285 @@
+/*
+ * File: stripchart.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module keeps a fixed-size circular history of the yaw
+ * error and tail duty from the controller and draws it as a scrolling strip
+ * chart on the left of the OLED. The latest values are printed on the right.
+ *
+ * The chart is drawn into its own buffer used as a circular set of columns.
+ * Each new sample overwrites only the oldest column, one byte per page, and
+ * the buffer is rotated into the frame buffer once per rendered frame rather
+ * than being scrolled for every sample.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "utils/ustdlib.h"
+
+#include "OrbitOLED/OrbitOLEDInterface.h"
+#include "OrbitOLED/lib_OrbitOled/OrbitOled.h"
+
+#include "stripchart.h"
+
+//*****************************************************************************
+//
+// Chart configuration.
+//
+//*****************************************************************************
+#define CHART_HISTORY           128         // Samples kept; a power of two
+#define CHART_ERROR_SCALE       2           // Degrees of error per pixel
+#define CHART_ZERO_Y            (crowOledMax / 2)
+#define CHART_AXIS_SPACING      4           // Samples between zero line dots
+#define CHART_READOUT_COLUMN    (STRIPCHART_WIDTH / 8)
+
+//*****************************************************************************
+//
+// The OrbitOLED frame buffer, defined in OrbitOled.c.
+//
+//*****************************************************************************
+extern char rgbOledBmp[];
+
+//*****************************************************************************
+//
+// Struct holding one chart sample.
+//
+//*****************************************************************************
+typedef struct {
+    int16_t     i16Error;
+    uint16_t    ui16Duty;
+} CHART_SAMPLE;
+
+//*****************************************************************************
+//
+// Circular sample history. Written by the controller and read by the display
+// task. Each index is only written by one side.
+//
+//*****************************************************************************
+static CHART_SAMPLE g_psHistory[CHART_HISTORY];
+static volatile uint32_t g_ui32Written = 0;     // Total samples added
+static uint32_t g_ui32Drawn = 0;                // Total samples drawn
+
+//*****************************************************************************
+//
+// The chart columns, laid out in pages like the frame buffer. Column
+// g_ui32Column is the oldest on screen and the next to be overwritten.
+//
+//*****************************************************************************
+static uint8_t g_ppui8Chart[cpagOledMax][STRIPCHART_WIDTH];
+static uint32_t g_ui32Column = 0;
+
+//*****************************************************************************
+//
+// Local prototypes for the stripchart module.
+//
+//*****************************************************************************
+static void vSetPixel (uint32_t, uint32_t);
+static void vDrawColumn (uint32_t, uint32_t);
+static void vCopyChart (void);
+static void vDrawReadouts (uint32_t);
+
+//*****************************************************************************
+//
+// Records a new sample. Called by the controller at each control update.
+//
+//*****************************************************************************
+void
+vStripChartAddSample (int16_t i16Error, uint16_t ui16Duty)
+{
+    uint32_t ui32Index = g_ui32Written % CHART_HISTORY;
+
+    g_psHistory[ui32Index].i16Error = i16Error;
+    g_psHistory[ui32Index].ui16Duty = ui16Duty;
+    g_ui32Written++;
+}
+
+//*****************************************************************************
+//
+// Sets a pixel in a column of the chart buffer.
+//
+//*****************************************************************************
+static void
+vSetPixel (uint32_t ui32X, uint32_t ui32Y)
+{
+    g_ppui8Chart[ui32Y / 8][ui32X] |= 1 << (ui32Y & 0x07);
+}
+
+//*****************************************************************************
+//
+// Copies the chart buffer into the frame buffer, oldest column on the left.
+// Two copies per page, whatever the number of samples drawn since the last
+// frame.
+//
+//*****************************************************************************
+static void
+vCopyChart (void)
+{
+    char *pcPage;
+    uint32_t ui32Page;
+    uint32_t ui32Left = STRIPCHART_WIDTH - g_ui32Column;
+
+    for (ui32Page = 0; ui32Page < cpagOledMax; ui32Page++)
+    {
+        pcPage = &rgbOledBmp[ui32Page * ccolOledMax];
+        memcpy(pcPage, &g_ppui8Chart[ui32Page][g_ui32Column], ui32Left);
+        memcpy(pcPage + ui32Left, &g_ppui8Chart[ui32Page][0], g_ui32Column);
+    }
+}
+
+//*****************************************************************************
+//
+// Clears a column of the chart buffer and draws the given sample into it.
+// Costs one byte per page plus the plotted pixels.
+//
+//*****************************************************************************
+static void
+vDrawColumn (uint32_t ui32X, uint32_t ui32Sample)
+{
+    const CHART_SAMPLE *psSample = &g_psHistory[ui32Sample % CHART_HISTORY];
+    int32_t i32ErrorY;
+    int32_t i32DutyY;
+    uint32_t ui32Page;
+
+    for (ui32Page = 0; ui32Page < cpagOledMax; ui32Page++)
+    {
+        g_ppui8Chart[ui32Page][ui32X] = 0;
+    }
+
+    //
+    // Dotted zero error line.
+    //
+    if ((ui32Sample % CHART_AXIS_SPACING) == 0)
+    {
+        vSetPixel(ui32X, CHART_ZERO_Y);
+    }
+
+    //
+    // Error is plotted about the centre line, positive upwards. Duty is
+    // plotted from the bottom of the display.
+    //
+    i32ErrorY = CHART_ZERO_Y - psSample->i16Error / CHART_ERROR_SCALE;
+    if (i32ErrorY < 0)
+    {
+        i32ErrorY = 0;
+    }
+    else if (i32ErrorY >= crowOledMax)
+    {
+        i32ErrorY = crowOledMax - 1;
+    }
+
+    i32DutyY = (crowOledMax - 1) - (psSample->ui16Duty * (crowOledMax - 1)) / 100;
+    if (i32DutyY < 0)
+    {
+        i32DutyY = 0;
+    }
+
+    vSetPixel(ui32X, i32ErrorY);
+    vSetPixel(ui32X, i32DutyY);
+}
+
+//*****************************************************************************
+//
+// Prints the values of the given sample beside the chart.
+//
+//*****************************************************************************
+static void
+vDrawReadouts (uint32_t ui32Sample)
+{
+    const CHART_SAMPLE *psSample = &g_psHistory[ui32Sample % CHART_HISTORY];
+    char pcString[5];
+
+    usnprintf(pcString, sizeof(pcString), "%4d", psSample->i16Error);
+    OLEDStringDraw(pcString, CHART_READOUT_COLUMN, 1);
+    usnprintf(pcString, sizeof(pcString), "%4d", psSample->ui16Duty);
+    OLEDStringDraw(pcString, CHART_READOUT_COLUMN, 3);
+}
+
+//*****************************************************************************
+//
+// Draws the whole chart from the history. Used when the view is first shown.
+//
+//*****************************************************************************
+void
+vStripChartDrawBackground (void)
+{
+    uint32_t ui32Written = g_ui32Written;
+    uint32_t ui32Count = ui32Written;
+    uint32_t ui32X;
+
+    OLEDStringDraw("ERR", CHART_READOUT_COLUMN, 0);
+    OLEDStringDraw("DTY", CHART_READOUT_COLUMN, 2);
+
+    if (ui32Count > STRIPCHART_WIDTH)
+    {
+        ui32Count = STRIPCHART_WIDTH;
+    }
+
+    memset(g_ppui8Chart, 0, sizeof(g_ppui8Chart));
+    g_ui32Column = 0;
+
+    for (ui32X = 0; ui32X < ui32Count; ui32X++)
+    {
+        vDrawColumn(STRIPCHART_WIDTH - ui32Count + ui32X, ui32Written - ui32Count + ui32X);
+    }
+
+    vCopyChart();
+
+    if (ui32Written > 0)
+    {
+        vDrawReadouts(ui32Written - 1);
+    }
+
+    g_ui32Drawn = ui32Written;
+}
+
+//*****************************************************************************
+//
+// Draws any samples added since the last update over the oldest columns, then
+// copies the chart into the frame buffer. Returns true if the frame buffer
+// was modified.
+//
+//*****************************************************************************
+bool
+bStripChartUpdate (void)
+{
+    uint32_t ui32Written = g_ui32Written;
+
+    if (ui32Written == g_ui32Drawn)
+    {
+        return false;
+    }
+
+    //
+    // If the display fell behind by more than the history, skip to the
+    // oldest sample still held.
+    //
+    if (ui32Written - g_ui32Drawn > CHART_HISTORY)
+    {
+        g_ui32Drawn = ui32Written - CHART_HISTORY;
+    }
+
+    while (g_ui32Drawn != ui32Written)
+    {
+        vDrawColumn(g_ui32Column, g_ui32Drawn);
+        g_ui32Column = (g_ui32Column + 1) % STRIPCHART_WIDTH;
+        g_ui32Drawn++;
+    }
+
+    vCopyChart();
+    vDrawReadouts(ui32Written - 1);
+
+    return true;
+}
@@ -0,0 +1,40 @@
+/*
+ * File: stripchart.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the stripchart module. Contains prototypes to
+ * record yaw error and tail duty samples and draw them as a scrolling chart.
+ *
+ *
+ */
+
+#ifndef STRIPCHART_H_
+#define STRIPCHART_H_
+
+//*****************************************************************************
+//
+// Column of the frame buffer where the chart ends and the readouts begin.
+//
+//*****************************************************************************
+#define STRIPCHART_WIDTH        96
+
+//*****************************************************************************
+//
+// Prototypes for the stripchart module.
+//
+//*****************************************************************************
+void vStripChartAddSample (int16_t, uint16_t);
+void vStripChartDrawBackground (void);
+bool bStripChartUpdate (void);
+
+#endif /* STRIPCHART_H_ */
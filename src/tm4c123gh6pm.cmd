@@ -10,7 +10,11 @@
 
 MEMORY
 {
-    FLASH (RX) : origin = 0x00000000, length = 0x00040000
+    FLASH (RX) : origin = 0x00000000, length = 0x0003BC00
+    /* 16 KB of 1 KB erase blocks hold the flight recorder, see recorder.c. */
+    RECORDER (R) : origin = 0x0003BC00, length = 0x00004000
+    /* Last 1 KB erase block holds the gain schedule, see gsched.c. */
+    PARAMS (R) : origin = 0x0003FC00, length = 0x00000400
     SRAM (RWX) : origin = 0x20000000, length = 0x00008000
 }
 
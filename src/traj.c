@@ -0,0 +1,246 @@
+/*
+ * File: traj.c
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: This module generates rate and acceleration limited setpoints.
+ * It is stepped once per control tick. Each step it accelerates towards the
+ * reference and brakes once the remaining distance is within the stopping
+ * distance, giving a trapezoidal velocity profile. Angles are wrapped so the
+ * setpoint always takes the short way round.
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "traj.h"
+
+//*****************************************************************************
+//
+// Local prototypes for the trajectory module.
+//
+//*****************************************************************************
+static int32_t i32Wrap (const TRAJ *psTraj, int32_t i32Value);
+static int32_t i32Abs (int32_t i32Value);
+static int32_t i32Sqrt (int32_t i32Value);
+
+static int32_t
+i32Abs (int32_t i32Value)
+{
+    return (i32Value < 0) ? -i32Value : i32Value;
+}
+
+//*****************************************************************************
+//
+// Integer square root, rounded down.
+//
+//*****************************************************************************
+static int32_t
+i32Sqrt (int32_t i32Value)
+{
+    uint32_t ui32Root = 0;
+    uint32_t ui32Bit = 1UL << 30;
+    uint32_t ui32Rem = (uint32_t) i32Value;
+
+    while (ui32Bit > ui32Rem)
+    {
+        ui32Bit >>= 2;
+    }
+    while (ui32Bit != 0)
+    {
+        if (ui32Rem >= ui32Root + ui32Bit)
+        {
+            ui32Rem -= ui32Root + ui32Bit;
+            ui32Root = (ui32Root >> 1) + ui32Bit;
+        }
+        else
+        {
+            ui32Root >>= 1;
+        }
+        ui32Bit >>= 2;
+    }
+    return (int32_t) ui32Root;
+}
+
+//*****************************************************************************
+//
+// Wraps a Q8 position into 0 to the modulus. Values are never more than one
+// modulus out of range.
+//
+//*****************************************************************************
+static int32_t
+i32Wrap (const TRAJ *psTraj, int32_t i32Value)
+{
+    if (psTraj->i32Wrap != 0)
+    {
+        if (i32Value >= psTraj->i32Wrap)
+        {
+            i32Value -= psTraj->i32Wrap;
+        }
+        else if (i32Value < 0)
+        {
+            i32Value += psTraj->i32Wrap;
+        }
+    }
+    return i32Value;
+}
+
+//*****************************************************************************
+//
+// Initialises a trajectory. The rate is in units per second and the
+// acceleration in units per second squared. ui16Wrap is the modulus for
+// angles, or 0. The trajectory starts disabled at zero.
+//
+//*****************************************************************************
+void
+vTrajInit (TRAJ *psTraj, uint16_t ui16Rate, uint16_t ui16Accel,
+           uint16_t ui16Wrap, uint16_t ui16TickMs)
+{
+    psTraj->i32VelMax = ((int32_t) ui16Rate << TRAJ_Q) * ui16TickMs / 1000;
+    psTraj->i32AccelMax = ((int32_t) ui16Accel << TRAJ_Q) * ui16TickMs * ui16TickMs / 1000000;
+    if (psTraj->i32VelMax < 1)
+    {
+        psTraj->i32VelMax = 1;
+    }
+    if (psTraj->i32AccelMax < 1)
+    {
+        psTraj->i32AccelMax = 1;
+    }
+    psTraj->i32Wrap = (int32_t) ui16Wrap << TRAJ_Q;
+    psTraj->bEnabled = false;
+    psTraj->ui32Steps = 0;
+    psTraj->ui32RateLimited = 0;
+    vTrajReset(psTraj, 0);
+}
+
+//*****************************************************************************
+//
+// Places the setpoint at a position at rest, e.g. the measured position at
+// the start of a flight.
+//
+//*****************************************************************************
+void
+vTrajReset (TRAJ *psTraj, int16_t i16Pos)
+{
+    psTraj->i32Pos = i32Wrap(psTraj, (int32_t) i16Pos << TRAJ_Q);
+    psTraj->i32Target = psTraj->i32Pos;
+    psTraj->i32Vel = 0;
+    psTraj->i8Dir = 0;
+}
+
+//*****************************************************************************
+//
+// Moves the setpoint one tick towards the reference. Returns the setpoint
+// rounded to whole units.
+//
+//*****************************************************************************
+int16_t
+i16TrajStep (TRAJ *psTraj, int16_t i16Ref)
+{
+    int32_t i32Target = i32Wrap(psTraj, (int32_t) i16Ref << TRAJ_Q);
+    int32_t i32Error;
+    int32_t i32Speed;
+    int32_t i32Want;
+
+    i32Error = i32Target - psTraj->i32Target;
+    if (psTraj->i32Wrap != 0 && i32Abs(i32Error) > psTraj->i32Wrap / 2)
+    {
+        i32Error -= (i32Error > 0) ? psTraj->i32Wrap : -psTraj->i32Wrap;
+    }
+    if (i32Error != 0)
+    {
+        psTraj->i8Dir = (i32Error > 0) ? 1 : -1;
+        psTraj->ui32Steps++;
+    }
+    psTraj->i32Target = i32Target;
+
+    //
+    // Distance left, the short way round for angles.
+    //
+    i32Error = i32Target - psTraj->i32Pos;
+    if (psTraj->i32Wrap != 0 && i32Abs(i32Error) > psTraj->i32Wrap / 2)
+    {
+        i32Error -= (i32Error > 0) ? psTraj->i32Wrap : -psTraj->i32Wrap;
+    }
+
+    if (!psTraj->bEnabled || (i32Error == 0 && psTraj->i32Vel == 0))
+    {
+        psTraj->i32Pos = i32Target;
+        psTraj->i32Vel = 0;
+    }
+    else
+    {
+        //
+        // Fastest speed v that can still stop at the reference, where
+        // v + (v - a) + (v - 2a) + ... = v(v + a) / 2a <= error. It is capped
+        // at the rate limit and then reached within the acceleration limit.
+        //
+        i32Want = (i32Sqrt(psTraj->i32AccelMax * psTraj->i32AccelMax
+                           + 8 * psTraj->i32AccelMax * i32Abs(i32Error))
+                   - psTraj->i32AccelMax) / 2;
+        if (i32Want > psTraj->i32VelMax)
+        {
+            i32Want = psTraj->i32VelMax;
+        }
+        if (i32Error < 0)
+        {
+            i32Want = -i32Want;
+        }
+
+        if (i32Want > psTraj->i32Vel + psTraj->i32AccelMax)
+        {
+            psTraj->i32Vel += psTraj->i32AccelMax;
+        }
+        else if (i32Want < psTraj->i32Vel - psTraj->i32AccelMax)
+        {
+            psTraj->i32Vel -= psTraj->i32AccelMax;
+        }
+        else
+        {
+            psTraj->i32Vel = i32Want;
+        }
+
+        i32Speed = i32Abs(psTraj->i32Vel);
+        if (i32Speed == psTraj->i32VelMax)
+        {
+            psTraj->ui32RateLimited++;
+        }
+
+        if (i32Abs(i32Error) <= i32Speed && (psTraj->i32Vel > 0) == (i32Error > 0))
+        {
+            //
+            // Reaches the reference this tick.
+            //
+            psTraj->i32Pos = i32Target;
+            psTraj->i32Vel = 0;
+        }
+        else
+        {
+            psTraj->i32Pos = i32Wrap(psTraj, psTraj->i32Pos + psTraj->i32Vel);
+        }
+    }
+
+    return (int16_t) (i32Wrap(psTraj, psTraj->i32Pos + (1 << (TRAJ_Q - 1))) >> TRAJ_Q);
+}
+
+//*****************************************************************************
+//
+// Returns true when the setpoint has reached the reference and stopped.
+//
+//*****************************************************************************
+bool
+bTrajSettled (const TRAJ *psTraj)
+{
+    return (psTraj->i32Pos == psTraj->i32Target && psTraj->i32Vel == 0);
+}
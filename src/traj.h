@@ -0,0 +1,62 @@
+/*
+ * File: traj.h
+ * Project: ENCE464 Assignment 1
+ *
+ * Authors:
+ * - Oliver Dale
+ * - Josh Roberts
+ * - Micaela Cooper
+ * - Angus Fairbairn
+ *
+ *
+ *
+ * Created on: 19.10.26
+ *
+ * Description: Header file for the trajectory module. A trajectory follows a
+ * stepped reference with limited rate and acceleration, so the controller
+ * sees a smooth setpoint instead of the raw button steps.
+ *
+ *
+ */
+
+#ifndef TRAJ_H_
+#define TRAJ_H_
+
+//*****************************************************************************
+//
+// Positions are held in Q8 fixed point, 1/256 of a unit. Velocity is in Q8
+// units per tick and acceleration in Q8 units per tick per tick.
+//
+//*****************************************************************************
+#define TRAJ_Q                  8
+
+//*****************************************************************************
+//
+// Struct for a trajectory.
+//
+//*****************************************************************************
+typedef struct {
+    int32_t i32Pos;             // Current setpoint, Q8
+    int32_t i32Vel;             // Q8 per tick
+    int32_t i32Target;          // Last reference, Q8
+    int32_t i32VelMax;
+    int32_t i32AccelMax;
+    int32_t i32Wrap;            // Q8 modulus for angles, 0 for none
+    int8_t i8Dir;               // Direction of the last reference change
+    bool bEnabled;              // When false the setpoint follows the reference
+    uint32_t ui32Steps;         // Reference changes
+    uint32_t ui32RateLimited;   // Ticks held at the velocity limit
+} TRAJ;
+
+//*****************************************************************************
+//
+// Prototypes for the trajectory module.
+//
+//*****************************************************************************
+void vTrajInit (TRAJ *psTraj, uint16_t ui16Rate, uint16_t ui16Accel,
+                uint16_t ui16Wrap, uint16_t ui16TickMs);
+void vTrajReset (TRAJ *psTraj, int16_t i16Pos);
+int16_t i16TrajStep (TRAJ *psTraj, int16_t i16Ref);
+bool bTrajSettled (const TRAJ *psTraj);
+
+#endif /* TRAJ_H_ */
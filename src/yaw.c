@@ -29,10 +29,12 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "semphr.h"
 
 #include "yaw.h"
+#include "cycles.h"
+#include "calib.h"
+#include "display.h"
+#include "memmap.h"
 #include "priorities.h"
 
 //*****************************************************************************
@@ -43,21 +45,45 @@
 static int16_t  g_i16Edges = 0;
 static int16_t g_i16Angle = 0;
 
-#define ENCODER_SLOTS           448 // Maximum slots in encoder.
+//*****************************************************************************
+//
+// Reference pulse state. Set by the PC4 interrupt.
+//
+//*****************************************************************************
+static volatile bool g_bRefPending = false;     // Zero the edge count on the next update
+static volatile bool g_bHomed = false;          // Reference seen since power up
+static volatile TickType_t g_xHomedTick = 0;    // Tick of the first reference pulse
+static volatile uint32_t g_ui32RefPulses = 0;
+static volatile uint32_t g_ui32EdgeCount = 0;   // Edges counted since power up
+
+//*****************************************************************************
+//
+// Quadrature decoding, done in the encoder interrupt. Each edge is decoded
+// against the previous pin sample and added to a signed count that the yaw
+// task drains, so no edge is lost however late the task runs. The reference
+// interrupt zeroes the count, as the edges before it no longer matter.
+//
+//*****************************************************************************
+static uint8_t g_ui8PrevPins;                   // Only used by the interrupt
+static volatile int32_t g_i32EdgeDelta = 0;     // Edges not yet applied
 
 //*****************************************************************************
 //
-// The stack size for the yaw handler task.
+// The interrupts set bits in the yaw task's notification value to wake it.
 //
 //*****************************************************************************
-#define YAWTASKSTACKSIZE        128         // Stack size in words
+#define YAW_NOTIFY_EDGE         0x100
+#define YAW_NOTIFY_REF          0x200
+
+static TaskHandle_t g_xYawTask = NULL;
 
 //*****************************************************************************
 //
-// A counting semaphore to update the yaw from the ISR.
+// Wake latency from the interrupt to the yaw task, in cycles.
 //
 //*****************************************************************************
-static SemaphoreHandle_t xBinarySemaphore;
+static volatile uint32_t g_ui32NotifyCycles;
+static YAW_WAKE_STATS g_sWake;
 
 //*****************************************************************************
 //
@@ -83,18 +109,19 @@ static SemaphoreHandle_t xBinarySemaphore;
 //
 //*****************************************************************************
 void vInitYawPins(void);
-void vUpdateEdges (uint8_t, uint8_t);
-void vCheckRef(uint8_t);
+static int32_t i32DecodeEdge (uint8_t, uint8_t);
 static void vCheckLimitCases(void);
 void vEdge2Angle(void);
 void vUpdateYaw (void);
 static void vYawHandlingTask( void *pvParameters);
 void vYawIntHandler (void);
+void vYawRefIntHandler (void);
 
 //*****************************************************************************
 //
 // Configures the encoder pins and interrupt handler for Channel A and B.
-// Channel A: PB0, Channel B: PB1, Reference: PC4.
+// Channel A: PB0, Channel B: PB1, Reference: PC4. The reference is active low
+// and interrupts on its falling edge.
 //
 //*****************************************************************************
 void
@@ -123,9 +150,20 @@ vInitYawPins (void)
     GPIOIntTypeSet (YAW_CHAN_GPIO_BASE, YAW_CHAN_A_GPIO_PIN, GPIO_BOTH_EDGES);
     GPIOIntTypeSet (YAW_CHAN_GPIO_BASE, YAW_CHAN_B_GPIO_PIN, GPIO_BOTH_EDGES);
 
+    // The first edge is decoded against the pins as they start
+    g_ui8PrevPins = GPIOPinRead(YAW_CHAN_GPIO_BASE, YAW_CHAN_A_GPIO_PIN | YAW_CHAN_B_GPIO_PIN);
+
     // Enable the pin change interrupt
     GPIOIntEnable (YAW_CHAN_GPIO_BASE, YAW_CHAN_A_GPIO_PIN | YAW_CHAN_B_GPIO_PIN);
+    IntPrioritySet (INT_GPIOB, YAW_INT_PRIORITY);
     IntEnable (INT_GPIOB);  // NB: INT_GPIOB is defined in inc/hw_ints.h
+
+    // Interrupt when the reference slot is reached.
+    GPIOIntRegister (YAW_REF_GPIO_BASE, vYawRefIntHandler);
+    GPIOIntTypeSet (YAW_REF_GPIO_BASE, YAW_REF_GPIO_PIN, GPIO_FALLING_EDGE);
+    GPIOIntEnable (YAW_REF_GPIO_BASE, YAW_REF_GPIO_PIN);
+    IntPrioritySet (INT_GPIOC, YAW_INT_PRIORITY);
+    IntEnable (INT_GPIOC);
 }
 
 //*****************************************************************************
@@ -141,155 +179,261 @@ GetYawAngle (void)
 
 //*****************************************************************************
 //
-// Increments and decrements the encoder edge count.
+// Returns true once the reference pulse has been seen, so the yaw angle is
+// measured from the true zero.
 //
 //*****************************************************************************
-void
-vUpdateEdges (uint8_t ui8YawA, uint8_t ui8PrevYawB)
+bool
+bYawIsHomed (void)
 {
-    if (ui8YawA ^ ui8PrevYawB) {
-        g_i16Edges--;
-    } else {
-        g_i16Edges++;
-    }
+    return g_bHomed;
 }
 
 //*****************************************************************************
 //
-// Checks if the helicopter is at the 0 degree position.
+// Returns the tick of the first reference pulse and the number of pulses
+// seen since power up.
 //
 //*****************************************************************************
 void
-vCheckRef(uint8_t ui8Ref)
+vYawGetHoming (TickType_t *pxHomedTick, uint32_t *pui32Pulses)
 {
-    if (ui8Ref == 0) {
-        g_i16Edges = 0;
+    *pxHomedTick = g_xHomedTick;
+    *pui32Pulses = g_ui32RefPulses;
+}
+
+//*****************************************************************************
+//
+// Returns the number of encoder edges counted since power up, in either
+// direction. Used to check that the encoder is connected.
+//
+//*****************************************************************************
+uint32_t
+ui32YawEdges (void)
+{
+    return g_ui32EdgeCount;
+}
+
+//*****************************************************************************
+//
+// Returns the step of the encoder between two pin samples: +1 or -1 for an
+// edge on one channel, or 0 if neither changed. If both channels changed an
+// edge was missed and the direction is unknown, so no step is counted.
+//
+//*****************************************************************************
+static int32_t
+i32DecodeEdge (uint8_t ui8Prev, uint8_t ui8Pins)
+{
+    uint8_t ui8YawA = (ui8Pins & YAW_CHAN_A_GPIO_PIN) ? 1 : 0;
+    uint8_t ui8PrevYawB = (ui8Prev & YAW_CHAN_B_GPIO_PIN) ? 1 : 0;
+
+    uint8_t ui8Changed = ui8Prev ^ ui8Pins;
+
+    if (ui8Changed != YAW_CHAN_A_GPIO_PIN && ui8Changed != YAW_CHAN_B_GPIO_PIN)
+    {
+        return 0;
     }
+
+    return (ui8YawA ^ ui8PrevYawB) ? -1 : 1;
 }
 
 //*****************************************************************************
 //
-// Checks if the helicopter is at the 360 degree boundary.
+// Checks if the helicopter is at the 360 degree boundary. The number of
+// edges in a revolution comes from the calibration.
 //
 //*****************************************************************************
 static void
 vCheckLimitCases(void)
 {
-    if (g_i16Edges >= 450) {
-        g_i16Edges = 0;
-    } else if (g_i16Edges < 0) {
-        g_i16Edges = 449;
+    int16_t i16Slots = psCalibFactors()->ui16EncoderSlots;
+
+    while (g_i16Edges >= i16Slots) {
+        g_i16Edges -= i16Slots;
+    }
+    while (g_i16Edges < 0) {
+        g_i16Edges += i16Slots;
     }
 }
 
 void
 vEdge2Angle(void)
 {
-    g_i16Angle = (g_i16Edges * 360)/ENCODER_SLOTS;
+    g_i16Angle = ((uint32_t) g_i16Edges * psCalibFactors()->ui32YawScale) >> CALIB_Q;
 }
 
 //*****************************************************************************
 //
-// Updates the edge count based on the digital output of channel A and B
-// and calculates the new yaw angle.
+// Applies the edges decoded by the interrupt since the last update and
+// calculates the new yaw angle. If the reference pulse has fired, the count
+// restarts from zero with the edges seen after it.
 //
 //*****************************************************************************
 void
 vUpdateYaw (void)
 {
-    uint8_t ui8YawA;
-    uint8_t ui8YawB;
-
-    static uint8_t ui8PrevYawB;
+    int32_t i32Delta;
+    bool bRef;
 
-    uint8_t ui8Ref = 1;
+    taskENTER_CRITICAL();
+    i32Delta = g_i32EdgeDelta;
+    g_i32EdgeDelta = 0;
+    bRef = g_bRefPending;
+    g_bRefPending = false;
+    taskEXIT_CRITICAL();
 
-    //
-    // Read the GPIO pins to check which channel triggered the ISR.
-    //
-    ui8Ref = GPIOPinRead(YAW_REF_GPIO_BASE, YAW_REF_GPIO_PIN);
-    ui8YawA = GPIOPinRead(YAW_CHAN_GPIO_BASE, YAW_CHAN_A_GPIO_PIN);
-    ui8YawB = GPIOPinRead(YAW_CHAN_GPIO_BASE, YAW_CHAN_B_GPIO_PIN);
-
-    if (ui8YawB == 2) { ui8YawB = 1;}
-
-    vUpdateEdges(ui8YawA, ui8PrevYawB);
-
-    vCheckRef(ui8Ref);
+    if (bRef) {
+        g_i16Edges = 0;
+    }
+    g_i16Edges += i32Delta;
 
     vCheckLimitCases();
 
     vEdge2Angle(); // Converts the edge count to a angle.
 
-    ui8PrevYawB = ui8YawB;
+    DisplayValueUpdated (DISPLAY_YAW, g_i16Angle);
+}
+
+//*****************************************************************************
+//
+// Records the cycles from the last interrupt to the task waking.
+//
+//*****************************************************************************
+static void
+vRecordWake (uint32_t ui32Cycles)
+{
+    if (ui32Cycles > g_sWake.ui32Max)
+    {
+        g_sWake.ui32Max = ui32Cycles;
+    }
+    g_sWake.ui32Total += ui32Cycles;
+    g_sWake.ui32Wakes++;
+}
+
+//*****************************************************************************
+//
+// Returns the interrupt to task wake latency, then clears it.
+//
+//*****************************************************************************
+void
+vYawGetWakeStats (YAW_WAKE_STATS *psStats)
+{
+    taskENTER_CRITICAL();
+    *psStats = g_sWake;
+    g_sWake.ui32Max = 0;
+    g_sWake.ui32Total = 0;
+    g_sWake.ui32Wakes = 0;
+    taskEXIT_CRITICAL();
 }
 
 //*****************************************************************************
 //
-// This task gets preempted by the handler task once a semaphore becomes available.
+// This task gets preempted by the handler task once it is notified by the
+// encoder or reference interrupt.
 //
 //*****************************************************************************
 static void
 vYawHandlingTask( void *pvParameters )
 {
+    uint32_t ui32Notify;
+
     while(1)
     {
-        xSemaphoreTake( xBinarySemaphore, portMAX_DELAY );
+        xTaskNotifyWait(0, UINT32_MAX, &ui32Notify, portMAX_DELAY);
+        vRecordWake(CyclesGet() - g_ui32NotifyCycles);
         vUpdateYaw();
     }
 }
 
 //*****************************************************************************
 //
-// Handler function for ISR triggered by encoder. Clears the ISR and then increments
-// a counting semaphore to update the yaw.
+// Handler function for ISR triggered by encoder. Clears the ISR, samples both
+// channels, decodes the edge into the pending count and wakes the yaw task.
 //
 //*****************************************************************************
 void
 vYawIntHandler (void)
 {
      BaseType_t xHigherPriorityTaskWoken;
+     uint8_t ui8Pins;
+     int32_t i32Step;
 
      GPIOIntClear (YAW_CHAN_GPIO_BASE, YAW_CHAN_A_GPIO_PIN | YAW_CHAN_B_GPIO_PIN);
+     ui8Pins = GPIOPinRead(YAW_CHAN_GPIO_BASE, YAW_CHAN_A_GPIO_PIN | YAW_CHAN_B_GPIO_PIN);
+
+     i32Step = i32DecodeEdge(g_ui8PrevPins, ui8Pins);
+     g_ui8PrevPins = ui8Pins;
+     if (i32Step == 0)
+     {
+         return;
+     }
+     g_i32EdgeDelta += i32Step;
+     g_ui32EdgeCount++;
+     g_ui32NotifyCycles = CyclesGet();
 
      /* The xHigherPriorityTaskWoken parameter must be initialized to pdFALSE as it
      will get set to pdTRUE inside the interrupt safe API function if a context switch
      is required. */
      xHigherPriorityTaskWoken = pdFALSE;
 
-     /* 'Give' the semaphore. Will unblock the deferred interrupt handling task. */
-     xSemaphoreGiveFromISR( xBinarySemaphore, &xHigherPriorityTaskWoken );
+     /* Will unblock the deferred interrupt handling task. */
+     if (g_xYawTask != NULL)
+     {
+         xTaskNotifyFromISR( g_xYawTask, YAW_NOTIFY_EDGE, eSetBits, &xHigherPriorityTaskWoken );
+     }
 
-     /*If xHigherPriorityTaskWoken was set to pdTRUE inside xSemaphoreGiveFromISR() then
+     /*If xHigherPriorityTaskWoken was set to pdTRUE inside xTaskNotifyFromISR() then
      calling portYIELD_FROM_ISR() will request a context switch. */
      portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
 }
 
 //*****************************************************************************
 //
-// Initialises ReadAngle Task. Includes configuring yaw pins, counting
-// semaphore and yaw handling task.
+// Handler for the reference pulse on PC4. Records the first pulse and has the
+// yaw task zero the edge count.
+//
+//*****************************************************************************
+void
+vYawRefIntHandler (void)
+{
+     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+     GPIOIntClear (YAW_REF_GPIO_BASE, YAW_REF_GPIO_PIN);
+
+     if (!g_bHomed)
+     {
+         g_xHomedTick = xTaskGetTickCountFromISR();
+         g_bHomed = true;
+     }
+     g_ui32RefPulses++;
+     g_bRefPending = true;
+     g_i32EdgeDelta = 0;
+     g_ui32NotifyCycles = CyclesGet();
+
+     if (g_xYawTask != NULL)
+     {
+         xTaskNotifyFromISR( g_xYawTask, YAW_NOTIFY_REF, eSetBits, &xHigherPriorityTaskWoken );
+     }
+     portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+//*****************************************************************************
+//
+// Initialises ReadAngle Task. Includes configuring yaw pins and the yaw
+// handling task.
 //
 //*****************************************************************************
 uint32_t
 InitReadAngle (void)
 {
+    CyclesInit();
     vInitYawPins();
-    xBinarySemaphore = xSemaphoreCreateBinary(); // Create a semaphore to defer the encoder ISR.
-
-    // Check semaphore was created successfully.
-    if (xBinarySemaphore == NULL)
-    {
-        while (1)
-        {
-        }
-    }
 
     //
     // Create the yaw handling task to read the angle change of the helicopter.
     //
-    if(xTaskCreate(vYawHandlingTask, (const portCHAR *)"YawHandlingTask",
-                   YAWTASKSTACKSIZE, NULL,  tskIDLE_PRIORITY + YAWTASKPRIORITY,  NULL) != pdTRUE)
+    if(xMemMapTaskCreate(MEMMAP_TASK_YAW, vYawHandlingTask, NULL,
+                   tskIDLE_PRIORITY + YAWTASKPRIORITY, &g_xYawTask) != pdTRUE)
     {
         return(1);
     }
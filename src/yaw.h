@@ -23,12 +23,27 @@
 #ifndef YAW_TASK_H_
 #define YAW_TASK_H_
 
+//*****************************************************************************
+//
+// Interrupt to yaw task wake latency, in cycles.
+//
+//*****************************************************************************
+typedef struct {
+    uint32_t ui32Wakes;
+    uint32_t ui32Max;
+    uint32_t ui32Total;
+} YAW_WAKE_STATS;
+
 //*****************************************************************************
 //
 // Prototypes for the yaw module.
 //
 //*****************************************************************************
 int16_t GetYawAngle (void);
+bool bYawIsHomed (void);
+void vYawGetHoming (TickType_t *, uint32_t *);
+void vYawGetWakeStats (YAW_WAKE_STATS *);
+uint32_t ui32YawEdges (void);
 uint32_t InitReadAngle (void);
 
 #endif /* YAW_TASK_H_ */